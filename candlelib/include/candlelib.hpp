@@ -8,7 +8,15 @@ It provides all modules and API interfaces.
 
 #include "mab_types.hpp"
 #include "candle.hpp"
+#include "candle_group.hpp"
+#include "cycle_coordinator.hpp"
+#include "cyclic_executor.hpp"
 #include "MD.hpp"
+#include "MDGroup.hpp"
+#include "drive_state_mirror.hpp"
+#include "telemetry_recorder.hpp"
+#include "trajectory_streamer.hpp"
+#include "md_batch.hpp"
 #include "pds.hpp"
 #include "USB.hpp"
 #include "SPI.hpp"
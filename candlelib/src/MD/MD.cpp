@@ -1,5 +1,12 @@
 #include "MD.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
 namespace mab
 {
 
@@ -19,12 +26,12 @@ namespace mab
         //     if (devType != deviceType_E::UNKNOWN_DEVICE)
         //         return Error_t::OK;
         // }
-        auto candleVersionOpt = m_candle->getCandleVersion();
+        // capabilities are negotiated once by the candle, no bus traffic here
+        const auto& candleCapabilities = m_candle->getCapabilities();
 
-        if (!candleVersionOpt.has_value())
+        if (!candleCapabilities.version.has_value())
             m_log.error("Could not read candle version!");
-        else if (candleVersionOpt.value().s.major < 2 ||
-                 (candleVersionOpt.value().s.major == 2 && candleVersionOpt.value().s.minor < 4))
+        else if (!candleCapabilities.packedFrames)
         {
             m_log.warn(
                 "You are using old CANdle firmware version. This firmware version will not work "
@@ -471,6 +478,34 @@ namespace mab
         return std::make_pair(m_status.motionStatus, result);
     }
 
+    std::pair<MDStatus::StatusWords_S, MD::Error_t> MD::getStatusWords()
+    {
+        MDStatus::StatusWords_S words;
+
+        auto result = readRegisters(m_mdRegisters.quickStatus,
+                                    m_mdRegisters.mainEncoderStatus,
+                                    m_mdRegisters.auxEncoderStatus,
+                                    m_mdRegisters.calibrationStatus,
+                                    m_mdRegisters.bridgeStatus,
+                                    m_mdRegisters.hardwareStatus,
+                                    m_mdRegisters.communicationStatus,
+                                    m_mdRegisters.motionStatus);
+        if (result != Error_t::OK)
+        {
+            m_log.error("Could not read status registers!");
+            return std::make_pair(words, result);
+        }
+        words.quickStatus         = m_mdRegisters.quickStatus.value;
+        words.mainEncoderStatus   = m_mdRegisters.mainEncoderStatus.value;
+        words.outputEncoderStatus = m_mdRegisters.auxEncoderStatus.value;
+        words.calibrationStatus   = m_mdRegisters.calibrationStatus.value;
+        words.bridgeStatus        = m_mdRegisters.bridgeStatus.value;
+        words.hardwareStatus      = m_mdRegisters.hardwareStatus.value;
+        words.communicationStatus = m_mdRegisters.communicationStatus.value;
+        words.motionStatus        = m_mdRegisters.motionStatus.value;
+        return std::make_pair(words, result);
+    }
+
     std::pair<float, MD::Error_t> MD::getPosition()
     {
         auto result = readRegister(m_mdRegisters.mainEncoderPosition);
@@ -575,7 +610,385 @@ namespace mab
                                 100.0f);
     }
 
-    std::vector<canId_t> MD::discoverMDs(Candle* candle)
+    std::vector<std::vector<size_t>> MD::packRegisterFrames(std::span<const MDRegisterRef_S> regs,
+                                                            const size_t payloadCapacity)
+    {
+        std::vector<size_t> order(regs.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(),
+                         order.end(),
+                         [&regs](size_t a, size_t b)
+                         { return regs[a].getSerializedSize() > regs[b].getSerializedSize(); });
+
+        std::vector<std::vector<size_t>> frames;
+        std::vector<size_t>              freeSpace;
+        for (const size_t regIdx : order)
+        {
+            const size_t regSize = regs[regIdx].getSerializedSize();
+            if (regSize > payloadCapacity)
+                return {};
+            auto frameIt = std::find_if(freeSpace.begin(),
+                                        freeSpace.end(),
+                                        [regSize](size_t space) { return space >= regSize; });
+            if (frameIt == freeSpace.end())
+            {
+                frames.emplace_back();
+                freeSpace.push_back(payloadCapacity);
+                frameIt = freeSpace.end() - 1;
+            }
+            const size_t frameIdx = std::distance(freeSpace.begin(), frameIt);
+            frames[frameIdx].push_back(regIdx);
+            freeSpace[frameIdx] -= regSize;
+        }
+        return frames;
+    }
+
+    std::vector<MD::RegisterFrame_S> MD::planRegisterFrames(
+        std::span<const MDRegisterRef_S> regs) const
+    {
+        const size_t frameSize = m_candle->getMaxCANFrameSize();
+        if (frameSize > CAN_2_0_FRAME_SIZE)
+        {
+            auto packing = packRegisterFrames(regs, frameSize - REGISTER_FRAME_HEADER_SIZE);
+            std::vector<RegisterFrame_S> plan;
+            for (auto& frameRegs : packing)
+                plan.push_back(RegisterFrame_S{std::move(frameRegs)});
+            return plan;
+        }
+
+        // registers that fit are packed together, the rest is split into fragments
+        std::vector<MDRegisterRef_S> whole;
+        std::vector<size_t>          wholeIdx;
+        std::vector<RegisterFrame_S> plan;
+        constexpr size_t fragmentCapacity = CAN_2_0_FRAME_SIZE - FRAGMENT_HEADER_SIZE;
+        for (size_t regIdx = 0; regIdx < regs.size(); regIdx++)
+        {
+            if (regs[regIdx].getSerializedSize() + REGISTER_FRAME_HEADER_SIZE <= frameSize)
+            {
+                whole.push_back(regs[regIdx]);
+                wholeIdx.push_back(regIdx);
+                continue;
+            }
+            if (regs[regIdx].size > std::numeric_limits<u8>::max() + fragmentCapacity)
+                return {};
+            for (u16 offset = 0; offset < regs[regIdx].size; offset += fragmentCapacity)
+            {
+                const u16 length = std::min<u16>(fragmentCapacity, regs[regIdx].size - offset);
+                plan.push_back(RegisterFrame_S{{regIdx}, offset, length});
+            }
+        }
+        for (const auto& frameRegs :
+             packRegisterFrames(whole, frameSize - REGISTER_FRAME_HEADER_SIZE))
+        {
+            RegisterFrame_S frame;
+            for (const size_t idx : frameRegs)
+                frame.regs.push_back(wholeIdx[idx]);
+            plan.push_back(std::move(frame));
+        }
+        return plan;
+    }
+
+    MdFrameId_E MD::registerFrameId(const Candle* candle, const bool write)
+    {
+        if (candle != nullptr && candle->getMaxCANFrameSize() <= CAN_2_0_FRAME_SIZE)
+            return write ? MdFrameId_E::WRITE_REGISTER_CAN_2_0 : MdFrameId_E::READ_REGISTER_CAN_2_0;
+        return write ? MdFrameId_E::WRITE_REGISTER : MdFrameId_E::READ_REGISTER;
+    }
+
+    std::vector<u8> MD::serializeRegisterFrame(const RegisterFrame_S&           frame,
+                                               std::span<const MDRegisterRef_S> regs,
+                                               const bool                       write) const
+    {
+        // padding byte of the header carries the value offset of fragments
+        std::vector<u8> bytes = {(u8)registerFrameId(m_candle, write), (u8)frame.offset};
+        for (const size_t regIdx : frame.regs)
+        {
+            const MDRegisterRef_S& reg    = regs[regIdx];
+            const u16              length = frame.isFragment() ? frame.length : reg.size;
+            bytes.push_back(reg.address);
+            bytes.push_back(reg.address >> 8);
+            // Value bytes of a read request are placeholders filled by the MD
+            if (write)
+            {
+                const u8* value = static_cast<const u8*>(reg.value) + frame.offset;
+                bytes.insert(bytes.end(), value, value + length);
+            }
+            else
+                bytes.insert(bytes.end(), length, 0x0);
+        }
+        return bytes;
+    }
+
+    std::vector<std::pair<std::vector<u8>, MD::Error_t>> MD::transferFrameBatch(
+        const std::vector<std::vector<u8>>& frames, const bool idempotent)
+    {
+        std::vector<std::pair<std::vector<u8>, Error_t>> results;
+        results.reserve(frames.size());
+        if (m_candle == nullptr)
+        {
+            m_log.error("Candle empty!");
+            results.resize(frames.size(), std::make_pair(std::vector<u8>(), Error_t::NOT_CONNECTED));
+            return results;
+        }
+
+        if (frames.size() > 1 && m_candle->getCapabilities().packedFrames)
+        {
+            // all frames are submitted before waiting, so the adapter packs them together
+            std::vector<std::future<std::pair<std::vector<u8>, CANdleFrameAdapter::Error_t>>>
+                futures;
+            for (const auto& frame : frames)
+                futures.push_back(m_candle->transferCANFrameAsync(
+                    m_canId, frame, frame.size(), getTimeout100us(), idempotent));
+            for (auto& future : futures)
+            {
+                auto [response, error] = future.get();
+                results.emplace_back(std::move(response),
+                                     error == CANdleFrameAdapter::Error_t::OK
+                                         ? Error_t::OK
+                                         : Error_t::TRANSFER_FAILED);
+            }
+            return results;
+        }
+
+        for (const auto& frame : frames)
+        {
+            auto [response, error] = transferCanFrame(frame, frame.size(), idempotent);
+            results.emplace_back(std::move(response),
+                                 error == candleTypes::Error_t::OK ? Error_t::OK
+                                                                   : Error_t::TRANSFER_FAILED);
+        }
+        return results;
+    }
+
+    MD::Error_t MD::responseError(const std::vector<u8>& response) const
+    {
+        if (response.size() >= 4 && response[0] == (u8)MdFrameId_E::RESPONSE_ERROR)
+        {
+            // communication ok, but there was problem with parsing/data format/handing
+            mab::MdRegisterAccessErrorCode code = (mab::MdRegisterAccessErrorCode)response[1];
+            u16 registerAddress                 = (u16)(response[2] | (response[3] << 8));
+            m_log.error("Error in register access %s, for register 0x%04X",
+                        MDRegisterAccessError_S::toReadable(code).c_str(),
+                        registerAddress);
+            return Error_t::REQUEST_INVALID;
+        }
+        m_log.error("Error while parsing response!");
+        return Error_t::TRANSFER_FAILED;
+    }
+
+    MD::Error_t MD::prepareRegisterRequest(std::span<const MDRegisterRef_S> regs,
+                                           const bool                       write,
+                                           RegisterRequest_S&               request) const
+    {
+        if (m_candle == nullptr)
+            return Error_t::NOT_CONNECTED;
+        for (const auto& reg : regs)
+        {
+            if (!write && reg.access == RegisterAccessLevel_E::WO)
+            {
+                m_log.error("Attempt to read write-only register: %s", reg.name.data());
+                return Error_t::REQUEST_INVALID;
+            }
+            if (write && reg.access == RegisterAccessLevel_E::RO)
+            {
+                m_log.error("Attempt to write to read-only register: %s", reg.name.data());
+                return Error_t::REQUEST_INVALID;
+            }
+        }
+
+        request.regs.assign(regs.begin(), regs.end());
+        request.write = write;
+        request.plan  = planRegisterFrames(regs);
+        request.frames.clear();
+        if (request.plan.empty() && !regs.empty())
+        {
+            m_log.error("Register does not fit into a single CAN frame!");
+            return Error_t::REQUEST_INVALID;
+        }
+        for (const auto& frame : request.plan)
+            request.frames.push_back(serializeRegisterFrame(frame, regs, write));
+        return Error_t::OK;
+    }
+
+    MD::Error_t MD::completeRegisterRequest(
+        const RegisterRequest_S&                                request,
+        const std::vector<std::pair<std::vector<u8>, Error_t>>& responses) const
+    {
+        if (responses.size() != request.frames.size())
+            return Error_t::TRANSFER_FAILED;
+        return request.write ? completeWrite(request, responses) : completeRead(request, responses);
+    }
+
+    MD::Error_t MD::completeRead(
+        const RegisterRequest_S&                                request,
+        const std::vector<std::pair<std::vector<u8>, Error_t>>& responses) const
+    {
+        const auto& regs   = request.regs;
+        const auto& plan   = request.plan;
+        Error_t     status = Error_t::OK;
+        for (size_t frameIdx = 0; frameIdx < plan.size(); frameIdx++)
+        {
+            const auto& [response, error] = responses[frameIdx];
+            const auto& frame             = request.frames[frameIdx];
+            if (error == Error_t::OK && !response.empty() &&
+                response.at(0) == (u8)MdFrameId_E::RESPONSE_ERROR)
+            {
+                // the other frames are still read, so a single rejected register does not hide
+                // the rest of them
+                const Error_t rejected = responseError(response);
+                if (rejected != Error_t::REQUEST_INVALID || status == Error_t::OK)
+                    status = rejected;
+                continue;
+            }
+            if (error != Error_t::OK || response.size() < REGISTER_FRAME_HEADER_SIZE ||
+                response.at(0) != frame.at(0) ||
+                (plan[frameIdx].isFragment() && response.at(1) != frame.at(1)))
+            {
+                m_log.error("Error while reading register list!");
+                status = Error_t::TRANSFER_FAILED;
+                continue;
+            }
+            if (plan[frameIdx].isFragment())
+            {
+                const MDRegisterRef_S& reg = regs[plan[frameIdx].regs.front()];
+                if (response.size() < FRAGMENT_HEADER_SIZE + plan[frameIdx].length ||
+                    (u16)(response[2] | (response[3] << 8)) != reg.address)
+                {
+                    m_log.error("Malformed response for register %s", reg.name.data());
+                    status = Error_t::TRANSFER_FAILED;
+                    continue;
+                }
+                std::memcpy(static_cast<u8*>(reg.value) + plan[frameIdx].offset,
+                            response.data() + FRAGMENT_HEADER_SIZE,
+                            plan[frameIdx].length);
+                continue;
+            }
+            size_t offset = REGISTER_FRAME_HEADER_SIZE;
+            for (const size_t regIdx : plan[frameIdx].regs)
+            {
+                const MDRegisterRef_S& reg = regs[regIdx];
+                if (offset + reg.getSerializedSize() > response.size() ||
+                    (u16)(response[offset] | (response[offset + 1] << 8)) != reg.address)
+                {
+                    m_log.error("Malformed response for register %s", reg.name.data());
+                    status = Error_t::TRANSFER_FAILED;
+                    break;
+                }
+                std::memcpy(reg.value, response.data() + offset + sizeof(reg.address), reg.size);
+                offset += reg.getSerializedSize();
+            }
+        }
+        return status;
+    }
+
+    MD::Error_t MD::completeWrite(
+        const RegisterRequest_S&                                request,
+        const std::vector<std::pair<std::vector<u8>, Error_t>>& responses) const
+    {
+        const auto&       regs   = request.regs;
+        const auto&       plan   = request.plan;
+        Error_t           status = Error_t::OK;
+        std::vector<bool> failed(regs.size(), false);
+        for (size_t frameIdx = 0; frameIdx < responses.size(); frameIdx++)
+        {
+            const auto& [response, error] = responses[frameIdx];
+            Error_t frameStatus           = Error_t::OK;
+            if (error != Error_t::OK || response.empty())
+            {
+                m_log.error("Error while writing register list!");
+                frameStatus = Error_t::TRANSFER_FAILED;
+            }
+            else if (response.at(0) != request.frames[frameIdx].at(0) &&
+                     ((MdFrameId_E)response.at(0) != MdFrameId_E::RESPONSE_LEGACY ||
+                      plan[frameIdx].isFragment()))
+            {
+                frameStatus = responseError(response);
+            }
+            else if (plan[frameIdx].isFragment() &&
+                     (response.size() < REGISTER_FRAME_HEADER_SIZE ||
+                      response.at(1) != request.frames[frameIdx].at(1)))
+            {
+                // fragment has to be acknowledged with its own offset
+                m_log.error("Fragment of register list acknowledged with a wrong offset!");
+                frameStatus = Error_t::TRANSFER_FAILED;
+            }
+
+            if (frameStatus != Error_t::OK)
+            {
+                status = frameStatus;
+                for (const size_t regIdx : plan[frameIdx].regs)
+                    failed[regIdx] = true;
+                // state of the drive is unknown after a failed write
+                if (m_registerCache != nullptr)
+                    m_registerCache->invalidateAll();
+            }
+            else if (m_registerCache != nullptr)
+            {
+                const RegisterFrame_S& frame = plan[frameIdx];
+                // fragmented value is known to the drive once its last fragment is acknowledged
+                if (frame.isFragment() &&
+                    (frame.offset + frame.length < regs[frame.regs.front()].size ||
+                     failed[frame.regs.front()]))
+                    continue;
+                for (const size_t regIdx : frame.regs)
+                    m_registerCache->store(regs[regIdx]);
+            }
+        }
+        return status;
+    }
+
+    MD::Error_t MD::readRegisterList(std::span<const MDRegisterRef_S> regs)
+    {
+        m_log.debug("Reading register list...");
+        RegisterRequest_S request;
+        Error_t           err = prepareRegisterRequest(regs, false, request);
+        if (err != Error_t::OK)
+            return err;
+        return completeRead(request, transferFrameBatch(request.frames, true));
+    }
+
+    MD::Error_t MD::readRegisterList(const std::vector<u16>& addresses)
+    {
+        std::vector<MDRegisterRef_S> regs;
+        regs.reserve(addresses.size());
+        for (const u16 address : addresses)
+        {
+            auto reg = m_mdRegisters.getRef(address);
+            if (!reg.has_value())
+            {
+                m_log.error("Unknown register address 0x%04X", address);
+                return Error_t::REQUEST_INVALID;
+            }
+            regs.push_back(reg.value());
+        }
+        return readRegisterList(regs);
+    }
+
+    MD::Error_t MD::writeRegisterList(std::span<const MDRegisterRef_S> regs)
+    {
+        m_log.debug("Writing register list...");
+        if (m_candle == nullptr)
+            return Error_t::NOT_CONNECTED;
+
+        std::vector<MDRegisterRef_S> uncached;
+        if (m_registerCache != nullptr)
+        {
+            uncached = m_registerCache->filter(regs);
+            regs     = uncached;
+            if (regs.empty())
+                return Error_t::OK;
+        }
+
+        RegisterRequest_S request;
+        Error_t           err = prepareRegisterRequest(regs, true, request);
+        if (err != Error_t::OK)
+            return err;
+        return completeWrite(request, transferFrameBatch(request.frames, false));
+    }
+
+    std::vector<canId_t> MD::discoverMDs(Candle*                      candle,
+                                         std::function<void(canId_t)> onFound,
+                                         const u16                    timeout100us)
     {
         constexpr canId_t MIN_VAILID_ID = 10;     // ids less than that are reserved for special
         constexpr canId_t MAX_VAILID_ID = 0x7FF;  // 11-bit value (standard can ID max)
@@ -588,6 +1001,81 @@ namespace mab
             log.error("Candle is empty!");
             return std::vector<canId_t>();
         }
+        if (!candle->getCapabilities().packedFrames)
+        {
+            log.warn("CANdle firmware does not support packed frames, using slow discovery");
+            return discoverMDsLegacy(candle, onFound);
+        }
+
+        log.info("Looking for MDs");
+
+        // Every probe is the same register read, only the target id changes
+        MDRegisters_S   probeRegisters;
+        auto            probeTuple = std::tuple<MDRegisterEntry_S<u8>&>(
+            probeRegisters.legacyHardwareVersion);
+        std::vector<u8> probeFrame = {(u8)registerFrameId(candle, false), 0x0};
+        auto            payload    = serializeMDRegisters(probeTuple);
+        probeFrame.insert(probeFrame.end(), payload.begin(), payload.end());
+
+        std::mutex       resultMux;
+        std::atomic<u32> nextId = MIN_VAILID_ID;
+        u32              probed = 0;
+
+        auto probe = [&]()
+        {
+            for (u32 id = nextId++; id < MAX_VAILID_ID; id = nextId++)
+            {
+                auto [response, error] = candle->transferCANFramePacked(
+                    (canId_t)id, probeFrame, probeFrame.size(), timeout100us);
+
+                MDRegisterEntry_S<u8> hardwareVersion = probeRegisters.legacyHardwareVersion;
+                auto resultTuple = std::tuple<MDRegisterEntry_S<u8>&>(hardwareVersion);
+                bool found = error == CANdleFrameAdapter::Error_t::OK && response.size() >= 3 &&
+                             response.at(0) == probeFrame[0];
+                if (found)
+                    found = !deserializeMDRegisters(responsePayload(response), resultTuple) &&
+                            hardwareVersion.value != 0;
+
+                std::unique_lock lock(resultMux);
+                log.progress(float(++probed) / float(MAX_VAILID_ID - MIN_VAILID_ID));
+                if (!found)
+                    continue;
+                log.debug("Discovered MD device with ID: %d", id);
+                ids.push_back((canId_t)id);
+                if (onFound)
+                    onFound((canId_t)id);
+            }
+        };
+
+        // Each worker keeps one probe outstanding, so the window is a few packed frames deep and
+        // the adapter always has a full frame to send while responses of the previous ones are
+        // being parsed
+        {
+            std::vector<std::jthread> workers;
+            for (size_t worker = 0; worker < DISCOVERY_MAX_IN_FLIGHT; worker++)
+                workers.emplace_back(probe);
+        }
+        std::sort(ids.begin(), ids.end());
+
+        for (canId_t id : ids)
+        {
+            log.info("Discovered MD device with ID: %d", id);
+        }
+        if (ids.size() > 0)
+            return ids;
+
+        log.warn("Have not found any MD devices on the CAN bus!");
+        return ids;
+    }
+
+    std::vector<canId_t> MD::discoverMDsLegacy(Candle*                      candle,
+                                               std::function<void(canId_t)> onFound)
+    {
+        constexpr canId_t MIN_VAILID_ID = 10;     // ids less than that are reserved for special
+        constexpr canId_t MAX_VAILID_ID = 0x7FF;  // 11-bit value (standard can ID max)
+
+        Logger               log(Logger::ProgramLayer_E::TOP, "MD_DISCOVERY");
+        std::vector<canId_t> ids;
 
         log.info("Looking for MDs");
 
@@ -601,7 +1089,11 @@ namespace mab
             Logger::g_m_verbosity = Logger::Verbosity_E::SILENT;
             MD md(id, candle);
             if (md.init() == MD::Error_t::OK)
+            {
                 ids.push_back(id);
+                if (onFound)
+                    onFound(id);
+            }
 
             Logger::g_m_verbosity = prevVerbosity;
         }
@@ -7,10 +7,13 @@
 #include "candle_types.hpp"
 #include "MDStatus.hpp"
 #include "MD_strings.hpp"
+#include "register_cache.hpp"
+#include "register_frame.hpp"
 #include "candle.hpp"
 
 #include <cstring>
 
+#include <algorithm>
 #include <array>
 #include <queue>
 #include <type_traits>
@@ -18,11 +21,13 @@
 #include <functional>
 #include <tuple>
 #include <map>
+#include <memory>
 #include <unordered_map>
 #include <string>
 #include <vector>
 #include <iomanip>
 #include <future>
+#include <span>
 
 namespace mab
 {
@@ -44,8 +49,12 @@ namespace mab
         /// @brief Helper buffer for storing MD status information
         MDStatus m_status;
 
+        /// @brief Time given to the MD to respond to a frame in milliseconds, DEFAULT_TIMEOUT_MS
+        /// when not set
         std::optional<u32> m_timeout;
 
+        static constexpr u32 DEFAULT_TIMEOUT_MS = 10;
+
         /// @brief Possible errors present in this class
         enum class Error_t : u8
         {
@@ -63,9 +72,32 @@ namespace mab
         MD(canId_t canId, Candle* candle) : m_canId(canId), m_candle(candle)
         {
             m_log.m_layer = Logger::ProgramLayer_E::TOP;
-            std::stringstream tag;
-            tag << "MD" << std::setfill('0') << std::setw(4) << m_canId;
-            m_log.m_tag = tag.str();
+            char tag[16];
+            snprintf(tag, sizeof(tag), "MD%04u", static_cast<unsigned>(m_canId));
+            m_log.m_tag = tag;
+        }
+
+        /// @brief Response timeout of the MD in milliseconds
+        u32 getTimeoutMs() const
+        {
+            return m_timeout.value_or(DEFAULT_TIMEOUT_MS);
+        }
+
+        /// @brief Response timeout of the MD in units of 100 microseconds used by packed frames
+        u16 getTimeout100us() const
+        {
+            return (u16)std::min<u64>((u64)getTimeoutMs() * 10, UINT16_MAX);
+        }
+
+        /// @brief Register frame id of the bus of the candle, the _CAN_2_0 ones on classic CAN
+        /// buses. Every register access path builds and checks its frames with it, so the drive
+        /// sees the same frames from all of them.
+        static MdFrameId_E registerFrameId(const Candle* candle, const bool write);
+
+        /// @brief Whether the MD communicates through the candle
+        bool isAttachedTo(const Candle* candle) const
+        {
+            return m_candle == candle;
         }
 
         /// @brief Check communication with MD device
@@ -226,6 +258,11 @@ namespace mab
                   Error_t>
         getMotionStatus();
 
+        /// @brief Read all of the status registers with a single request. Cheaper than the
+        /// map-returning getters, bits are decoded with the MDStatus bit tables.
+        /// @return Raw status words
+        std::pair<MDStatus::StatusWords_S, Error_t> getStatusWords();
+
         /// @brief Request position of the MD
         /// @return Position in radians
         std::pair<float, Error_t> getPosition();
@@ -332,23 +369,31 @@ namespace mab
             // clear all the values for the incoming data from the MD
             std::apply([&](auto&&... reg) { ((reg.clear()), ...); }, regs);
 
-            // Add protocol read header [0x41, 0x00]
+            if (!fitsSingleFrame(regs))
+            {
+                std::vector<MDRegisterRef_S> refs;
+                std::apply([&](auto&... reg) { (refs.push_back(MDRegisterRef_S::from(reg)), ...); },
+                           regs);
+                return readRegisterList(refs);
+            }
+
+            // Add protocol read header [frame id, 0x00]
             std::vector<u8> frame;
-            frame.push_back((u8)MdFrameId_E::READ_REGISTER);
+            frame.push_back((u8)registerFrameId(m_candle, false));
             frame.push_back((u8)0x0);
             // Add serialized register data to be read [LSB addr, MSB addr, payload-bytes...]
             std::vector<u8> payload = serializeMDRegisters(regs);
             frame.reserve(frame.size() + payload.size());
             for (auto byte : payload)
                 frame.push_back(byte);
-            auto        readRegResult = transferCanFrame(frame, frame.size());
-            MdFrameId_E frameId       = (MdFrameId_E)readRegResult.first.at(0);
-            if (readRegResult.second != candleTypes::Error_t::OK)
+            auto readRegResult = transferCanFrame(frame, frame.size(), true);
+            if (readRegResult.second != candleTypes::Error_t::OK || readRegResult.first.empty())
             {
                 m_log.error("Error while reading register!");
                 return Error_t::TRANSFER_FAILED;
             }
-            else if (frameId == MdFrameId_E::RESPONSE_ERROR)
+            MdFrameId_E frameId = (MdFrameId_E)readRegResult.first.at(0);
+            if (frameId == MdFrameId_E::RESPONSE_ERROR)
             {
                 // communication ok, but there was problem with parsing/data format/handing
                 mab::MdRegisterAccessErrorCode code =
@@ -371,9 +416,8 @@ namespace mab
             //      m_log.error("Error while parsing response!");
             //      return std::pair(regs, Error_t::TRANSFER_FAILED);
             //  }
-            // delete response header
-            readRegResult.first.erase(readRegResult.first.begin(), readRegResult.first.begin() + 2);
-            bool deserializeFailed = deserializeMDRegisters(readRegResult.first, regs);
+            bool deserializeFailed =
+                deserializeMDRegisters(responsePayload(readRegResult.first), regs);
             if (deserializeFailed)
             {
                 m_log.error("Error while parsing response!");
@@ -383,6 +427,140 @@ namespace mab
             return Error_t::OK;
         }
 
+        /// @brief Read registers known only at runtime. Registers are packed into as few frames as
+        /// possible, which are sent as one batch, and responses are scattered back to the values.
+        /// With CAN 2.0 frames registers larger than a frame are transferred in fragments.
+        /// @param regs References to the registers to be read (overwritten by read)
+        /// @return Error type on failure, REQUEST_INVALID when the MD rejected any of the frames.
+        /// Registers of the other frames are read anyway.
+        Error_t readRegisterList(std::span<const MDRegisterRef_S> regs);
+
+        /// @brief Read registers by address into the m_mdRegisters helper buffer
+        /// @param addresses Addresses of the registers to be read
+        /// @return Error type on failure, REQUEST_INVALID when any address is unknown
+        Error_t readRegisterList(const std::vector<u16>& addresses);
+
+        /// @brief Write registers known only at runtime, packed into as few frames as possible
+        /// @param regs References to the registers to be written
+        /// @return Error type on failure
+        Error_t writeRegisterList(std::span<const MDRegisterRef_S> regs);
+
+        /// @brief Enable cache of the values acknowledged by the drive. Synchronous writes of
+        /// unchanged values are skipped and repeated writes of a register in one batch are
+        /// coalesced. Cache is dropped on reset, factory config restore and any write error.
+        /// Copies of this MD share the cache.
+        ///
+        /// With the cache enabled writeRegisters() goes through writeRegisterList(), so the
+        /// registers left after filtering may be split into several frames sent as one batch. The
+        /// drive is given m_timeout to respond either way.
+        void enableRegisterCache(const bool enable)
+        {
+            if (!enable)
+                m_registerCache.reset();
+            else if (m_registerCache == nullptr)
+                m_registerCache = std::make_shared<RegisterCache>();
+        }
+
+        /// @brief Forget all the cached values, for when the drive could have been changed by
+        /// other means
+        void invalidateRegisterCache()
+        {
+            if (m_registerCache != nullptr)
+                m_registerCache->invalidateAll();
+        }
+
+        /// @return Cache statistics, empty if the cache is disabled
+        std::optional<RegisterCache::Stats_S> getRegisterCacheStats() const
+        {
+            if (m_registerCache == nullptr)
+                return std::nullopt;
+            return m_registerCache->getStats();
+        }
+
+        /// @brief Registers carried by a single register frame
+        struct RegisterFrame_S
+        {
+            std::vector<size_t> regs;        ///< Indices of whole registers or the fragmented one
+            u16                 offset = 0;  ///< Offset of the fragment within the value
+            u16                 length = 0;  ///< Length of the fragment, 0 for whole registers
+
+            bool isFragment() const
+            {
+                return length != 0;
+            }
+        };
+
+        /// @brief Register list access split into request frames, so that requests to many drives
+        /// can be transferred together (see MDBatch)
+        struct RegisterRequest_S
+        {
+            std::vector<MDRegisterRef_S> regs;
+            bool                         write = false;
+            std::vector<RegisterFrame_S> plan;
+            std::vector<std::vector<u8>> frames;  ///< Payloads to be sent to this MD
+        };
+
+        /// @brief Check access levels of the registers and build the request frames. The register
+        /// cache is not consulted, all of the registers are written.
+        /// @param write Write the values of the registers instead of reading them
+        /// @return REQUEST_INVALID on access violation or when a register can not be transferred
+        Error_t prepareRegisterRequest(std::span<const MDRegisterRef_S> regs,
+                                       const bool                       write,
+                                       RegisterRequest_S&               request) const;
+
+        /// @brief Scatter responses of a read into the register values or check the
+        /// acknowledgements of a write, the register cache is updated accordingly
+        /// @param responses Response to every request frame, in order
+        Error_t completeRegisterRequest(
+            const RegisterRequest_S&                                request,
+            const std::vector<std::pair<std::vector<u8>, Error_t>>& responses) const;
+
+        /// @brief Split registers into frames using first fit decreasing bin packing
+        /// @param regs Registers to be packed
+        /// @param payloadCapacity Bytes available for registers in a single frame
+        /// @return Indices of registers for every frame, empty if any register does not fit a
+        /// frame on its own
+        static std::vector<std::vector<size_t>> packRegisterFrames(
+            std::span<const MDRegisterRef_S> regs, const size_t payloadCapacity);
+
+        /// @brief Read registers of a precompiled frame, intended for control loops reading the
+        /// same registers every cycle
+        /// @param frame Frame to be read, its values are overwritten by the response
+        /// @return Error type on failure
+        template <MDRegisterAddress_E... Addresses>
+        Error_t readRegisterFrame(RegisterFrame<Addresses...>& frame)
+        {
+            auto frameBytes = frame.prepareRead(registerFrameId(m_candle, false));
+            auto result     = transferCanFrame(
+                std::vector<u8>(frameBytes.begin(), frameBytes.end()), frameBytes.size(), true);
+            if (result.second != candleTypes::Error_t::OK)
+                return Error_t::TRANSFER_FAILED;
+            if (!frame.parseRead(result.first))
+                return responseError(result.first);
+            return Error_t::OK;
+        }
+
+        /// @brief Write registers of a precompiled frame, intended for control loops writing the
+        /// same registers every cycle
+        /// @param frame Frame with the values to be written
+        /// @return Error type on failure
+        template <MDRegisterAddress_E... Addresses>
+        Error_t writeRegisterFrame(RegisterFrame<Addresses...>& frame)
+        {
+            if (m_registerCache != nullptr)
+                (m_registerCache->invalidate((u16)Addresses), ...);
+            auto frameBytes = frame.prepareWrite(registerFrameId(m_candle, true));
+            auto result     = transferCanFrame(
+                std::vector<u8>(frameBytes.begin(), frameBytes.end()), frameBytes.size());
+            if (result.second != candleTypes::Error_t::OK)
+                return Error_t::TRANSFER_FAILED;
+            if (result.first.empty() ||
+                (result.first[0] != frameBytes[0] &&
+                 result.first[0] != (u8)MdFrameId_E::RESPONSE_LEGACY))
+                return responseError(result.first);
+            return Error_t::OK;
+        }
+
         /// @brief Request read of registers from the memory of the MD asynchronously (up to 64
         /// bytes per request)
         /// @tparam ...T Type of registers
@@ -409,9 +587,9 @@ namespace mab
         {
             m_log.debug("Submitting register read frame...");
 
-            // Add protocol read header [0x41, 0x00]
+            // Add protocol read header [frame id, 0x00]
             std::vector<u8> frame;
-            frame.push_back((u8)MdFrameId_E::READ_REGISTER);
+            frame.push_back((u8)registerFrameId(m_candle, false));
             frame.push_back((u8)0x0);
             // Add serialized register data to be read [LSB addr, MSB addr, payload-bytes...]
             std::vector<u8> payload = serializeMDRegisters(regs);
@@ -433,11 +611,8 @@ namespace mab
                     {
                         return Error_t::TRANSFER_FAILED;
                     }
-                    readRegResult.first.erase(readRegResult.first.begin(),
-                                              readRegResult.first.begin() + 2);
-                    bool deserializeFailed = deserializeMDRegisters(
-                        readRegResult.first,
-                        std::forward<std::tuple<MDRegisterEntry_S<T>&...>&>(regs));
+                    bool deserializeFailed =
+                        deserializeMDRegisters(responsePayload(readRegResult.first), regs);
                     if (deserializeFailed)
                     {
                         return Error_t::TRANSFER_FAILED;
@@ -496,16 +671,31 @@ namespace mab
                 return Error_t::REQUEST_INVALID;
             }
 
+            // the list path converts m_timeout for packed frames, so the drive gets the same
+            // time to respond on both of the paths
+            if (m_registerCache != nullptr || !fitsSingleFrame(regs))
+            {
+                std::vector<MDRegisterRef_S> refs;
+                std::apply([&](auto&... reg) { (refs.push_back(MDRegisterRef_S::from(reg)), ...); },
+                           regs);
+                return writeRegisterList(refs);
+            }
+
             std::vector<u8> frame;
-            frame.push_back((u8)MdFrameId_E::WRITE_REGISTER);
+            frame.push_back((u8)registerFrameId(m_candle, true));
             frame.push_back((u8)0x0);
             auto payload = serializeMDRegisters(regs);
             frame.insert(frame.end(), payload.begin(), payload.end());
             auto readRegResult = transferCanFrame(frame, frame.size());
+            if (readRegResult.second != candleTypes::Error_t::OK || readRegResult.first.empty())
+            {
+                m_log.error("Error while writing register!");
+                return Error_t::TRANSFER_FAILED;
+            }
 
             MdFrameId_E frameId = (MdFrameId_E)readRegResult.first.at(0);
 
-            if (frameId == MdFrameId_E::RESPONSE_LEGACY || frameId == MdFrameId_E::WRITE_REGISTER)
+            if (frameId == MdFrameId_E::RESPONSE_LEGACY || (u8)frameId == frame[0])
                 return Error_t::OK;  // TODO: Possible do smth with received data?
             else if (frameId == MdFrameId_E::RESPONSE_ERROR)
             {
@@ -543,6 +733,12 @@ namespace mab
         {
             m_log.debug("Submitting frame transfer request...");
 
+            // result is not known here, so these registers are sent again on the next sync write
+            if (m_registerCache != nullptr)
+                std::apply([&](auto&... reg)
+                           { (m_registerCache->invalidate(reg.m_regAddress), ...); },
+                           regs);
+
             std::vector<u8> frame;
             frame.push_back((u8)MdFrameId_E::WRITE_REGISTER_LEGACY);
             frame.push_back((u8)0x0);
@@ -564,6 +760,43 @@ namespace mab
                 std::move(writeRegResultFuture));
         }
 
+        /// @brief Write registers to MD memory without waiting for the response (up to 64 bytes
+        /// per request). Intended for streamed setpoints, the frame slot is released as soon as the
+        /// frame is transmitted. Errors on the MD side are not reported, check them with periodic
+        /// reads of the quickStatus register.
+        /// @tparam ...T Register entry underlying type (should be deducible)
+        /// @param ...regs Registry references to be written to the MD
+        /// @return Error if the frame could not be sent
+        template <class... T>
+        inline Error_t writeRegistersUnacknowledged(MDRegisterEntry_S<T>&... regs)
+        {
+            if (m_candle == nullptr)
+            {
+                m_log.error("Candle empty!");
+                return Error_t::NOT_CONNECTED;
+            }
+            if (((regs.m_accessLevel == RegisterAccessLevel_E::RO) || ...))
+            {
+                m_log.error("Attempt to write to read-only registers!");
+                return Error_t::REQUEST_INVALID;
+            }
+
+            // the drive may reject the value, so it can not be cached
+            if (m_registerCache != nullptr)
+                (m_registerCache->invalidate(regs.m_regAddress), ...);
+
+            auto            tuple = std::tuple<MDRegisterEntry_S<T>&...>(regs...);
+            std::vector<u8> frame;
+            frame.push_back((u8)MdFrameId_E::WRITE_REGISTER_LEGACY);
+            frame.push_back((u8)0x0);
+            auto payload = serializeMDRegisters(tuple);
+            frame.insert(frame.end(), payload.begin(), payload.end());
+
+            if (m_candle->sendCANFrameUnacknowledged(m_canId, frame) != candleTypes::Error_t::OK)
+                return Error_t::TRANSFER_FAILED;
+            return Error_t::OK;
+        }
+
         /// @brief Helper method to handle md errors
         /// @return true on failure, false on normal operation
         inline bool isMDError(Error_t err)
@@ -591,11 +824,71 @@ namespace mab
         /// @brief Debugging method to test communication efficiency
         void testLatency();
 
-        static std::vector<canId_t> discoverMDs(Candle* candle);
+        /// @brief Scan the CAN network for MD drives
+        /// @param candle CANdle connected to the network
+        /// @param onFound called as soon as a drive answers, before the scan finishes. Called from
+        /// the probing threads, one call at a time
+        /// @param timeout100us time given to each drive to respond in units of 100 microseconds
+        /// @return CAN ids of all found drives in ascending order
+        static std::vector<canId_t> discoverMDs(Candle*                      candle,
+                                                std::function<void(canId_t)> onFound = nullptr,
+                                                const u16 timeout100us = DISCOVERY_TIMEOUT_100US);
+
+        /// @brief Packed frames kept in flight during discovery
+        static constexpr size_t DISCOVERY_WINDOW = 3;
+        /// @brief Probes awaiting response at once during discovery, each has its own thread
+        static constexpr size_t DISCOVERY_MAX_IN_FLIGHT =
+            CANdleFrameAdapter::FRAME_BUFFER_SIZE * DISCOVERY_WINDOW;
 
       private:
         Candle* const m_candle;
 
+        std::shared_ptr<RegisterCache> m_registerCache;
+
+        /// @brief MDs answer register reads in well under 300 us, so the scan does not wait longer
+        static constexpr u16 DISCOVERY_TIMEOUT_100US = 3;
+        /// @brief Size of [frame id, padding] header of register frames
+        static constexpr size_t REGISTER_FRAME_HEADER_SIZE = 2;
+        /// @brief Size of [frame id, value offset, LSB addr, MSB addr] header of CAN 2.0 frames
+        /// carrying a fragment of a register value
+        static constexpr size_t FRAGMENT_HEADER_SIZE = 4;
+        static constexpr size_t CAN_2_0_FRAME_SIZE   = 8;
+
+        /// @brief Split registers into frames. With CAN 2.0 frames registers that do not fit a
+        /// frame are split into fragments, each sent in its own READ/WRITE_REGISTER_CAN_2_0 frame
+        /// [frame id, value offset, LSB addr, MSB addr, up to 4 value bytes]. The value offset in
+        /// place of the padding byte needs MD firmware that handles fragments, such firmware
+        /// echoes the offset in its response. Fragments not echoed this way fail the request
+        /// with TRANSFER_FAILED, so older firmware can not silently store them at offset 0.
+        /// @return Frames to be sent, empty if any register can not be transferred
+        std::vector<RegisterFrame_S> planRegisterFrames(
+            std::span<const MDRegisterRef_S> regs) const;
+
+        /// @brief Build the request of a planned frame
+        /// @param write Carry the values of the registers instead of placeholders
+        std::vector<u8> serializeRegisterFrame(const RegisterFrame_S&           frame,
+                                               std::span<const MDRegisterRef_S> regs,
+                                               const bool                       write) const;
+
+        /// @brief Report unexpected response to a register access
+        /// @return REQUEST_INVALID if the MD rejected the access, TRANSFER_FAILED otherwise
+        Error_t responseError(const std::vector<u8>& response) const;
+
+        Error_t completeRead(
+            const RegisterRequest_S&                                request,
+            const std::vector<std::pair<std::vector<u8>, Error_t>>& responses) const;
+        Error_t completeWrite(
+            const RegisterRequest_S&                                request,
+            const std::vector<std::pair<std::vector<u8>, Error_t>>& responses) const;
+
+        /// @brief Transfer frames as one batch, through the packed frame pipeline if possible
+        /// @param idempotent frames can be repeated, lost ones are retransmitted
+        std::vector<std::pair<std::vector<u8>, Error_t>> transferFrameBatch(
+            const std::vector<std::vector<u8>>& frames, const bool idempotent);
+
+        static std::vector<canId_t> discoverMDsLegacy(Candle*                      candle,
+                                                      std::function<void(canId_t)> onFound);
+
         inline const Candle* getCandle() const
         {
             if (m_candle != nullptr)
@@ -606,38 +899,72 @@ namespace mab
             return nullptr;
         }
 
+        /// @brief Size of the registers inside of the frame [LSB addr, MSB addr, payload...]
+        template <class... T>
+        static constexpr size_t serializedSize(const std::tuple<MDRegisterEntry_S<T>&...>&)
+        {
+            return ((sizeof(T) + sizeof(u16)) + ... + 0);
+        }
+
+        /// @brief Whether the registers fit a single register frame of the candle, larger sets
+        /// are handled by the register list API
+        template <class... T>
+        bool fitsSingleFrame(const std::tuple<MDRegisterEntry_S<T>&...>& regs) const
+        {
+            return m_candle == nullptr ||
+                   REGISTER_FRAME_HEADER_SIZE + serializedSize(regs) <=
+                       m_candle->getMaxCANFrameSize();
+        }
+
         template <class... T>
         static inline std::vector<u8> serializeMDRegisters(
             std::tuple<MDRegisterEntry_S<T>&...>& regs)
         {
-            std::vector<u8> serialized;
-            std::apply(
-                [&](auto&&... reg)
-                {
-                    ((serialized.insert(serialized.end(),
-                                        reg.getSerializedRegister()->begin(),
-                                        reg.getSerializedRegister()->end())),
-                     ...);
-                },
-                regs);
+            std::vector<u8> serialized(serializedSize(regs));
+            std::span<u8>   cursor(serialized);
+            std::apply([&](auto&... reg) { (reg.serializeInto(cursor), ...); }, regs);
             return serialized;
         }
 
+        /// @brief Decode registers from the response payload (without the frame header)
+        /// @return true on failure
         template <class... T>
-        static inline bool deserializeMDRegisters(std::vector<u8>&                      output,
+        static inline bool deserializeMDRegisters(std::span<const u8>                   payload,
                                                   std::tuple<MDRegisterEntry_S<T>&...>& regs)
         {
-            bool failure            = false;
-            auto performForEachElem = [&](auto& reg)  // Capture by reference to modify 'failure'
-            { failure |= !(reg.setSerializedRegister(output)); };
-
-            std::apply([&](auto&... reg) { (performForEachElem(reg), ...); }, regs);
+            // Whole tuple is present, so it is decoded in one pass with a single bounds check
+            if (payload.size() >= serializedSize(regs))
+            {
+                const u8* cursor = payload.data();
+                return !std::apply(
+                    [&](auto&... reg)
+                    {
+                        return ((reg.setSerializedRegister(cursor) &&
+                                 (cursor += reg.getSerializedSize(), true)) &&
+                                ...);
+                    },
+                    regs);
+            }
 
+            // Truncated response, decode whatever fits to keep the partial data
+            bool failure = false;
+            std::apply([&](auto&... reg)
+                       { ((failure |= !reg.setSerializedRegister(payload)), ...); },
+                       regs);
             return failure;
         }
 
+        /// @brief Get the register payload of the response, empty if the response is too short
+        static std::span<const u8> responsePayload(const std::vector<u8>& response)
+        {
+            if (response.size() < REGISTER_FRAME_HEADER_SIZE)
+                return {};
+            return std::span<const u8>(response).subspan(REGISTER_FRAME_HEADER_SIZE);
+        }
+
+        /// @param idempotent request can be repeated, reads are retransmitted on frame loss
         inline std::pair<std::vector<u8>, mab::candleTypes::Error_t> transferCanFrame(
-            std::vector<u8> frameToSend, size_t responseSize) const
+            std::vector<u8> frameToSend, size_t responseSize, const bool idempotent = false) const
         {
             if (m_candle == nullptr)
             {
@@ -645,7 +972,7 @@ namespace mab
                 return {{}, candleTypes::Error_t::DEVICE_NOT_CONNECTED};
             }
             auto result = getCandle()->transferCANFrame(
-                m_canId, frameToSend, responseSize, m_timeout.value_or(10 /*1 ms - one transfer*/));
+                m_canId, frameToSend, responseSize, getTimeoutMs(), idempotent);
 
             if (result.second != candleTypes::Error_t::OK)
             {
@@ -758,8 +758,26 @@ namespace mab
                 (u8)(edsEntry.getEntryMetaData().address.second.value_or(0))};
             transmitFrame.resize(8, 0);
 
-            auto [response, error] = transferCanOpenFrame(
-                SDO_REQUEST_BASE + m_canId, transmitFrame, transmitFrame.size());
+            // Verify expedited response (bit 1 == 1)
+            auto isUploadResponse = [&](const std::vector<u8>& response)
+            { return response.size() >= transmitFrame.size() && (response[0] & 0x40) != 0; };
+
+            // upload request does not change the node, so it is safe to repeat
+            auto upload = transferCanOpenFrame(
+                SDO_REQUEST_BASE + m_canId, transmitFrame, transmitFrame.size(), true);
+            // invalid response is repeated once, so is a lost frame unless the candle retries it
+            // already. Lost legacy frames are not, their late response could be taken for the
+            // response to the repeat.
+            const bool repeat = upload.second == candleTypes::Error_t::OK
+                                    ? !isUploadResponse(upload.first)
+                                    : m_candle != nullptr && m_candle->usesPackedTransfers() &&
+                                          !m_candle->retriesLostFrames();
+            if (repeat)
+            {
+                upload = transferCanOpenFrame(
+                    SDO_REQUEST_BASE + m_canId, transmitFrame, transmitFrame.size(), true);
+            }
+            const auto& [response, error] = upload;
 
             if (error != candleTypes::Error_t::OK)
             {
@@ -768,18 +786,10 @@ namespace mab
             }
             m_log.debug("Address: 0x%x", edsEntry.getEntryMetaData().address.first);
 
-            // Verify expedited response (bit 1 == 1)
-            if ((response[0] & 0x40) == 0)
+            if (!isUploadResponse(response))
             {
-                // retry
-                response = transferCanOpenFrame(
-                               SDO_REQUEST_BASE + m_canId, transmitFrame, transmitFrame.size())
-                               .first;
-                if ((response[0] & 0x40) == 0)
-                {
-                    m_log.error("Invalid expedited download response");
-                    return Error_t::TRANSFER_FAILED;
-                }
+                m_log.error("Invalid expedited upload response");
+                return Error_t::TRANSFER_FAILED;
             }
 
             // Number of unused bytes (bits 2-3)
@@ -165,16 +165,23 @@ namespace mab
         /// @return A vector of edsObject representing the Object Dictionary
         std::shared_ptr<EDSObjectDictionary> m_od;
 
+        /// @param idempotent request can be repeated, it is retransmitted on frame loss
         inline std::pair<std::vector<u8>, mab::candleTypes::Error_t> transferCanOpenFrame(
-            i16 Id, std::vector<u8> frameToSend, size_t responseSize) const
+            i16             Id,
+            std::vector<u8> frameToSend,
+            size_t          responseSize,
+            const bool      idempotent = false) const
         {
             if (m_candle == nullptr)
             {
                 m_log.error("Candle empty!");
                 return {{}, candleTypes::Error_t::DEVICE_NOT_CONNECTED};
             }
-            auto result = m_candle->transferCANFrame(
-                Id, frameToSend, responseSize, m_timeout.value_or(DEFAULT_CAN_TIMEOUT + 1));
+            auto result = m_candle->transferCANFrame(Id,
+                                                     frameToSend,
+                                                     responseSize,
+                                                     m_timeout.value_or(DEFAULT_CAN_TIMEOUT + 1),
+                                                     idempotent);
 
             if (result.second != candleTypes::Error_t::OK)
             {
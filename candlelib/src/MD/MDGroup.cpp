@@ -0,0 +1,293 @@
+#include "MDGroup.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <string>
+
+namespace mab
+{
+    MDGroup::MDGroup(Candle*                                 candle,
+                     const std::vector<canId_t>&             canIds,
+                     const std::vector<MDRegisterAddress_E>& writeSet,
+                     const std::vector<MDRegisterAddress_E>& readSet)
+        : m_candle(candle)
+    {
+        if (m_candle == nullptr)
+            throw std::runtime_error("MDGroup: Candle empty!");
+
+        const MdFrameId_E writeFrameId = MD::registerFrameId(m_candle, true);
+        std::vector<u8>   writeFrame =
+            buildFrame(writeFrameId, writeSet, RegisterAccessLevel_E::RO, m_writeSlots);
+        m_readFrame = buildFrame(MD::registerFrameId(m_candle, false),
+                                 readSet,
+                                 RegisterAccessLevel_E::WO,
+                                 m_readSlots);
+
+        for (const auto& slot : m_readSlots)
+        {
+            switch ((MDRegisterAddress_E)slot.descriptor->address)
+            {
+                case MDRegisterAddress_E::mainEncoderPosition:
+                    m_positionDesc = slot.descriptor;
+                    break;
+                case MDRegisterAddress_E::mainEncoderVelocity:
+                    m_velocityDesc = slot.descriptor;
+                    break;
+                case MDRegisterAddress_E::motorTorque:
+                    m_torqueDesc = slot.descriptor;
+                    break;
+                case MDRegisterAddress_E::motorTemperature:
+                    m_temperatureDesc = slot.descriptor;
+                    break;
+                case MDRegisterAddress_E::quickStatus:
+                    m_quickStatusDesc = slot.descriptor;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        for (const canId_t canId : canIds)
+        {
+            Drive_S drive;
+            drive.md         = std::make_unique<MD>(canId, m_candle);
+            drive.writeFrame = writeFrame;
+            m_drives.push_back(std::move(drive));
+        }
+
+        const auto* stateDesc = MDRegisters_S::findByAddress((u16)MDRegisterAddress_E::state);
+        std::vector<std::pair<canId_t, std::vector<u8>>> disableFrames;
+        for (const auto& drive : m_drives)
+        {
+            disableFrames.emplace_back(drive.md->m_canId,
+                                       std::vector<u8>{(u8)writeFrameId,
+                                                       0x0,
+                                                       (u8)stateDesc->address,
+                                                       (u8)(stateDesc->address >> 8),
+                                                       DISABLE_STATE,
+                                                       0x0});
+        }
+        m_emergencyStop = m_candle->prepareUrgentTransfer(disableFrames);
+
+        m_state.positions.resize(m_drives.size(), 0.0f);
+        m_state.velocities.resize(m_drives.size(), 0.0f);
+        m_state.torques.resize(m_drives.size(), 0.0f);
+        m_state.temperatures.resize(m_drives.size(), 0.0f);
+        m_state.quickStatus.resize(m_drives.size(), 0);
+        m_state.errors.resize(m_drives.size(), MD::Error_t::UNKNOWN_ERROR);
+    }
+
+    Candle::UrgentReport_S MDGroup::emergencyStop() const
+    {
+        const auto report = m_candle->sendUrgentTransfer(m_emergencyStop);
+        if (report.result != candleTypes::Error_t::OK)
+            m_log.error("Emergency stop failed!");
+        else
+            m_log.info("Emergency stop sent in %lld us", (long long)report.timeToWire.count());
+        return report;
+    }
+
+    std::vector<u8> MDGroup::buildFrame(const MdFrameId_E                       frameId,
+                                        const std::vector<MDRegisterAddress_E>& registers,
+                                        const RegisterAccessLevel_E             forbiddenAccess,
+                                        std::vector<Slot_S>&                    slots) const
+    {
+        std::vector<u8> frame = {(u8)frameId, 0x0};
+        for (const MDRegisterAddress_E address : registers)
+        {
+            const auto* descriptor = MDRegisters_S::findByAddress((u16)address);
+            if (descriptor == nullptr)
+                throw std::runtime_error("MDGroup: Unknown register " +
+                                         std::to_string((u16)address));
+            if (descriptor->access == forbiddenAccess)
+                throw std::runtime_error("MDGroup: Register " + std::string(descriptor->name) +
+                                         " can not be accessed this way");
+
+            frame.push_back(descriptor->address);
+            frame.push_back(descriptor->address >> 8);
+            slots.push_back(Slot_S{descriptor, frame.size()});
+            frame.insert(frame.end(), descriptor->size, 0x0);
+        }
+        if (frame.size() > m_candle->getMaxCANFrameSize())
+            throw std::runtime_error("MDGroup: Registers do not fit into a single CAN frame");
+        return frame;
+    }
+
+    const MDRegisterDescriptor_S* MDGroup::findDescriptor(const size_t              driveIdx,
+                                                          const MDRegisterAddress_E address,
+                                                          const MDRegisterType_E    type,
+                                                          const size_t valueSize) const
+    {
+        const auto* descriptor = MDRegisters_S::findByAddress((u16)address);
+        if (driveIdx >= m_drives.size() || descriptor == nullptr || descriptor->type != type ||
+            descriptor->size != valueSize)
+        {
+            m_log.error("Invalid access to register 0x%04X of drive %zu", (u16)address, driveIdx);
+            return nullptr;
+        }
+        return descriptor;
+    }
+
+    bool MDGroup::isWritten(const MDRegisterAddress_E address) const
+    {
+        return std::any_of(m_writeSlots.begin(),
+                           m_writeSlots.end(),
+                           [address](const Slot_S& slot)
+                           { return slot.descriptor->address == (u16)address; });
+    }
+
+    bool MDGroup::isRead(const MDRegisterAddress_E address) const
+    {
+        return std::any_of(m_readSlots.begin(),
+                           m_readSlots.end(),
+                           [address](const Slot_S& slot)
+                           { return slot.descriptor->address == (u16)address; });
+    }
+
+    MD::Error_t MDGroup::exchange()
+    {
+        using Result_t = std::pair<std::vector<u8>, MD::Error_t>;
+
+        const bool packed = m_candle->getCapabilities().packedFrames;
+        auto       submit = [this, packed](const canId_t          canId,
+                                     const std::vector<u8>& frame) -> std::future<Result_t>
+        {
+            if (packed)
+            {
+                // frames of all the drives are queued before any of them is awaited
+                return std::async(
+                    std::launch::deferred,
+                    [future = m_candle->transferCANFrameAsync(canId, frame, frame.size())]() mutable
+                    {
+                        auto [response, error] = future.get();
+                        return Result_t(std::move(response),
+                                        error == CANdleFrameAdapter::Error_t::OK
+                                            ? MD::Error_t::OK
+                                            : MD::Error_t::TRANSFER_FAILED);
+                    });
+            }
+            return std::async(std::launch::deferred,
+                              [this, canId, &frame]()
+                              {
+                                  auto [response, error] =
+                                      m_candle->transferCANFrame(canId, frame, frame.size());
+                                  return Result_t(std::move(response),
+                                                  error == candleTypes::Error_t::OK
+                                                      ? MD::Error_t::OK
+                                                      : MD::Error_t::TRANSFER_FAILED);
+                              });
+        };
+
+        std::vector<std::future<Result_t>> writes;
+        std::vector<std::future<Result_t>> reads;
+        for (auto& drive : m_drives)
+        {
+            if (!m_writeSlots.empty())
+            {
+                for (const auto& slot : m_writeSlots)
+                    std::memcpy(drive.writeFrame.data() + slot.valueOffset,
+                                drive.values.data.data() + slot.descriptor->offset,
+                                slot.descriptor->size);
+                writes.push_back(submit(drive.md->m_canId, drive.writeFrame));
+            }
+            if (!m_readSlots.empty())
+                reads.push_back(submit(drive.md->m_canId, m_readFrame));
+        }
+
+        MD::Error_t status = MD::Error_t::OK;
+        for (size_t driveIdx = 0; driveIdx < m_drives.size(); driveIdx++)
+        {
+            MD::Error_t error = MD::Error_t::OK;
+            if (!writes.empty())
+            {
+                auto [response, writeError] = writes[driveIdx].get();
+                if (writeError != MD::Error_t::OK || response.empty() ||
+                    (response[0] != m_drives[driveIdx].writeFrame[0] &&
+                     response[0] != (u8)MdFrameId_E::RESPONSE_LEGACY))
+                    error = MD::Error_t::TRANSFER_FAILED;
+            }
+            if (!reads.empty())
+            {
+                auto [response, readError] = reads[driveIdx].get();
+                if (readError != MD::Error_t::OK || !parseRead(m_drives[driveIdx], response))
+                    error = MD::Error_t::TRANSFER_FAILED;
+            }
+
+            m_state.errors[driveIdx] = error;
+            if (error == MD::Error_t::OK)
+                updateState(driveIdx);
+            else
+                status = MD::Error_t::TRANSFER_FAILED;
+        }
+        m_state.timestamp = std::chrono::steady_clock::now();
+
+        if (m_recorder != nullptr)
+        {
+            for (size_t driveIdx = 0; driveIdx < m_drives.size(); driveIdx++)
+            {
+                if (m_state.errors[driveIdx] != MD::Error_t::OK)
+                    continue;
+                m_recorder->record(driveIdx,
+                                   TelemetryRecorder::Sample_S{m_state.timestamp,
+                                                               m_state.positions[driveIdx],
+                                                               m_state.velocities[driveIdx],
+                                                               m_state.torques[driveIdx],
+                                                               m_state.temperatures[driveIdx]});
+            }
+        }
+
+        if (m_mirror != nullptr)
+        {
+            for (size_t driveIdx = 0; driveIdx < m_drives.size(); driveIdx++)
+            {
+                if (m_state.errors[driveIdx] != MD::Error_t::OK)
+                    continue;
+                m_mirror->publish(driveIdx,
+                                  DriveStateMirror::Snapshot_S{m_state.positions[driveIdx],
+                                                               m_state.velocities[driveIdx],
+                                                               m_state.torques[driveIdx],
+                                                               m_state.temperatures[driveIdx],
+                                                               m_state.quickStatus[driveIdx],
+                                                               m_state.timestamp});
+            }
+        }
+
+        if (status != MD::Error_t::OK)
+            m_log.debug("Exchange failed for some of the drives");
+        return status;
+    }
+
+    bool MDGroup::parseRead(Drive_S& drive, const std::vector<u8>& response) const
+    {
+        if (response.size() < m_readFrame.size() || response[0] != m_readFrame[0])
+            return false;
+        for (const auto& slot : m_readSlots)
+        {
+            const size_t addressOffset = slot.valueOffset - sizeof(u16);
+            if (response[addressOffset] != m_readFrame[addressOffset] ||
+                response[addressOffset + 1] != m_readFrame[addressOffset + 1])
+                return false;
+            std::memcpy(drive.values.data.data() + slot.descriptor->offset,
+                        response.data() + slot.valueOffset,
+                        slot.descriptor->size);
+        }
+        return true;
+    }
+
+    void MDGroup::updateState(const size_t driveIdx)
+    {
+        const auto& values = m_drives[driveIdx].values;
+        if (m_positionDesc != nullptr)
+            m_state.positions[driveIdx] = values.get<float>(*m_positionDesc);
+        if (m_velocityDesc != nullptr)
+            m_state.velocities[driveIdx] = values.get<float>(*m_velocityDesc);
+        if (m_torqueDesc != nullptr)
+            m_state.torques[driveIdx] = values.get<float>(*m_torqueDesc);
+        if (m_temperatureDesc != nullptr)
+            m_state.temperatures[driveIdx] = values.get<float>(*m_temperatureDesc);
+        if (m_quickStatusDesc != nullptr)
+            m_state.quickStatus[driveIdx] = values.get<u16>(*m_quickStatusDesc);
+    }
+}  // namespace mab
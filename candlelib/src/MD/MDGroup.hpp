@@ -0,0 +1,193 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MD.hpp"
+#include "candle.hpp"
+#include "logger.hpp"
+#include "mab_types.hpp"
+#include "md_types.hpp"
+#include "drive_state_mirror.hpp"
+#include "telemetry_recorder.hpp"
+
+namespace mab
+{
+    /// @brief Set of MD drives on one CANdle commanded and sampled together. Every drive gets one
+    /// write frame with its setpoints and one read frame with its state. Frames of all the drives
+    /// are submitted at once, so the CANdle packs them into as few USB transfers as possible.
+    class MDGroup
+    {
+      public:
+        /// @brief State of all the drives after the last exchange, one entry per drive
+        struct State_S
+        {
+            std::vector<float> positions;
+            std::vector<float> velocities;
+            std::vector<float> torques;
+            /// @brief Filled only if motorTemperature is a part of the read set
+            std::vector<float> temperatures;
+            std::vector<u16>   quickStatus;
+            /// @brief Result of the exchange with every drive, state of failed drives is stale
+            std::vector<MD::Error_t>              errors;
+            std::chrono::steady_clock::time_point timestamp;
+        };
+
+        /// @brief Registers filling the state block
+        static inline const std::vector<MDRegisterAddress_E> DEFAULT_READ_SET = {
+            MDRegisterAddress_E::mainEncoderPosition,
+            MDRegisterAddress_E::mainEncoderVelocity,
+            MDRegisterAddress_E::motorTorque,
+            MDRegisterAddress_E::quickStatus};
+
+        MDGroup(const MDGroup&)            = delete;
+        MDGroup& operator=(const MDGroup&) = delete;
+
+        /// @brief Create group of drives, throws if the register sets are invalid
+        /// @param candle CANdle all of the drives are connected to
+        /// @param canIds CAN ids of the drives
+        /// @param writeSet registers written to every drive on exchange, may be empty
+        /// @param readSet registers read from every drive on exchange
+        MDGroup(Candle*                                 candle,
+                const std::vector<canId_t>&             canIds,
+                const std::vector<MDRegisterAddress_E>& writeSet,
+                const std::vector<MDRegisterAddress_E>& readSet = DEFAULT_READ_SET);
+
+        /// @brief Number of drives in the group
+        size_t size() const
+        {
+            return m_drives.size();
+        }
+
+        /// @brief Get MD handle of the drive, for operations outside of the cyclic exchange
+        MD& getMd(const size_t driveIdx)
+        {
+            return *m_drives.at(driveIdx).md;
+        }
+
+        /// @brief Set register value to be written on the next exchange
+        /// @return false if the register is not a part of the write set or the value type does
+        /// not match it
+        template <typename T>
+        bool setValue(const size_t driveIdx, const MDRegisterAddress_E address, const T value)
+        {
+            const auto* descriptor =
+                findDescriptor(driveIdx, address, mdRegisterTypeOf<T>(), sizeof(T));
+            if (descriptor == nullptr)
+                return false;
+            if (!isWritten(address))
+            {
+                m_log.error("Register %s is not a part of the write set",
+                            std::string(descriptor->name).c_str());
+                return false;
+            }
+            m_drives[driveIdx].values.set<T>(*descriptor, value);
+            return true;
+        }
+
+        /// @brief Get register value from the last exchange
+        template <typename T>
+        T getValue(const size_t driveIdx, const MDRegisterAddress_E address) const
+        {
+            const auto* descriptor =
+                findDescriptor(driveIdx, address, mdRegisterTypeOf<T>(), sizeof(T));
+            if (descriptor == nullptr)
+                return T{};
+            return m_drives[driveIdx].values.get<T>(*descriptor);
+        }
+
+        /// @brief Check if the register is written to the drives on exchange
+        bool isWritten(const MDRegisterAddress_E address) const;
+
+        /// @brief Check if the register is read from the drives on exchange
+        bool isRead(const MDRegisterAddress_E address) const;
+
+        /// @brief Write the write set and read the read set of all the drives
+        /// @return OK when all the drives responded, TRANSFER_FAILED otherwise (see state errors)
+        MD::Error_t exchange();
+
+        /// @brief Disable all of the drives as fast as possible. Disable frames are built when the
+        /// group is created and go to the CANdle ahead of its other traffic in as few transfers as
+        /// possible. Drives do not acknowledge them, check their state afterwards if needed.
+        Candle::UrgentReport_S emergencyStop() const;
+
+        const State_S& getState() const
+        {
+            return m_state;
+        }
+
+        /// @brief Record state of every drive which responded after each exchange
+        /// @param recorder recorder created with the CAN ids of the group in the same order,
+        /// nullptr to stop recording
+        void setTelemetryRecorder(TelemetryRecorder* recorder)
+        {
+            m_recorder = recorder;
+        }
+
+        /// @brief Publish state of every drive which responded after each exchange, so other
+        /// threads can read it without touching the bus
+        /// @param mirror mirror with at least as many drives as the group, nullptr to stop
+        void setStateMirror(DriveStateMirror* mirror)
+        {
+            m_mirror = mirror;
+        }
+
+      private:
+        /// @brief Register carried by a frame and the offset of its value inside of the frame
+        struct Slot_S
+        {
+            const MDRegisterDescriptor_S* descriptor;
+            size_t                        valueOffset;
+        };
+
+        struct Drive_S
+        {
+            std::unique_ptr<MD>    md;
+            MDRegisterValueBlock_S values;
+            std::vector<u8>        writeFrame;
+        };
+
+        /// @brief Value of the state register disabling the drive, the same as MD::disable() writes
+        static constexpr u8 DISABLE_STATE = 64;
+
+        Logger m_log = Logger(Logger::ProgramLayer_E::TOP, "MD_GROUP");
+
+        Candle* const        m_candle;
+        std::vector<Drive_S> m_drives;
+        std::vector<Slot_S>  m_writeSlots;
+        std::vector<Slot_S>  m_readSlots;
+        /// @brief Read request is the same for every drive
+        std::vector<u8> m_readFrame;
+        State_S         m_state;
+        /// @brief Disable frames of all the drives
+        Candle::UrgentTransfer_S m_emergencyStop;
+
+        /// @brief Descriptors of the registers filling the state block, nullptr if not read
+        const MDRegisterDescriptor_S* m_positionDesc    = nullptr;
+        const MDRegisterDescriptor_S* m_velocityDesc    = nullptr;
+        const MDRegisterDescriptor_S* m_torqueDesc      = nullptr;
+        const MDRegisterDescriptor_S* m_temperatureDesc = nullptr;
+        const MDRegisterDescriptor_S* m_quickStatusDesc = nullptr;
+
+        TelemetryRecorder* m_recorder = nullptr;
+        DriveStateMirror*  m_mirror   = nullptr;
+
+        std::vector<u8> buildFrame(const MdFrameId_E                       frameId,
+                                   const std::vector<MDRegisterAddress_E>& registers,
+                                   const RegisterAccessLevel_E             forbiddenAccess,
+                                   std::vector<Slot_S>&                    slots) const;
+
+        /// @brief Find descriptor of the register, nullptr if the drive does not exist or the
+        /// value type does not match the register
+        const MDRegisterDescriptor_S* findDescriptor(const size_t              driveIdx,
+                                                     const MDRegisterAddress_E address,
+                                                     const MDRegisterType_E    type,
+                                                     const size_t              valueSize) const;
+
+        bool parseRead(Drive_S& drive, const std::vector<u8>& response) const;
+
+        void updateState(const size_t driveIdx);
+    };
+}  // namespace mab
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <array>
+#include <optional>
 #include <unordered_map>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <mab_types.hpp>
@@ -38,6 +41,15 @@ namespace mab
 
         using bitPos = u8;
 
+        /// @brief Constant description of a single status bit
+        template <class Bits>
+        struct StatusBit_S
+        {
+            Bits        bit;
+            const char* name;
+            bool        isError;
+        };
+
         enum class QuickStatusBits : bitPos
         {
             MainEncoderStatus        = 0,
@@ -50,18 +62,17 @@ namespace mab
             TargetPositionReached    = 15
         };
 
-        std::unordered_map<QuickStatusBits, StatusItem_S> quickStatus = {
-            {QuickStatusBits::MainEncoderStatus, StatusItem_S("Main Encoder Status", false)},
-            {QuickStatusBits::OutputEncoderStatus, StatusItem_S("Output Encoder Status", false)},
-            {QuickStatusBits::CalibrationEncoderStatus,
-             StatusItem_S("Calibration Encoder Status", false)},
-            {QuickStatusBits::MosfetBridgeStatus, StatusItem_S("Mosfet Bridge Status", false)},
-            {QuickStatusBits::HardwareStatus, StatusItem_S("Hardware Status", false)},
-            {QuickStatusBits::CommunicationStatus, StatusItem_S("Communication Status", false)},
-            {QuickStatusBits::MotionStatus, StatusItem_S("Motion Status", false)},
-            {QuickStatusBits::TargetPositionReached,
-             StatusItem_S("Target Position Reached", false)}  //
-        };
+        static constexpr std::array<StatusBit_S<QuickStatusBits>, 8> QUICK_STATUS_BITS = {{
+            {QuickStatusBits::MainEncoderStatus, "Main Encoder Status", false},
+            {QuickStatusBits::OutputEncoderStatus, "Output Encoder Status", false},
+            {QuickStatusBits::CalibrationEncoderStatus, "Calibration Encoder Status", false},
+            {QuickStatusBits::MosfetBridgeStatus, "Mosfet Bridge Status", false},
+            {QuickStatusBits::HardwareStatus, "Hardware Status", false},
+            {QuickStatusBits::CommunicationStatus, "Communication Status", false},
+            {QuickStatusBits::MotionStatus, "Motion Status", false},
+            {QuickStatusBits::TargetPositionReached, "Target Position Reached", false}}};
+
+        std::unordered_map<QuickStatusBits, StatusItem_S> quickStatus = toMap(QUICK_STATUS_BITS);
 
         enum class EncoderStatusBits : bitPos
         {
@@ -75,15 +86,18 @@ namespace mab
             WarningLowAccuracy   = 30
         };
 
-        std::unordered_map<EncoderStatusBits, StatusItem_S> encoderStatus = {
-            {EncoderStatusBits::ErrorCommunication, StatusItem_S("Error Communication", true)},
-            {EncoderStatusBits::ErrorWrongDirection, StatusItem_S("Error Wrong Direction", true)},
-            {EncoderStatusBits::ErrorEmptyLUT, StatusItem_S("Error Empty LUT", true)},
-            {EncoderStatusBits::ErrorFaultyLUT, StatusItem_S("Error Faulty LUT", true)},
-            {EncoderStatusBits::ErrorCalibration, StatusItem_S("Error Calibration", true)},
-            {EncoderStatusBits::ErrorPositionInvalid, StatusItem_S("Error Position Invalid", true)},
-            {EncoderStatusBits::ErrorInitialization, StatusItem_S("Error Initialization", true)},
-            {EncoderStatusBits::WarningLowAccuracy, StatusItem_S("Warning Low Accuracy", false)}};
+        static constexpr std::array<StatusBit_S<EncoderStatusBits>, 8> ENCODER_STATUS_BITS = {{
+            {EncoderStatusBits::ErrorCommunication, "Error Communication", true},
+            {EncoderStatusBits::ErrorWrongDirection, "Error Wrong Direction", true},
+            {EncoderStatusBits::ErrorEmptyLUT, "Error Empty LUT", true},
+            {EncoderStatusBits::ErrorFaultyLUT, "Error Faulty LUT", true},
+            {EncoderStatusBits::ErrorCalibration, "Error Calibration", true},
+            {EncoderStatusBits::ErrorPositionInvalid, "Error Position Invalid", true},
+            {EncoderStatusBits::ErrorInitialization, "Error Initialization", true},
+            {EncoderStatusBits::WarningLowAccuracy, "Warning Low Accuracy", false}}};
+
+        std::unordered_map<EncoderStatusBits, StatusItem_S> encoderStatus =
+            toMap(ENCODER_STATUS_BITS);
 
         enum class CalibrationStatusBits : bitPos
         {
@@ -94,14 +108,16 @@ namespace mab
             ErrorSetup             = 4
         };
 
-        std::unordered_map<CalibrationStatusBits, StatusItem_S> calibrationStatus = {
-            {CalibrationStatusBits::ErrorOffsetCalibration,
-             StatusItem_S("Error Offset Calibration", true)},
-            {CalibrationStatusBits::ErrorResistance, StatusItem_S("Error Resistance", true)},
-            {CalibrationStatusBits::ErrorInductance, StatusItem_S("Error Inductance", true)},
-            {CalibrationStatusBits::ErrorPolePairDetection,
-             StatusItem_S("Error Pole Pair Detection", true)},
-            {CalibrationStatusBits::ErrorSetup, StatusItem_S("Error Setup", true)}};
+        static constexpr std::array<StatusBit_S<CalibrationStatusBits>, 5>
+            CALIBRATION_STATUS_BITS = {{
+            {CalibrationStatusBits::ErrorOffsetCalibration, "Error Offset Calibration", true},
+            {CalibrationStatusBits::ErrorResistance, "Error Resistance", true},
+            {CalibrationStatusBits::ErrorInductance, "Error Inductance", true},
+            {CalibrationStatusBits::ErrorPolePairDetection, "Error Pole Pair Detection", true},
+            {CalibrationStatusBits::ErrorSetup, "Error Setup", true}}};
+
+        std::unordered_map<CalibrationStatusBits, StatusItem_S> calibrationStatus =
+            toMap(CALIBRATION_STATUS_BITS);
 
         enum class BridgeStatusBits : bitPos
         {
@@ -110,10 +126,12 @@ namespace mab
             ErrorGeneralFault  = 2
         };
 
-        std::unordered_map<BridgeStatusBits, StatusItem_S> bridgeStatus = {
-            {BridgeStatusBits::ErrorCommunication, StatusItem_S("Error Communication", true)},
-            {BridgeStatusBits::ErrorOvercurrent, StatusItem_S("Error Overcurrent", true)},
-            {BridgeStatusBits::ErrorGeneralFault, StatusItem_S("Error General Fault", true)}};
+        static constexpr std::array<StatusBit_S<BridgeStatusBits>, 3> BRIDGE_STATUS_BITS = {{
+            {BridgeStatusBits::ErrorCommunication, "Error Communication", true},
+            {BridgeStatusBits::ErrorOvercurrent, "Error Overcurrent", true},
+            {BridgeStatusBits::ErrorGeneralFault, "Error General Fault", true}}};
+
+        std::unordered_map<BridgeStatusBits, StatusItem_S> bridgeStatus = toMap(BRIDGE_STATUS_BITS);
 
         enum class HardwareStatusBits : bitPos
         {
@@ -125,25 +143,28 @@ namespace mab
             ErrorADCCurrentOffset  = 5
         };
 
-        std::unordered_map<HardwareStatusBits, StatusItem_S> hardwareStatus = {
-            {HardwareStatusBits::ErrorOverCurrent, StatusItem_S("Error Over Current", true)},
-            {HardwareStatusBits::ErrorOverVoltage, StatusItem_S("Error Over Voltage", true)},
-            {HardwareStatusBits::ErrorUnderVoltage, StatusItem_S("Error Under Voltage", true)},
-            {HardwareStatusBits::ErrorMotorTemperature,
-             StatusItem_S("Error Motor Temperature", true)},
-            {HardwareStatusBits::ErrorMosfetTemperature,
-             StatusItem_S("Error Mosfet Temperature", true)},
-            {HardwareStatusBits::ErrorADCCurrentOffset,
-             StatusItem_S("Error ADC Current Offset", true)}};
+        static constexpr std::array<StatusBit_S<HardwareStatusBits>, 6> HARDWARE_STATUS_BITS = {{
+            {HardwareStatusBits::ErrorOverCurrent, "Error Over Current", true},
+            {HardwareStatusBits::ErrorOverVoltage, "Error Over Voltage", true},
+            {HardwareStatusBits::ErrorUnderVoltage, "Error Under Voltage", true},
+            {HardwareStatusBits::ErrorMotorTemperature, "Error Motor Temperature", true},
+            {HardwareStatusBits::ErrorMosfetTemperature, "Error Mosfet Temperature", true},
+            {HardwareStatusBits::ErrorADCCurrentOffset, "Error ADC Current Offset", true}}};
+
+        std::unordered_map<HardwareStatusBits, StatusItem_S> hardwareStatus =
+            toMap(HARDWARE_STATUS_BITS);
 
         enum class CommunicationStatusBits : bitPos
         {
             WarningCANWatchdog = 30
         };
 
-        std::unordered_map<CommunicationStatusBits, StatusItem_S> communicationStatus = {
-            {CommunicationStatusBits::WarningCANWatchdog,
-             StatusItem_S("Warning CAN Watchdog", false)}};
+        static constexpr std::array<StatusBit_S<CommunicationStatusBits>, 1>
+            COMMUNICATION_STATUS_BITS = {{
+            {CommunicationStatusBits::WarningCANWatchdog, "Warning CAN Watchdog", false}}};
+
+        std::unordered_map<CommunicationStatusBits, StatusItem_S> communicationStatus =
+            toMap(COMMUNICATION_STATUS_BITS);
 
         enum class MotionStatusBits : bitPos
         {
@@ -155,13 +176,101 @@ namespace mab
             WarningPosition     = 27
         };
 
-        std::unordered_map<MotionStatusBits, StatusItem_S> motionStatus = {
-            {MotionStatusBits::ErrorPositionLimit, StatusItem_S("Error Position Limit", true)},
-            {MotionStatusBits::ErrorVelocityLimit, StatusItem_S("Error Velocity Limit", true)},
-            {MotionStatusBits::WarningAcceleration, StatusItem_S("Warning Acceleration", false)},
-            {MotionStatusBits::WarningTorque, StatusItem_S("Warning Torque", false)},
-            {MotionStatusBits::WarningVelocity, StatusItem_S("Warning Velocity", false)},
-            {MotionStatusBits::WarningPosition, StatusItem_S("Warning Position", false)}};
+        static constexpr std::array<StatusBit_S<MotionStatusBits>, 6> MOTION_STATUS_BITS = {{
+            {MotionStatusBits::ErrorPositionLimit, "Error Position Limit", true},
+            {MotionStatusBits::ErrorVelocityLimit, "Error Velocity Limit", true},
+            {MotionStatusBits::WarningAcceleration, "Warning Acceleration", false},
+            {MotionStatusBits::WarningTorque, "Warning Torque", false},
+            {MotionStatusBits::WarningVelocity, "Warning Velocity", false},
+            {MotionStatusBits::WarningPosition, "Warning Position", false}}};
+
+        std::unordered_map<MotionStatusBits, StatusItem_S> motionStatus = toMap(MOTION_STATUS_BITS);
+
+        /// @brief Raw status registers of the drive, decoded on demand without allocations
+        struct StatusWords_S
+        {
+            u16 quickStatus         = 0;
+            u32 mainEncoderStatus   = 0;
+            u32 outputEncoderStatus = 0;
+            u32 calibrationStatus   = 0;
+            u32 bridgeStatus        = 0;
+            u32 hardwareStatus      = 0;
+            u32 communicationStatus = 0;
+            u32 motionStatus        = 0;
+
+            /// @brief true if any of the error bits is set, warnings are ignored
+            constexpr bool hasError() const
+            {
+                return (mainEncoderStatus & errorMask(ENCODER_STATUS_BITS)) ||
+                       (outputEncoderStatus & errorMask(ENCODER_STATUS_BITS)) ||
+                       (calibrationStatus & errorMask(CALIBRATION_STATUS_BITS)) ||
+                       (bridgeStatus & errorMask(BRIDGE_STATUS_BITS)) ||
+                       (hardwareStatus & errorMask(HARDWARE_STATUS_BITS)) ||
+                       (communicationStatus & errorMask(COMMUNICATION_STATUS_BITS)) ||
+                       (motionStatus & errorMask(MOTION_STATUS_BITS));
+            }
+        };
+
+        /// @brief Check a single bit of the status word
+        template <class Bits>
+        static constexpr bool isSet(const u32 word, const Bits bit)
+        {
+            return word & (1u << static_cast<bitPos>(bit));
+        }
+
+        /// @brief Mask of the error bits described by the table
+        template <class Bits, size_t N>
+        static constexpr u32 errorMask(const std::array<StatusBit_S<Bits>, N>& table)
+        {
+            u32 mask = 0;
+            for (const auto& item : table)
+                if (item.isError)
+                    mask |= 1u << static_cast<bitPos>(item.bit);
+            return mask;
+        }
+
+        /// @brief Readable name of the bit, nullptr if it is not described by the table
+        template <class Bits, size_t N>
+        static constexpr const char* nameOf(const std::array<StatusBit_S<Bits>, N>& table,
+                                            const Bits                              bit)
+        {
+            for (const auto& item : table)
+                if (item.bit == bit)
+                    return item.name;
+            return nullptr;
+        }
+
+        /// @brief Find the bit by its readable name
+        template <class Bits, size_t N>
+        static constexpr std::optional<Bits> findBit(
+            const std::array<StatusBit_S<Bits>, N>& table, const std::string_view name)
+        {
+            for (const auto& item : table)
+                if (name == item.name)
+                    return item.bit;
+            return std::nullopt;
+        }
+
+        /// @brief Call func with every bit of the table set in the status word
+        template <class Bits, size_t N, class Func>
+        static constexpr void forEachSet(const u32                               word,
+                                         const std::array<StatusBit_S<Bits>, N>& table,
+                                         Func&&                                  func)
+        {
+            for (const auto& item : table)
+                if (isSet(word, item.bit))
+                    func(item);
+        }
+
+        template <class Bits, size_t N>
+        static std::unordered_map<Bits, StatusItem_S> toMap(
+            const std::array<StatusBit_S<Bits>, N>& table)
+        {
+            std::unordered_map<Bits, StatusItem_S> map;
+            for (const auto& item : table)
+                map.emplace(item.bit, StatusItem_S(item.name, item.isError));
+            return map;
+        }
 
         static std::vector<std::string> getStatusString(
             std::unordered_map<bitPos, StatusItem_S> errors)
@@ -1,11 +1,21 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include <fstream>
 #include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
 
 #include "I_communication_interface.hpp"
 #include "I_communication_interface_mock.hpp"
 #include "MD.hpp"
+#include "MDGroup.hpp"
+#include "telemetry_log.hpp"
+#include "trajectory_streamer.hpp"
+#include "md_batch.hpp"
 #include "candle.hpp"
+#include "crc.hpp"
 #include "gmock/gmock.h"
 #include "mab_types.hpp"
 #include "md_types.hpp"
@@ -33,6 +43,42 @@ class MD_test : public ::testing::Test
     }
 };
 
+namespace
+{
+    /// @brief Attach CANdle supporting packed frames which echoes every CAN frame back, after
+    /// passing its id and data to the respond function. Called from the CANdle transfer thread.
+    mab::Candle* attachEchoingPackedCandle(
+        std::function<void(mab::canId_t, u8*)>      respond,
+        std::function<void(const std::vector<u8>&)> onPacked = nullptr)
+    {
+        const std::vector<u8> versionResponse = {
+            mab::Candle::CandleCommands_t::CANDLE_CONFIG_DATARATE, 0x1, 'r', 1, 4, 2};
+        auto bus = std::make_unique<MockBus>();
+        EXPECT_CALL(*bus, preferPackedTransfers()).WillRepeatedly(Return(true));
+        EXPECT_CALL(*bus, transfer(_, _, _))
+            .WillOnce(
+                Return(std::pair(versionResponse, mab::I_CommunicationInterface::Error_t::OK)))
+            .WillRepeatedly(
+                [respond, onPacked](std::vector<u8> data, const u32, const size_t)
+                {
+                    if (onPacked)
+                        onPacked(data);
+                    // [parse id, ack, count, frames..., CRC32]
+                    const u8 count = data.at(2);
+                    for (size_t frame = 0; frame < count; frame++)
+                    {
+                        u8* dto = data.data() + 3 + frame * mab::CANdleFrame::DTO_SIZE;
+                        respond((mab::canId_t)(dto[0] | (dto[1] << 8)), dto + 6);
+                    }
+                    const u32 crc = Crc::calcCrc((const char*)data.data(), data.size() - 4);
+                    for (size_t byte = 0; byte < 4; byte++)
+                        data[data.size() - 4 + byte] = (u8)(crc >> (8 * byte));
+                    return std::pair(data, mab::I_CommunicationInterface::Error_t::OK);
+                });
+        return mab::attachCandle(mab::CAN_DATARATE_1M, std::move(bus));
+    }
+}  // namespace
+
 TEST_F(MD_test, checkROAccess)
 {
     mab::MDRegisters_S registers;
@@ -80,3 +126,1078 @@ TEST_F(MD_test, checkWOAccess)
     auto resultRead = md.readRegister(registers.runBlink);
     EXPECT_EQ(resultRead, mab::MD::Error_t::REQUEST_INVALID);
 }
+
+TEST_F(MD_test, packRegistersIntoMinimalFrames)
+{
+    mab::MDRegisters_S                registers;
+    std::vector<mab::MDRegisterRef_S> regs;
+    for (int i = 0; i < 30; i++)
+        regs.push_back(mab::MDRegisterRef_S::from(registers.canID));
+
+    EXPECT_EQ(mab::MD::packRegisterFrames(regs, 62).size(), 3);
+    EXPECT_EQ(mab::MD::packRegisterFrames(regs, 6).size(), 30);
+
+    std::vector<mab::MDRegisterRef_S> mixed = {mab::MDRegisterRef_S::from(registers.canID),
+                                               mab::MDRegisterRef_S::from(registers.motorName),
+                                               mab::MDRegisterRef_S::from(registers.motorName),
+                                               mab::MDRegisterRef_S::from(registers.canWatchdog)};
+    // 26 + 26 + 6 + 4 bytes fill exactly one CAN-FD frame
+    EXPECT_EQ(mab::MD::packRegisterFrames(mixed, 62).size(), 1);
+    EXPECT_TRUE(mab::MD::packRegisterFrames(mixed, 6).empty());
+}
+
+TEST_F(MD_test, readRegisterListScattersResponse)
+{
+    mab::MDRegisters_S registers;
+    mab::MD            md(100, m_candle);
+
+    auto            canIdAddr    = registers.canID.m_regAddress;
+    auto            baudrateAddr = registers.canBaudrate.m_regAddress;
+    std::vector<u8> mockReponse  = {0x04,  // header
+                                    0x01,
+                                    0x41,  // payload
+                                    0x00,
+                                    (u8)canIdAddr,
+                                    (u8)(canIdAddr >> 8),
+                                    123,
+                                    0,
+                                    0,
+                                    0,
+                                    (u8)baudrateAddr,
+                                    (u8)(baudrateAddr >> 8),
+                                    0x40,
+                                    0x42,
+                                    0x0F,
+                                    0x00};
+
+    EXPECT_CALL(*m_debugBus, transfer(_, _, _))
+        .Times(1)
+        .WillOnce(Return(std::make_pair(mockReponse, mab::I_CommunicationInterface::Error_t::OK)));
+
+    std::vector<mab::MDRegisterRef_S> regs = {mab::MDRegisterRef_S::from(registers.canID),
+                                              mab::MDRegisterRef_S::from(registers.canBaudrate)};
+    EXPECT_EQ(md.readRegisterList(regs), mab::MD::Error_t::OK);
+    EXPECT_EQ(registers.canID.value, 123u);
+    EXPECT_EQ(registers.canBaudrate.value, 1'000'000u);
+}
+
+TEST_F(MD_test, descriptorTableMatchesRegisters)
+{
+    mab::MDRegisters_S registers;
+
+    size_t idx = 0;
+    registers.forEachRegister(
+        [&](auto& reg)
+        {
+            const auto& descriptor = mab::MD_REGISTER_DESCRIPTORS[idx++];
+            EXPECT_EQ(descriptor.address, reg.m_regAddress);
+            EXPECT_EQ(descriptor.size, reg.getSize());
+            EXPECT_EQ(descriptor.access, reg.m_accessLevel);
+            EXPECT_EQ(descriptor.name, reg.m_name);
+        });
+    EXPECT_EQ(idx, mab::MD_REGISTER_DESCRIPTORS.size());
+
+    static_assert(mab::MDRegisters_S::findByAddress(0x001)->type == mab::MDRegisterType_E::U32);
+    EXPECT_EQ(mab::MDRegisters_S::findByAddress(0xFFFF), nullptr);
+}
+
+TEST_F(MD_test, valueBlockRoundTrip)
+{
+    mab::MDRegisters_S          registers;
+    mab::MDRegisterValueBlock_S block;
+    char                        name[24] = "test";
+
+    registers.canID     = 42;
+    registers.motorKt   = 0.5f;
+    registers.motorName = name;
+    registers.storeValues(block);
+
+    const auto* canId = mab::MDRegisters_S::findByAddress(registers.canID.m_regAddress);
+    ASSERT_NE(canId, nullptr);
+    EXPECT_EQ(block.get<u32>(*canId), 42u);
+    block.set<u32>(*canId, 7);
+
+    mab::MDRegisters_S restored;
+    restored.loadValues(block);
+    EXPECT_EQ(restored.canID.value, 7u);
+    EXPECT_FLOAT_EQ(restored.motorKt.value, 0.5f);
+    EXPECT_STREQ(restored.motorName.value, "test");
+
+    auto ref = block.ref(*canId);
+    EXPECT_EQ(ref.address, registers.canID.m_regAddress);
+    EXPECT_EQ(*static_cast<u32*>(ref.value), 7u);
+}
+
+TEST_F(MD_test, registerLookupByNameAndAddress)
+{
+    mab::MDRegisters_S registers;
+
+    registers.forEachRegister(
+        [&](auto& reg)
+        {
+            const auto* byName    = mab::MDRegisters_S::findByName(reg.m_name);
+            const auto* byAddress = mab::MDRegisters_S::findByAddress(reg.m_regAddress);
+            ASSERT_NE(byName, nullptr);
+            EXPECT_EQ(byName, byAddress);
+            EXPECT_EQ(byName->address, reg.m_regAddress);
+        });
+    EXPECT_EQ(mab::MDRegisters_S::findByName("notARegister"), nullptr);
+    EXPECT_EQ(mab::MDRegisters_S::findByName(""), nullptr);
+
+    registers.canID = 42;
+    auto ref        = registers.getRef(registers.canID.m_regAddress);
+    ASSERT_TRUE(ref.has_value());
+    EXPECT_EQ(ref->value, &registers.canID.value);
+    EXPECT_FALSE(registers.getRef(0xFFFF).has_value());
+}
+
+TEST_F(MD_test, readRegistersDecodesWholeResponse)
+{
+    mab::MDRegisters_S registers;
+    mab::MD            md(100, m_candle);
+
+    const u16       canIdAddr = registers.canID.m_regAddress;
+    const u16       termAddr  = registers.canTermination.m_regAddress;
+    std::vector<u8> response  = {0x04,  // header
+                                 0x01,
+                                 0x41,  // payload
+                                 0x00,
+                                 (u8)canIdAddr,
+                                 (u8)(canIdAddr >> 8),
+                                 12,
+                                 0,
+                                 0,
+                                 0,
+                                 (u8)termAddr,
+                                 (u8)(termAddr >> 8),
+                                 1};
+    std::vector<u8> truncated(response.begin(), response.end() - 1);
+
+    EXPECT_CALL(*m_debugBus, transfer(_, _, _))
+        .Times(2)
+        .WillOnce(Return(std::make_pair(response, mab::I_CommunicationInterface::Error_t::OK)))
+        .WillOnce(Return(std::make_pair(truncated, mab::I_CommunicationInterface::Error_t::OK)));
+
+    EXPECT_EQ(md.readRegisters(registers.canID, registers.canTermination), mab::MD::Error_t::OK);
+    EXPECT_EQ(registers.canID.value, 12u);
+    EXPECT_EQ(registers.canTermination.value, 1);
+
+    // registers that fit are still decoded, but the read is reported as failed
+    EXPECT_EQ(md.readRegisters(registers.canID, registers.canTermination),
+              mab::MD::Error_t::TRANSFER_FAILED);
+    EXPECT_EQ(registers.canID.value, 12u);
+    EXPECT_EQ(registers.canTermination.value, 0);
+}
+
+TEST_F(MD_test, registerFrameUsesConstantLayout)
+{
+    using Addr_E = mab::MDRegisterAddress_E;
+    mab::MD md(100, m_candle);
+
+    mab::RegisterFrame<Addr_E::targetPosition, Addr_E::targetVelocity> setpoint;
+    static_assert(decltype(setpoint)::FRAME_SIZE == 2 + 2 * (2 + sizeof(float)));
+    static_assert(decltype(setpoint)::WRITABLE);
+
+    mab::RegisterFrame<Addr_E::mainEncoderPosition, Addr_E::motorTorque> feedback;
+    static_assert(!decltype(feedback)::WRITABLE);
+
+    setpoint.get<0>() = 1.5f;
+    setpoint.get<1>() = -2.0f;
+    auto  written     = setpoint.prepareWrite();
+    float velocity    = 0.0f;
+    std::memcpy(&velocity, written.data() + 2 + 6 + 2, sizeof(velocity));
+    EXPECT_EQ(written[0], (u8)mab::MdFrameId_E::WRITE_REGISTER);
+    EXPECT_EQ(written[2], 0x50);
+    EXPECT_EQ(written[3], 0x01);
+    EXPECT_FLOAT_EQ(velocity, -2.0f);
+
+    const float     position = 3.25f;
+    const float     torque   = 0.5f;
+    std::vector<u8> response = {0x04, 0x01, 0x41, 0x00, 0x63, 0x00};
+    response.insert(response.end(), (u8*)&position, (u8*)&position + sizeof(position));
+    response.insert(response.end(), {0x64, 0x00});
+    response.insert(response.end(), (u8*)&torque, (u8*)&torque + sizeof(torque));
+    std::vector<u8> misordered = response;
+    std::swap(misordered[4], misordered[10]);
+
+    EXPECT_CALL(*m_debugBus, transfer(_, _, _))
+        .Times(2)
+        .WillOnce(Return(std::make_pair(response, mab::I_CommunicationInterface::Error_t::OK)))
+        .WillOnce(Return(std::make_pair(misordered, mab::I_CommunicationInterface::Error_t::OK)));
+
+    EXPECT_EQ(md.readRegisterFrame(feedback), mab::MD::Error_t::OK);
+    EXPECT_FLOAT_EQ(feedback.get<0>(), position);
+    EXPECT_FLOAT_EQ(feedback.get<1>(), torque);
+    EXPECT_EQ(md.readRegisterFrame(feedback), mab::MD::Error_t::TRANSFER_FAILED);
+}
+
+TEST_F(MD_test, groupExchangeFillsStateBlock)
+{
+    using Addr_E = mab::MDRegisterAddress_E;
+    mab::MDGroup group(m_candle, {10, 11, 12}, {Addr_E::targetPosition});
+
+    auto appendFloat = [](std::vector<u8>& frame, float value)
+    { frame.insert(frame.end(), (u8*)&value, (u8*)&value + sizeof(value)); };
+    auto stateResponse = [&](float position)
+    {
+        std::vector<u8> response = {0x04, 0x01, 0x41, 0x00, 0x63, 0x00};
+        appendFloat(response, position);
+        response.insert(response.end(), {0x62, 0x00});
+        appendFloat(response, 2.0f);
+        response.insert(response.end(), {0x64, 0x00});
+        appendFloat(response, 3.0f);
+        response.insert(response.end(), {0x05, 0x08, 0x01, 0x80});
+        return response;
+    };
+    std::vector<u8> writeResponse = {0x04, 0x01, 0x42, 0x00};
+    std::vector<u8> errorResponse = {0x04, 0x01, 0xA1, 0x01, 0x63, 0x00};
+
+    std::vector<std::vector<u8>> sent;
+    auto                         respond = [&](std::vector<u8> response)
+    {
+        return [&, response](std::vector<u8> data, const u32, const size_t)
+        {
+            sent.push_back(data);
+            return std::make_pair(response, mab::I_CommunicationInterface::Error_t::OK);
+        };
+    };
+    EXPECT_CALL(*m_debugBus, transfer(_, _, _))
+        .Times(6)
+        .WillOnce(respond(writeResponse))
+        .WillOnce(respond(stateResponse(1.0f)))
+        .WillOnce(respond(writeResponse))
+        .WillOnce(respond(errorResponse))
+        .WillOnce(respond(writeResponse))
+        .WillOnce(respond(stateResponse(5.0f)));
+
+    EXPECT_TRUE(group.setValue(2, Addr_E::targetPosition, 0.75f));
+    EXPECT_FALSE(group.setValue(2, Addr_E::targetPosition, (u8)1));
+    EXPECT_FALSE(group.setValue(2, Addr_E::targetPosition, (u32)1));
+    EXPECT_FALSE(group.setValue(2, Addr_E::targetVelocity, 0.75f));
+    EXPECT_EQ(group.exchange(), mab::MD::Error_t::TRANSFER_FAILED);
+
+    const auto& state = group.getState();
+    EXPECT_EQ(state.errors[0], mab::MD::Error_t::OK);
+    EXPECT_EQ(state.errors[1], mab::MD::Error_t::TRANSFER_FAILED);
+    EXPECT_EQ(state.errors[2], mab::MD::Error_t::OK);
+    EXPECT_FLOAT_EQ(state.positions[0], 1.0f);
+    EXPECT_FLOAT_EQ(state.positions[2], 5.0f);
+    EXPECT_FLOAT_EQ(state.velocities[2], 2.0f);
+    EXPECT_FLOAT_EQ(state.torques[2], 3.0f);
+    EXPECT_EQ(state.quickStatus[2], 0x8001);
+    EXPECT_FLOAT_EQ(group.getValue<float>(0, Addr_E::mainEncoderPosition), 1.0f);
+
+    // setpoint of the last drive is patched into its write frame
+    ASSERT_EQ(sent.size(), 6u);
+    float setpoint = 0.0f;
+    std::memcpy(&setpoint, sent[4].data() + sent[4].size() - sizeof(float), sizeof(setpoint));
+    EXPECT_FLOAT_EQ(setpoint, 0.75f);
+}
+
+TEST_F(MD_test, registerCacheSkipsUnchangedWrites)
+{
+    mab::MD md(100, m_candle);
+    md.enableRegisterCache(true);
+
+    std::vector<u8> ack   = {0x04, 0x01, 0x42, 0x00};
+    std::vector<u8> error = {0x04, 0x01, 0xA1, 0x01, 0x00, 0x00};
+    EXPECT_CALL(*m_debugBus, transfer(_, _, _))
+        .Times(4)
+        .WillOnce(Return(std::make_pair(ack, mab::I_CommunicationInterface::Error_t::OK)))
+        .WillOnce(Return(std::make_pair(ack, mab::I_CommunicationInterface::Error_t::OK)))
+        .WillOnce(Return(std::make_pair(error, mab::I_CommunicationInterface::Error_t::OK)))
+        .WillOnce(Return(std::make_pair(ack, mab::I_CommunicationInterface::Error_t::OK)));
+
+    EXPECT_EQ(md.setMaxTorque(1.0f), mab::MD::Error_t::OK);  // sent
+    EXPECT_EQ(md.setMaxTorque(1.0f), mab::MD::Error_t::OK);  // skipped
+    EXPECT_EQ(md.setMaxTorque(2.0f), mab::MD::Error_t::OK);  // sent
+    EXPECT_NE(md.setMaxTorque(3.0f), mab::MD::Error_t::OK);  // rejected, cache dropped
+    EXPECT_EQ(md.setMaxTorque(2.0f), mab::MD::Error_t::OK);  // sent again
+
+    // only the last of the repeated writes goes out, and it is already in the drive
+    mab::MDRegisters_S registers;
+    float              stale = 5.0f;
+    registers.maxTorque      = 2.0f;
+
+    auto first       = mab::MDRegisterRef_S::from(registers.maxTorque);
+    auto overridden  = first;
+    overridden.value = &stale;
+
+    std::vector<mab::MDRegisterRef_S> batch = {overridden, first};
+    EXPECT_EQ(md.writeRegisterList(batch), mab::MD::Error_t::OK);
+
+    auto stats = md.getRegisterCacheStats();
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->skippedWrites, 2u);
+    EXPECT_EQ(stats->skippedBytes, 2u * (2 + sizeof(float)));
+    EXPECT_EQ(stats->coalescedWrites, 1u);
+    EXPECT_EQ(stats->invalidations, 1u);
+
+    // commands are neither skipped nor coalesced
+    mab::RegisterCache                cache;
+    std::vector<mab::MDRegisterRef_S> commands = {mab::MDRegisterRef_S::from(registers.runBlink),
+                                                  mab::MDRegisterRef_S::from(registers.runBlink)};
+    cache.store(commands.front());
+    EXPECT_EQ(cache.filter(commands).size(), 2u);
+    EXPECT_EQ(cache.getStats().coalescedWrites, 0u);
+}
+
+TEST_F(MD_test, unacknowledgedWriteDoesNotWaitForDrive)
+{
+    mab::MDRegisters_S registers;
+    mab::MD            md(100, m_candle);
+    registers.targetPosition = 1.0f;
+
+    // CANdle reports the frame was not answered, which is expected without the node timeout
+    std::vector<u8> noResponse = {0x04, 0x00};
+    std::vector<u8> sent;
+    EXPECT_CALL(*m_debugBus, transfer(_, _, _))
+        .Times(1)
+        .WillOnce(testing::DoAll(
+            testing::SaveArg<0>(&sent),
+            Return(std::make_pair(noResponse, mab::I_CommunicationInterface::Error_t::OK))));
+
+    EXPECT_EQ(md.writeRegistersUnacknowledged(registers.targetPosition), mab::MD::Error_t::OK);
+    ASSERT_GT(sent.size(), 6u);
+    EXPECT_EQ(sent[2], 0);  // no node timeout
+    EXPECT_EQ(sent[5], (u8)mab::MdFrameId_E::WRITE_REGISTER_LEGACY);
+
+    EXPECT_EQ(md.writeRegistersUnacknowledged(registers.quickStatus),
+              mab::MD::Error_t::REQUEST_INVALID);
+
+    mab::MD detached(100, nullptr);
+    EXPECT_EQ(detached.writeRegistersUnacknowledged(registers.targetPosition),
+              mab::MD::Error_t::NOT_CONNECTED);
+}
+
+TEST_F(MD_test, statusWordsDecodeWithoutMaps)
+{
+    using Status = mab::MDStatus;
+    mab::MDRegisters_S registers;
+    mab::MD            md(100, m_candle);
+
+    std::vector<u8> response = {0x04, 0x01, 0x41, 0x00};
+    auto            append   = [&](auto& reg, u32 value)
+    {
+        response.push_back(reg.m_regAddress);
+        response.push_back(reg.m_regAddress >> 8);
+        for (size_t i = 0; i < sizeof(reg.value); i++)
+            response.push_back(value >> (8 * i));
+    };
+    append(registers.quickStatus, 1 << 15);
+    append(registers.mainEncoderStatus, 0);
+    append(registers.auxEncoderStatus, 1u << 30);  // warning only
+    append(registers.calibrationStatus, 0);
+    append(registers.bridgeStatus, 0);
+    append(registers.hardwareStatus, 1 << 3);
+    append(registers.communicationStatus, 0);
+    append(registers.motionStatus, 0);
+
+    EXPECT_CALL(*m_debugBus, transfer(_, _, _))
+        .Times(1)
+        .WillOnce(Return(std::make_pair(response, mab::I_CommunicationInterface::Error_t::OK)));
+
+    auto [words, result] = md.getStatusWords();
+    ASSERT_EQ(result, mab::MD::Error_t::OK);
+    EXPECT_TRUE(Status::isSet(words.quickStatus, Status::QuickStatusBits::TargetPositionReached));
+    EXPECT_TRUE(Status::isSet(words.outputEncoderStatus,
+                              Status::EncoderStatusBits::WarningLowAccuracy));
+    EXPECT_TRUE(words.hasError());
+
+    std::vector<std::string> active;
+    Status::forEachSet(words.hardwareStatus,
+                       Status::HARDWARE_STATUS_BITS,
+                       [&](const auto& bit) { active.push_back(bit.name); });
+    EXPECT_EQ(active, std::vector<std::string>{"Error Motor Temperature"});
+
+    static_assert(Status::findBit(Status::MOTION_STATUS_BITS, "Warning Torque") ==
+                  Status::MotionStatusBits::WarningTorque);
+    static_assert(Status::errorMask(Status::ENCODER_STATUS_BITS) == 0x7F);
+    EXPECT_STREQ(Status::nameOf(Status::QUICK_STATUS_BITS, Status::QuickStatusBits::MotionStatus),
+                 "Motion Status");
+
+    // map based API is still backed by the same tables
+    EXPECT_EQ(md.m_status.hardwareStatus.at(Status::HardwareStatusBits::ErrorOverVoltage).name,
+              "Error Over Voltage");
+    EXPECT_FALSE(Status::StatusWords_S{}.hasError());
+}
+
+TEST_F(MD_test, telemetryRecorderCountsDroppedSamples)
+{
+    const std::string path = testing::TempDir() + "telemetry_test.csv";
+    {
+        mab::TelemetryRecorder recorder(path, {10, 11}, 4);
+
+        mab::TelemetryRecorder::Sample_S sample{std::chrono::steady_clock::now(), 1.0f};
+        // the writer drains at most a few times meanwhile, so most of these do not fit
+        for (int i = 0; i < 1000; i++)
+            recorder.record(0, sample);
+        EXPECT_TRUE(recorder.record(1, sample));
+        EXPECT_FALSE(recorder.record(2, sample));
+
+        recorder.flush();
+        auto stats = recorder.getStats();
+        EXPECT_EQ(stats.recorded + stats.dropped, 1001u);
+        EXPECT_GT(stats.dropped, 0u);
+        EXPECT_EQ(stats.written, stats.recorded);
+    }
+
+    std::ifstream file(path);
+    std::string   line;
+    std::getline(file, line);
+    EXPECT_EQ(line, "timestamp_us,can_id,position,velocity,torque,temperature");
+    ASSERT_TRUE(std::getline(file, line));
+    EXPECT_NE(line.find(",10,1,0,0,0"), std::string::npos);
+}
+
+TEST_F(MD_test, telemetryLogRoundTrip)
+{
+    using namespace mab::telemetryLog;
+    using Addr_E           = mab::MDRegisterAddress_E;
+    const std::string path = testing::TempDir() + "telemetry_test.mtl";
+
+    std::vector<Table_S> tables = {
+        {Source_E::MD, 10, {mdColumn(Addr_E::mainEncoderPosition), mdColumn(Addr_E::quickStatus)}},
+        {Source_E::PDS,
+         100,
+         {pdsColumn(mab::propertyId_E::BUS_VOLTAGE, "busVoltage", Encoding_E::INT_DELTA)}}};
+    EXPECT_EQ(tables[0].columns[0].encoding, Encoding_E::FLOAT_XOR);
+    EXPECT_EQ(tables[0].columns[1].encoding, Encoding_E::INT_DELTA);
+    EXPECT_EQ(tables[0].columns[1].name, "quickStatus");
+
+    constexpr size_t    ROWS = 5000;
+    std::vector<double> positions;
+    {
+        mab::TelemetryLogWriter writer(path, tables, 1024);
+        for (size_t row = 0; row < ROWS; row++)
+        {
+            positions.push_back((float)std::sin(row * 0.001));
+            const std::array<double, 2> md  = {positions.back(), (double)(row % 3 ? 0x8000 : 1)};
+            const std::array<double, 1> pds = {24000.0 + row % 7};
+            EXPECT_TRUE(writer.append(0, 1000 * row, md));
+            if (row % 10 == 0)
+            {
+                EXPECT_TRUE(writer.append(1, 1000 * row + 3, pds));
+            }
+        }
+        const std::array<double, 1> wrongWidth = {0.0};
+        EXPECT_FALSE(writer.append(0, 0, wrongWidth));
+    }
+
+    mab::TelemetryLogReader reader(path);
+    ASSERT_EQ(reader.getTables().size(), 2u);
+    EXPECT_EQ(reader.getTables()[1].canId, 100);
+    EXPECT_EQ(reader.getTables()[1].columns[0].name, "busVoltage");
+
+    size_t                           rows = 0;
+    std::vector<i64>                 timestamps;
+    std::vector<std::vector<double>> columns;
+    for (size_t chunk = 0; chunk < reader.getChunks().size(); chunk++)
+    {
+        const auto& info = reader.getChunks()[chunk];
+        ASSERT_TRUE(reader.readChunk(chunk, timestamps, columns));
+        EXPECT_EQ(timestamps.front(), info.firstTimestamp);
+        EXPECT_EQ(timestamps.back(), info.lastTimestamp);
+        if (info.table != 0)
+            continue;
+        for (size_t row = 0; row < timestamps.size(); row++, rows++)
+        {
+            EXPECT_EQ(timestamps[row], (i64)(1000 * rows));
+            EXPECT_EQ(columns[0][row], positions[rows]);
+            EXPECT_EQ(columns[1][row], rows % 3 ? 0x8000 : 1);
+        }
+    }
+    EXPECT_EQ(rows, ROWS);
+
+    // raw rows would take 8 bytes of timestamp and 8 bytes of values
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    EXPECT_LT((size_t)file.tellg(), ROWS * 16 / 2);
+
+    std::stringstream csv;
+    EXPECT_TRUE(reader.exportCsv(csv, 1));
+    std::string line;
+    std::getline(csv, line);
+    EXPECT_EQ(line, "timestamp_us,can_id,busVoltage");
+    std::getline(csv, line);
+    EXPECT_EQ(line, "3,100,24000");
+}
+
+TEST_F(MD_test, telemetryLogRejectsDamagedFiles)
+{
+    using namespace mab::telemetryLog;
+    using Addr_E           = mab::MDRegisterAddress_E;
+    const std::string path = testing::TempDir() + "telemetry_damaged.mtl";
+    {
+        mab::TelemetryLogWriter writer(path, {{Source_E::MD, 10, {mdColumn(Addr_E::motorTorque)}}});
+        const std::array<double, 1> first = {0.0}, second = {1.0};
+        EXPECT_TRUE(writer.append(0, 0, first));
+        EXPECT_TRUE(writer.append(0, 1000, second));
+    }
+    std::vector<u8> file;
+    {
+        std::ifstream in(path, std::ios::binary);
+        file.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    auto patch = [](std::vector<u8> bytes, const size_t offset, const u64 value, const size_t size)
+    {
+        for (size_t byte = 0; byte < size; byte++)
+            bytes.at(offset + byte) = (u8)(value >> (8 * byte));
+        return bytes;
+    };
+    auto get = [&file](const size_t offset, const size_t size)
+    {
+        u64 value = 0;
+        for (size_t byte = 0; byte < size; byte++)
+            value |= (u64)file.at(offset + byte) << (8 * byte);
+        return value;
+    };
+    auto open = [&path](const std::vector<u8>& bytes)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write((const char*)bytes.data(), bytes.size());
+        out.close();
+        return std::make_unique<mab::TelemetryLogReader>(path);
+    };
+
+    // footer: u64 index offset, u32 chunk count, magic
+    // index entry: u16 table, u32 rows, u64 offset, u64 size, i64 timestamps
+    const size_t footer      = file.size() - sizeof(u64) - sizeof(u32) - INDEX_MAGIC.size();
+    const size_t indexOffset = get(footer, sizeof(u64));
+    const size_t chunkOffset = get(indexOffset + 6, sizeof(u64));
+    ASSERT_EQ(open(file)->getChunks().size(), 1u);
+
+    EXPECT_THROW(open(patch(file, footer, ~0ull - 8, sizeof(u64))), std::runtime_error);
+    EXPECT_THROW(open(patch(file, indexOffset + 2, 0xFFFFFFFF, sizeof(u32))), std::runtime_error);
+    EXPECT_THROW(open(patch(file, indexOffset + 6, ~0ull - 4, sizeof(u64))), std::runtime_error);
+
+    // chunk: u32 magic, u16 table, u32 rows, then the timestamp and value columns prefixed with
+    // their u32 size. The second value is stored with a new window of leading zeros and length,
+    // which gets leading zeros of 31 here.
+    const size_t values = chunkOffset + 10 + sizeof(u32) + get(chunkOffset + 10, sizeof(u32));
+    const size_t window = values + sizeof(u32) + sizeof(u32);
+    ASSERT_EQ(file.at(window) & 0xC0, 0xC0);
+    auto damaged = open(patch(file, window, 0xFE, 1));
+    std::vector<i64>                 timestamps;
+    std::vector<std::vector<double>> columns;
+    EXPECT_FALSE(damaged->readChunk(0, timestamps, columns));
+}
+
+TEST_F(MD_test, trajectoryStreamerInterpolatesAndCountsUnderruns)
+{
+    using Addr_E = mab::MDRegisterAddress_E;
+    using namespace std::chrono_literals;
+
+    // quadratic is reproduced exactly between the interior samples
+    auto curve = mab::Trajectory::fromSamples({0.0, 1.0, 4.0, 9.0, 16.0}, 1ms);
+    EXPECT_DOUBLE_EQ(curve.duration(), 0.004);
+    EXPECT_NEAR(curve.sample(0.0015).position, 2.25, 1e-9);
+    EXPECT_NEAR(curve.sample(0.0025).velocity, 5000.0, 1e-6);
+    EXPECT_DOUBLE_EQ(curve.sample(-1.0).position, 0.0);
+    EXPECT_DOUBLE_EQ(curve.sample(1.0).position, 16.0);
+    EXPECT_TRUE(mab::Trajectory::fromSamples({1.0}, 1ms).empty());
+
+    mab::MDGroup group(m_candle, {10, 11}, {Addr_E::targetPosition});
+    // writes are acknowledged, reads are echoed with all of the values zero
+    EXPECT_CALL(*m_debugBus, transfer(_, _, _))
+        .WillRepeatedly(
+            [](std::vector<u8> data, const u32, const size_t)
+            {
+                std::vector<u8> response = {0x04, 0x01};
+                response.insert(response.end(), data.begin() + 5, data.end());
+                return std::make_pair(response, mab::I_CommunicationInterface::Error_t::OK);
+            });
+
+    mab::TrajectoryStreamer streamer(group, 1ms);
+    std::vector<size_t>     lowDrives;
+    streamer.setLowWatermark(1500us, [&](size_t driveIdx) { lowDrives.push_back(driveIdx); });
+    streamer.setPhaseOffset(1, 1ms);
+    auto ramp = mab::Trajectory::fromSamples({0.0, 1.0, 2.0, 3.0}, 1ms);
+    EXPECT_TRUE(streamer.append(0, ramp, true));
+    EXPECT_TRUE(streamer.append(1, ramp));
+    EXPECT_FALSE(streamer.append(2, ramp));
+
+    // second drive follows the same ramp one cycle later
+    const std::vector<std::array<float, 2>> expected = {
+        {0.0f, 0.0f}, {1.0f, 0.0f}, {2.0f, 1.0f}, {3.0f, 2.0f}, {3.0f, 3.0f}, {3.0f, 3.0f}};
+    for (const auto& setpoints : expected)
+    {
+        EXPECT_EQ(streamer.step(), mab::MD::Error_t::OK);
+        EXPECT_NEAR(group.getValue<float>(0, Addr_E::targetPosition), setpoints[0], 1e-5);
+        EXPECT_NEAR(group.getValue<float>(1, Addr_E::targetPosition), setpoints[1], 1e-5);
+    }
+
+    auto stats = streamer.getStats();
+    EXPECT_EQ(stats.cycles, expected.size());
+    EXPECT_EQ(stats.failedExchanges, 0u);
+    EXPECT_EQ(stats.underruns[0], 0u);
+    EXPECT_GT(stats.underruns[1], 0u);
+    EXPECT_EQ(lowDrives, std::vector<size_t>{1});
+    EXPECT_FALSE(streamer.finished());
+
+    // late data continues from the held position without jumping back in time
+    EXPECT_TRUE(streamer.append(1, mab::Trajectory::fromSamples({3.0, 4.0}, 1ms), true));
+    EXPECT_EQ(streamer.run(), mab::MD::Error_t::OK);
+    EXPECT_TRUE(streamer.finished());
+    EXPECT_NEAR(group.getValue<float>(1, Addr_E::targetPosition), 4.0f, 1e-5);
+}
+
+TEST_F(MD_test, trajectoryStreamerHoldsMeasuredPosition)
+{
+    using Addr_E = mab::MDRegisterAddress_E;
+    using namespace std::chrono_literals;
+
+    mab::MDGroup noPositionRead(m_candle, {10}, {Addr_E::targetPosition}, {Addr_E::quickStatus});
+    EXPECT_THROW(mab::TrajectoryStreamer(noPositionRead, 1ms), std::runtime_error);
+    mab::MDGroup noPositionWrite(m_candle, {10}, {Addr_E::targetVelocity});
+    EXPECT_THROW(mab::TrajectoryStreamer(noPositionWrite, 1ms), std::runtime_error);
+
+    // the drive reports the same position to every read
+    const float                  position = 1.25f;
+    std::vector<std::vector<u8>> writes;
+    EXPECT_CALL(*m_debugBus, transfer(_, _, _))
+        .WillRepeatedly(
+            [&](std::vector<u8> data, const u32, const size_t)
+            {
+                std::vector<u8> response = {0x04, 0x01};
+                response.insert(response.end(), data.begin() + 5, data.end());
+                if (response[2] == (u8)mab::MdFrameId_E::WRITE_REGISTER)
+                    writes.push_back(response);
+                else
+                    std::memcpy(response.data() + 6, &position, sizeof(position));
+                return std::make_pair(response, mab::I_CommunicationInterface::Error_t::OK);
+            });
+
+    mab::MDGroup            group(m_candle, {10}, {Addr_E::targetPosition});
+    mab::TrajectoryStreamer streamer(group, 1ms);
+    EXPECT_EQ(streamer.step(), mab::MD::Error_t::OK);
+    EXPECT_FLOAT_EQ(group.getValue<float>(0, Addr_E::targetPosition), position);
+    ASSERT_EQ(writes.size(), 1u);
+    float written = 0.0f;
+    std::memcpy(&written, writes[0].data() + 6, sizeof(written));
+    EXPECT_FLOAT_EQ(written, position);
+}
+
+TEST_F(MD_test, groupEmergencyStopSendsPreparedDisableFrames)
+{
+    mab::MDGroup group(m_candle, {10, 11, 12}, {});
+
+    std::vector<std::vector<u8>> sent;
+    EXPECT_CALL(*m_debugBus, transfer(_, _, _))
+        .Times(3)
+        .WillRepeatedly(
+            [&](std::vector<u8> data, const u32, const size_t)
+            {
+                sent.push_back(data);
+                return std::make_pair(std::vector<u8>{0x04, 0x00},
+                                      mab::I_CommunicationInterface::Error_t::OK);
+            });
+
+    auto report = group.emergencyStop();
+    EXPECT_EQ(report.result, mab::candleTypes::Error_t::OK);
+    EXPECT_GE(report.timeToWire.count(), 0);
+
+    // legacy frames with zero timeout writing state = 64 (disable)
+    ASSERT_EQ(sent.size(), 3u);
+    for (size_t driveIdx = 0; driveIdx < sent.size(); driveIdx++)
+    {
+        const std::vector<u8> expected = {
+            0x04, 6, 0, (u8)(10 + driveIdx), 0x00, 0x42, 0x00, 0x42, 0x01, 64, 0x00};
+        EXPECT_EQ(sent[driveIdx], expected);
+    }
+}
+
+TEST_F(MD_test, stateMirrorSnapshotsAreConsistent)
+{
+    mab::DriveStateMirror             mirror(2);
+    mab::DriveStateMirror::Snapshot_S snapshot;
+    EXPECT_FALSE(mirror.read(0, snapshot));
+    EXPECT_FALSE(mirror.read(2, snapshot));
+
+    // every field of a publication is derived from the same counter, so a torn read would show
+    constexpr u32            PUBLICATIONS = 200000;
+    std::atomic_bool         done{false};
+    std::atomic<u64>         tornReads{0};
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < 3; reader++)
+    {
+        readers.emplace_back(
+            [&]()
+            {
+                mab::DriveStateMirror::Snapshot_S seen;
+                while (!done.load())
+                {
+                    if (!mirror.read(1, seen))
+                        continue;
+                    if (seen.velocity != 2 * seen.position || seen.torque != 3 * seen.position ||
+                        seen.quickStatus != (u16)seen.position ||
+                        seen.updates != (u64)seen.position)
+                        tornReads++;
+                }
+            });
+    }
+    for (u32 i = 1; i <= PUBLICATIONS; i++)
+    {
+        const float value = (float)i;
+        mirror.publish(
+            1, {value, 2 * value, 3 * value, 0.0f, (u16)i, std::chrono::steady_clock::now()});
+    }
+    done.store(true);
+    for (auto& reader : readers)
+        reader.join();
+    EXPECT_EQ(tornReads.load(), 0u);
+}
+
+TEST_F(MD_test, groupExchangePublishesToStateMirror)
+{
+    mab::MDGroup          group(m_candle, {10}, {});
+    mab::DriveStateMirror mirror(group.size());
+    group.setStateMirror(&mirror);
+
+    std::vector<u8> response = {0x04, 0x01, 0x41, 0x00, 0x63, 0x00};
+    auto appendFloat = [&](float value)
+    { response.insert(response.end(), (u8*)&value, (u8*)&value + sizeof(value)); };
+    appendFloat(1.5f);
+    response.insert(response.end(), {0x62, 0x00});
+    appendFloat(2.0f);
+    response.insert(response.end(), {0x64, 0x00});
+    appendFloat(3.0f);
+    response.insert(response.end(), {0x05, 0x08, 0x01, 0x80});
+    EXPECT_CALL(*m_debugBus, transfer(_, _, _))
+        .Times(1)
+        .WillOnce(Return(std::make_pair(response, mab::I_CommunicationInterface::Error_t::OK)));
+
+    EXPECT_EQ(group.exchange(), mab::MD::Error_t::OK);
+    mab::DriveStateMirror::Snapshot_S snapshot;
+    ASSERT_TRUE(mirror.read(0, snapshot));
+    EXPECT_FLOAT_EQ(snapshot.position, 1.5f);
+    EXPECT_FLOAT_EQ(snapshot.torque, 3.0f);
+    EXPECT_EQ(snapshot.quickStatus, 0x8001);
+    EXPECT_EQ(snapshot.timestamp, group.getState().timestamp);
+    EXPECT_EQ(snapshot.updates, 1u);
+}
+
+TEST_F(MD_test, classicCanFramesFragmentLargeRegisters)
+{
+    auto         bus      = std::make_unique<MockBus>();
+    MockBus*     classic  = bus.get();
+    mab::Candle* candle20 = mab::attachCandle(mab::CAN_DATARATE_1M, std::move(bus), true);
+    mab::MD      md(100, candle20);
+
+    mab::MDRegisters_S registers;
+    // drive memory, firmware knows the size of every register
+    std::map<u16, std::vector<u8>> memory = {
+        {registers.motorName.m_regAddress, std::vector<u8>(sizeof(registers.motorName.value))},
+        {registers.canID.m_regAddress, std::vector<u8>(sizeof(registers.canID.value))}};
+
+    std::vector<std::vector<u8>> sent;
+    EXPECT_CALL(*classic, transfer(_, _, _))
+        .WillRepeatedly(
+            [&](std::vector<u8> data, const u32, const size_t)
+            {
+                std::vector<u8> payload(data.begin() + 5, data.end());
+                sent.push_back(payload);
+                const bool write  = payload[0] == (u8)mab::MdFrameId_E::WRITE_REGISTER_CAN_2_0;
+                const u8   offset = payload[1];
+                for (size_t i = 2; i + 2 <= payload.size();)
+                {
+                    auto&        value  = memory.at((u16)(payload[i] | (payload[i + 1] << 8)));
+                    const size_t length = std::min(value.size() - offset, payload.size() - i - 2);
+                    for (size_t byte = 0; byte < length; byte++)
+                    {
+                        if (write)
+                            value[offset + byte] = payload[i + 2 + byte];
+                        else
+                            payload[i + 2 + byte] = value[offset + byte];
+                    }
+                    i += 2 + length;
+                }
+                payload.insert(payload.begin(), {0x04, 0x01});
+                return std::make_pair(payload, mab::I_CommunicationInterface::Error_t::OK);
+            });
+
+    const std::string name = "classic bus drive 42";
+    std::memcpy(registers.motorName.value, name.c_str(), name.size() + 1);
+    registers.canID = 55;
+    EXPECT_EQ(md.writeRegisters(registers.motorName, registers.canID), mab::MD::Error_t::OK);
+
+    // 24 byte name split into 4 byte fragments, the id in its own frame
+    ASSERT_EQ(sent.size(), 7u);
+    for (const auto& frame : sent)
+    {
+        EXPECT_LE(frame.size(), 8u);
+        EXPECT_EQ(frame[0], (u8)mab::MdFrameId_E::WRITE_REGISTER_CAN_2_0);
+    }
+
+    mab::MDRegisters_S readBack;
+    sent.clear();
+    EXPECT_EQ(md.readRegisters(readBack.motorName, readBack.canID), mab::MD::Error_t::OK);
+    EXPECT_EQ(sent.size(), 7u);
+    EXPECT_EQ(sent.front()[0], (u8)mab::MdFrameId_E::READ_REGISTER_CAN_2_0);
+    EXPECT_STREQ(readBack.motorName.value, name.c_str());
+    EXPECT_EQ(readBack.canID.value, 55u);
+
+    // registers fitting a single frame go the same way
+    sent.clear();
+    readBack.canID = 56;
+    EXPECT_EQ(md.writeRegisters(readBack.canID), mab::MD::Error_t::OK);
+    EXPECT_EQ(md.readRegisters(registers.canID), mab::MD::Error_t::OK);
+    ASSERT_EQ(sent.size(), 2u);
+    EXPECT_EQ(sent[0][0], (u8)mab::MdFrameId_E::WRITE_REGISTER_CAN_2_0);
+    EXPECT_EQ(sent[1][0], (u8)mab::MdFrameId_E::READ_REGISTER_CAN_2_0);
+    EXPECT_EQ(registers.canID.value, 56u);
+
+    mab::detachCandle(candle20);
+}
+
+TEST_F(MD_test, classicCanFramesUsedByRegisterFramesAndGroups)
+{
+    using Addr_E = mab::MDRegisterAddress_E;
+
+    auto         bus      = std::make_unique<MockBus>();
+    MockBus*     classic  = bus.get();
+    mab::Candle* candle20 = mab::attachCandle(mab::CAN_DATARATE_1M, std::move(bus), true);
+
+    // drive echoes the request, every read register holds 2.5
+    std::vector<u8> frameIds;
+    EXPECT_CALL(*classic, transfer(_, _, _))
+        .WillRepeatedly(
+            [&](std::vector<u8> data, const u32, const size_t)
+            {
+                std::vector<u8> payload(data.begin() + 5, data.end());
+                frameIds.push_back(payload[0]);
+                if (payload[0] == (u8)mab::MdFrameId_E::READ_REGISTER_CAN_2_0)
+                {
+                    const float value = 2.5f;
+                    std::memcpy(payload.data() + 4, &value, sizeof(value));
+                }
+                payload.insert(payload.begin(), {0x04, 0x01});
+                return std::make_pair(payload, mab::I_CommunicationInterface::Error_t::OK);
+            });
+
+    mab::MD                                        md(100, candle20);
+    mab::RegisterFrame<Addr_E::mainEncoderPosition> feedback;
+    mab::RegisterFrame<Addr_E::targetPosition>      setpoint;
+    EXPECT_EQ(md.readRegisterFrame(feedback), mab::MD::Error_t::OK);
+    EXPECT_FLOAT_EQ(feedback.get<0>(), 2.5f);
+    EXPECT_EQ(md.writeRegisterFrame(setpoint), mab::MD::Error_t::OK);
+
+    mab::MDGroup group(
+        candle20, {10, 11}, {Addr_E::targetPosition}, {Addr_E::mainEncoderPosition});
+    EXPECT_EQ(group.exchange(), mab::MD::Error_t::OK);
+    EXPECT_FLOAT_EQ(group.getState().positions[1], 2.5f);
+    EXPECT_EQ(group.emergencyStop().result, mab::candleTypes::Error_t::OK);
+
+    // register frames, two drives written and read, two disabled
+    const std::vector<u8> expected = {
+        (u8)mab::MdFrameId_E::READ_REGISTER_CAN_2_0,
+        (u8)mab::MdFrameId_E::WRITE_REGISTER_CAN_2_0};
+    ASSERT_EQ(frameIds.size(), 8u);
+    EXPECT_EQ(std::vector<u8>(frameIds.begin(), frameIds.begin() + 2), expected);
+    for (const u8 frameId : frameIds)
+        EXPECT_TRUE(frameId == expected[0] || frameId == expected[1]);
+    EXPECT_EQ(frameIds.back(), expected[1]);
+    mab::detachCandle(candle20);
+}
+
+TEST_F(MD_test, batchCompletesOperationsOfManyDrives)
+{
+    mab::MD                      md100(100, m_candle), md101(101, m_candle);
+    mab::MDRegisters_S           regs100, regs101;
+    std::vector<std::vector<u8>> sent;
+    EXPECT_CALL(*m_debugBus, transfer(_, _, _))
+        .WillRepeatedly(
+            [&](std::vector<u8> data, const u32, const size_t)
+            {
+                sent.push_back(data);
+                const mab::canId_t canId = data[3] | (data[4] << 8);
+                std::vector<u8>   response(data.begin() + 5, data.end());
+                // drive 101 does not answer reads
+                if (canId == 101 && response[0] == (u8)mab::MdFrameId_E::READ_REGISTER)
+                    response = {0x00};
+                // every read register holds 7
+                if (response[0] == (u8)mab::MdFrameId_E::READ_REGISTER)
+                    response[4] = 7;
+                response.insert(response.begin(), {0x04, 0x01});
+                return std::make_pair(response, mab::I_CommunicationInterface::Error_t::OK);
+            });
+
+    mab::MDBatch batch(m_candle, 4);
+    EXPECT_EQ(batch.read(md100, regs100.canID), 0u);
+    EXPECT_EQ(batch.read(md101, regs101.canID), 1u);
+    regs101.runBlink = 1;
+    EXPECT_EQ(batch.write(md101, regs101.runBlink), 2u);
+    // read-only register is rejected without any transfer
+    EXPECT_EQ(batch.write(md100, regs100.firmwareVersion), 3u);
+
+    size_t completions = 0;
+    auto   future      = batch.submit([&](const mab::MDBatch::Results_t&) { completions++; });
+    EXPECT_EQ(batch.size(), 0u);
+    auto results = future.get();
+
+    EXPECT_EQ(completions, 1u);
+    EXPECT_EQ(sent.size(), 3u);
+    ASSERT_EQ(results.size(), 4u);
+    EXPECT_EQ(results[0].canId, 100);
+    EXPECT_EQ(results[0].result, mab::MD::Error_t::OK);
+    EXPECT_EQ(regs100.canID.value, 7u);
+    EXPECT_EQ(results[1].result, mab::MD::Error_t::TRANSFER_FAILED);
+    EXPECT_TRUE(results[2].write);
+    EXPECT_EQ(results[2].result, mab::MD::Error_t::OK);
+    EXPECT_EQ(results[3].result, mab::MD::Error_t::REQUEST_INVALID);
+}
+
+TEST_F(MD_test, absentDriveOverPackedFramesIsNotConnected)
+{
+    // CANdle leaves the slot of a node that did not respond empty, [length, seq, data...]
+    mab::Candle* candle = attachEchoingPackedCandle([](mab::canId_t, u8* data) { data[-2] = 0; });
+    ASSERT_TRUE(candle->usesPackedTransfers());
+
+    mab::MD            md(100, candle);
+    mab::MDRegisters_S registers;
+    EXPECT_EQ(md.init(), mab::MD::Error_t::NOT_CONNECTED);
+    EXPECT_EQ(md.readRegisters(registers.canID), mab::MD::Error_t::TRANSFER_FAILED);
+    registers.runBlink = 1;
+    EXPECT_EQ(md.writeRegisters(registers.runBlink), mab::MD::Error_t::TRANSFER_FAILED);
+    EXPECT_EQ(candle->transferCANFrame(100, {0x41, 0x00, 0x01, 0x00, 0x00}, 5).second,
+              mab::candleTypes::Error_t::CAN_DEVICE_NOT_RESPONDING);
+    EXPECT_EQ(candle->transferCANFramePacked(100, {0x41, 0x00, 0x01, 0x00, 0x00}, 5).second,
+              mab::CANdleFrameAdapter::Error_t::FRAME_LOST);
+    mab::detachCandle(candle);
+}
+
+TEST_F(MD_test, batchKeepsPackedFramesInWindow)
+{
+    constexpr size_t maxInFlight = 3;
+    std::mutex       packedMux;
+    size_t           frames = 0;
+    std::set<u16>    timeouts;
+    // every drive reports its id as the read register
+    mab::Candle* candle = attachEchoingPackedCandle(
+        [](mab::canId_t canId, u8* data)
+        {
+            if (data[0] == (u8)mab::MdFrameId_E::READ_REGISTER)
+                std::memcpy(data + 4, &canId, sizeof(canId));
+        },
+        [&](const std::vector<u8>& packed)
+        {
+            std::unique_lock lock(packedMux);
+            // the frames of the window are all that awaits the responses
+            EXPECT_LE(packed.at(2), maxInFlight);
+            frames += packed.at(2);
+            for (size_t frame = 0; frame < packed.at(2); frame++)
+            {
+                const u8* dto = packed.data() + 3 + frame * mab::CANdleFrame::DTO_SIZE;
+                timeouts.insert(dto[2] | (dto[3] << 8));
+            }
+        });
+    ASSERT_TRUE(candle->usesPackedTransfers());
+
+    std::vector<mab::MD>            mds;
+    std::vector<mab::MDRegisters_S> regs(10);
+    for (mab::canId_t canId = 10; canId < 20; canId++)
+    {
+        mds.emplace_back(canId, candle);
+        mds.back().m_timeout = 3;
+    }
+    mab::MDBatch batch(candle, maxInFlight);
+    for (size_t mdIdx = 0; mdIdx < mds.size(); mdIdx++)
+        batch.read(mds[mdIdx], regs[mdIdx].canID);
+    // drive of another candle is rejected without any transfer
+    mab::MD            other(10, m_candle);
+    mab::MDRegisters_S otherRegs;
+    batch.read(other, otherRegs.canID);
+
+    auto results = batch.submit().get();
+    ASSERT_EQ(results.size(), mds.size() + 1);
+    for (size_t mdIdx = 0; mdIdx < mds.size(); mdIdx++)
+    {
+        EXPECT_EQ(results[mdIdx].result, mab::MD::Error_t::OK);
+        EXPECT_EQ(regs[mdIdx].canID.value, mds[mdIdx].m_canId);
+    }
+    EXPECT_EQ(results.back().result, mab::MD::Error_t::REQUEST_INVALID);
+    EXPECT_EQ(frames, mds.size());
+    // drives are given their own timeout
+    EXPECT_EQ(timeouts, (std::set<u16>{30}));
+    mab::detachCandle(candle);
+}
+
+TEST_F(MD_test, pipelinedDiscoveryKeepsProbesInWindow)
+{
+    std::mutex             probedMux;
+    std::set<mab::canId_t> probed;
+    // drives with id divisible by 5 report hardware version
+    mab::Candle* candle = attachEchoingPackedCandle(
+        [&](mab::canId_t canId, u8* data)
+        {
+            std::unique_lock lock(probedMux);
+            EXPECT_TRUE(probed.insert(canId).second);
+            if (canId % 5 == 0)
+                data[4] = 1;
+        });
+    ASSERT_TRUE(candle->getCapabilities().packedFrames);
+
+    std::set<std::thread::id> probingThreads;
+    std::vector<mab::canId_t> reported;
+    auto                      ids = mab::MD::discoverMDs(candle,
+                                    [&](mab::canId_t id)
+                                    {
+                                        probingThreads.insert(std::this_thread::get_id());
+                                        reported.push_back(id);
+                                    });
+
+    // every id is probed once and only the answering ones are reported
+    EXPECT_EQ(probed.size(), 0x7FFu - 10u);
+    EXPECT_EQ(*probed.begin(), 10);
+    ASSERT_EQ(ids.size(), reported.size());
+    EXPECT_TRUE(std::is_sorted(ids.begin(), ids.end()));
+    EXPECT_EQ(ids.front(), 10);
+    EXPECT_EQ(ids.back(), 0x7FD);
+    for (auto id : ids)
+        EXPECT_EQ(id % 5, 0);
+    EXPECT_EQ(ids.size(), (0x7FDu - 10u) / 5u + 1u);
+
+    // probes are issued by a fixed set of threads, not one per probe
+    EXPECT_LE(probingThreads.size(), mab::MD::DISCOVERY_MAX_IN_FLIGHT);
+    mab::detachCandle(candle);
+}
+
+TEST_F(MD_test, groupExchangeThroughPackedFrames)
+{
+    using Addr_E = mab::MDRegisterAddress_E;
+
+    std::mutex                framesMux;
+    std::vector<mab::canId_t> written, read;
+    // every drive reports its id as the position
+    mab::Candle* candle = attachEchoingPackedCandle(
+        [&](mab::canId_t canId, u8* data)
+        {
+            std::unique_lock lock(framesMux);
+            if (data[0] == (u8)mab::MdFrameId_E::WRITE_REGISTER)
+            {
+                written.push_back(canId);
+                return;
+            }
+            read.push_back(canId);
+            const float position = canId;
+            std::memcpy(data + 4, &position, sizeof(position));
+        });
+    ASSERT_TRUE(candle->getCapabilities().packedFrames);
+
+    mab::MDGroup group(candle, {10, 11, 12, 13}, {Addr_E::targetPosition});
+    for (size_t driveIdx = 0; driveIdx < group.size(); driveIdx++)
+        EXPECT_TRUE(group.setValue(driveIdx, Addr_E::targetPosition, 0.5f));
+    EXPECT_EQ(group.exchange(), mab::MD::Error_t::OK);
+
+    std::sort(written.begin(), written.end());
+    std::sort(read.begin(), read.end());
+    EXPECT_EQ(written, (std::vector<mab::canId_t>{10, 11, 12, 13}));
+    EXPECT_EQ(read, written);
+    const auto& state = group.getState();
+    for (size_t driveIdx = 0; driveIdx < group.size(); driveIdx++)
+    {
+        EXPECT_EQ(state.errors[driveIdx], mab::MD::Error_t::OK);
+        EXPECT_FLOAT_EQ(state.positions[driveIdx], 10.0f + driveIdx);
+    }
+    mab::detachCandle(candle);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "mab_types.hpp"
+
+namespace mab
+{
+    /// @brief Latest state of every drive shared between one writer (the exchange) and any number
+    /// of reader threads. Each drive has its own cache line sized record guarded by a seqlock, so
+    /// readers never block the writer nor each other and always get a consistent snapshot.
+    class DriveStateMirror
+    {
+      public:
+        struct Snapshot_S
+        {
+            float                                 position    = 0.0f;
+            float                                 velocity    = 0.0f;
+            float                                 torque      = 0.0f;
+            float                                 temperature = 0.0f;
+            u16                                   quickStatus = 0;
+            std::chrono::steady_clock::time_point timestamp;
+            u64                                   updates = 0;  ///< Publications so far
+        };
+
+        /// @param drives number of mirrored drives
+        explicit DriveStateMirror(const size_t drives)
+            : m_records(std::make_unique<Record_S[]>(drives)), m_size(drives)
+        {
+        }
+
+        DriveStateMirror(const DriveStateMirror&)            = delete;
+        DriveStateMirror& operator=(const DriveStateMirror&) = delete;
+
+        size_t size() const noexcept
+        {
+            return m_size;
+        }
+
+        /// @brief Store new state of the drive, only one thread may publish
+        void publish(const size_t driveIdx, const Snapshot_S& snapshot) noexcept
+        {
+            if (driveIdx >= m_size)
+                return;
+            Record_S& record = m_records[driveIdx];
+
+            const u32 sequence = record.sequence.load(std::memory_order_relaxed);
+            record.sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            record.position.store(snapshot.position, std::memory_order_relaxed);
+            record.velocity.store(snapshot.velocity, std::memory_order_relaxed);
+            record.torque.store(snapshot.torque, std::memory_order_relaxed);
+            record.temperature.store(snapshot.temperature, std::memory_order_relaxed);
+            record.quickStatus.store(snapshot.quickStatus, std::memory_order_relaxed);
+            record.timestamp.store(snapshot.timestamp.time_since_epoch().count(),
+                                   std::memory_order_relaxed);
+            record.updates.store(record.updates.load(std::memory_order_relaxed) + 1,
+                                 std::memory_order_relaxed);
+
+            record.sequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        /// @brief Get consistent copy of the latest state of the drive, safe from any thread
+        /// @return false if the drive does not exist or was never published
+        bool read(const size_t driveIdx, Snapshot_S& snapshot) const noexcept
+        {
+            if (driveIdx >= m_size)
+                return false;
+            const Record_S& record = m_records[driveIdx];
+
+            u32 before = 0;
+            u32 after  = 0;
+            do
+            {
+                before = record.sequence.load(std::memory_order_acquire);
+                if (before & 1)
+                    continue;  // write in progress
+
+                snapshot.position    = record.position.load(std::memory_order_relaxed);
+                snapshot.velocity    = record.velocity.load(std::memory_order_relaxed);
+                snapshot.torque      = record.torque.load(std::memory_order_relaxed);
+                snapshot.temperature = record.temperature.load(std::memory_order_relaxed);
+                snapshot.quickStatus = record.quickStatus.load(std::memory_order_relaxed);
+                snapshot.timestamp   = std::chrono::steady_clock::time_point(
+                    std::chrono::steady_clock::duration(
+                        record.timestamp.load(std::memory_order_relaxed)));
+                snapshot.updates = record.updates.load(std::memory_order_relaxed);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                after = record.sequence.load(std::memory_order_relaxed);
+            } while ((before & 1) || before != after);
+            return snapshot.updates != 0;
+        }
+
+        /// @brief Snapshots of all the drives, each one is consistent on its own
+        std::vector<Snapshot_S> readAll() const
+        {
+            std::vector<Snapshot_S> snapshots(m_size);
+            for (size_t driveIdx = 0; driveIdx < m_size; driveIdx++)
+                read(driveIdx, snapshots[driveIdx]);
+            return snapshots;
+        }
+
+      private:
+        /// @brief Every field is atomic so the racing reads of the seqlock are well defined,
+        /// relaxed accesses compile to plain loads and stores
+        struct alignas(64) Record_S
+        {
+            std::atomic<u32>                            sequence{0};
+            std::atomic<float>                          position{0.0f};
+            std::atomic<float>                          velocity{0.0f};
+            std::atomic<float>                          torque{0.0f};
+            std::atomic<float>                          temperature{0.0f};
+            std::atomic<u16>                            quickStatus{0};
+            std::atomic<std::chrono::steady_clock::rep> timestamp{0};
+            std::atomic<u64>                            updates{0};
+        };
+        static_assert(sizeof(Record_S) == 64, "Drive record should take exactly one cache line");
+
+        std::unique_ptr<Record_S[]> m_records;
+        const size_t                m_size;
+    };
+}  // namespace mab
@@ -0,0 +1,149 @@
+#include "md_batch.hpp"
+
+#include <algorithm>
+#include <deque>
+
+namespace mab
+{
+    MDBatch::MDBatch(Candle* candle, const size_t maxInFlight)
+        : m_candle(candle), m_maxInFlight(std::max<size_t>(maxInFlight, 1))
+    {
+    }
+
+    size_t MDBatch::read(const MD& md, std::span<const MDRegisterRef_S> regs)
+    {
+        return add(md, regs, false);
+    }
+
+    size_t MDBatch::write(const MD& md, std::span<const MDRegisterRef_S> regs)
+    {
+        return add(md, regs, true);
+    }
+
+    size_t MDBatch::add(const MD& md, std::span<const MDRegisterRef_S> regs, const bool write)
+    {
+        Pending_S operation{&md, {}, MD::Error_t::OK};
+        operation.prepared      = md.prepareRegisterRequest(regs, write, operation.request);
+        operation.request.write = write;
+        if (m_candle == nullptr)
+            operation.prepared = MD::Error_t::NOT_CONNECTED;
+        else if (!md.isAttachedTo(m_candle))
+        {
+            // frames of the drive would go out through the wrong bus
+            m_log.error("MD %d is attached to another candle than the batch!", md.m_canId);
+            operation.prepared = MD::Error_t::REQUEST_INVALID;
+        }
+        m_operations.push_back(std::move(operation));
+        return m_operations.size() - 1;
+    }
+
+    std::future<MDBatch::Results_t> MDBatch::submit(Callback_t onComplete)
+    {
+        m_log.debug("Submitting batch of %zu operations", m_operations.size());
+        auto completion = std::async(std::launch::async,
+                                     [candle      = m_candle,
+                                      maxInFlight = m_maxInFlight,
+                                      operations  = std::move(m_operations),
+                                      onComplete  = std::move(onComplete)]() mutable
+                                     {
+                                         Results_t results =
+                                             execute(candle, maxInFlight, operations);
+                                         if (onComplete)
+                                             onComplete(results);
+                                         return results;
+                                     });
+        m_operations.clear();
+        return completion;
+    }
+
+    MDBatch::Results_t MDBatch::execute(Candle*                 candle,
+                                        const size_t            maxInFlight,
+                                        std::vector<Pending_S>& operations)
+    {
+        using Response_t = std::pair<std::vector<u8>, MD::Error_t>;
+
+        const Response_t                     notSent = {{}, MD::Error_t::TRANSFER_FAILED};
+        std::vector<std::vector<Response_t>> responses(operations.size());
+        for (size_t opIdx = 0; opIdx < operations.size(); opIdx++)
+            responses[opIdx].resize(operations[opIdx].request.frames.size(), notSent);
+
+        if (candle != nullptr && candle->usesPackedTransfers())
+        {
+            // frames submitted before waiting are packed together by the adapter, the window
+            // bounds how many of them await responses at once
+            struct InFlight_S
+            {
+                size_t opIdx;
+                size_t frameIdx;
+                std::future<std::pair<std::vector<u8>, CANdleFrameAdapter::Error_t>> future;
+            };
+            std::deque<InFlight_S> window;
+            auto                   retire = [&]()
+            {
+                auto [response, error] = window.front().future.get();
+                responses[window.front().opIdx][window.front().frameIdx] =
+                    std::make_pair(std::move(response),
+                                   error == CANdleFrameAdapter::Error_t::OK
+                                       ? MD::Error_t::OK
+                                       : MD::Error_t::TRANSFER_FAILED);
+                window.pop_front();
+            };
+            for (size_t opIdx = 0; opIdx < operations.size(); opIdx++)
+            {
+                const auto& operation = operations[opIdx];
+                if (operation.prepared != MD::Error_t::OK)
+                    continue;
+                const auto& frames = operation.request.frames;
+                for (size_t frameIdx = 0; frameIdx < frames.size(); frameIdx++)
+                {
+                    if (window.size() >= maxInFlight)
+                        retire();
+                    window.push_back(InFlight_S{
+                        opIdx,
+                        frameIdx,
+                        candle->transferCANFrameAsync(operation.md->m_canId,
+                                                      frames[frameIdx],
+                                                      frames[frameIdx].size(),
+                                                      operation.md->getTimeout100us(),
+                                                      !operation.request.write)});
+                }
+            }
+            while (!window.empty())
+                retire();
+        }
+        else if (candle != nullptr)
+        {
+            for (size_t opIdx = 0; opIdx < operations.size(); opIdx++)
+            {
+                const auto& operation = operations[opIdx];
+                if (operation.prepared != MD::Error_t::OK)
+                    continue;
+                const auto& frames = operation.request.frames;
+                for (size_t frameIdx = 0; frameIdx < frames.size(); frameIdx++)
+                {
+                    auto [response, error] = candle->transferCANFrame(operation.md->m_canId,
+                                                                      frames[frameIdx],
+                                                                      frames[frameIdx].size(),
+                                                                      operation.md->getTimeoutMs(),
+                                                                      !operation.request.write);
+                    responses[opIdx][frameIdx] = std::make_pair(
+                        std::move(response),
+                        error == candleTypes::Error_t::OK ? MD::Error_t::OK
+                                                          : MD::Error_t::TRANSFER_FAILED);
+                }
+            }
+        }
+
+        Results_t results;
+        results.reserve(operations.size());
+        for (size_t opIdx = 0; opIdx < operations.size(); opIdx++)
+        {
+            auto&       operation = operations[opIdx];
+            MD::Error_t result    = operation.prepared;
+            if (result == MD::Error_t::OK)
+                result = operation.md->completeRegisterRequest(operation.request, responses[opIdx]);
+            results.push_back(Operation_S{operation.md->m_canId, operation.request.write, result});
+        }
+        return results;
+    }
+}  // namespace mab
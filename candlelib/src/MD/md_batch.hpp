@@ -0,0 +1,101 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include <span>
+#include <vector>
+
+#include "MD.hpp"
+#include "candle.hpp"
+#include "logger.hpp"
+#include "mab_types.hpp"
+#include "md_types.hpp"
+
+namespace mab
+{
+    /// @brief Collects register reads and writes of many drives and transfers them as one batch
+    /// with a single completion. Frames are kept in flight through the packed frame pipeline up to
+    /// a limit, so large batches do not overload the frame adapter.
+    ///
+    /// Register values are read into / written from the referenced register entries. The entries
+    /// and the drives have to stay alive until the batch completes.
+    class MDBatch
+    {
+      public:
+        /// @brief Result of a single read or write added to the batch
+        struct Operation_S
+        {
+            canId_t     canId  = 0;
+            bool        write  = false;
+            MD::Error_t result = MD::Error_t::UNKNOWN_ERROR;
+        };
+
+        using Results_t  = std::vector<Operation_S>;
+        using Callback_t = std::function<void(const Results_t&)>;
+
+        /// @brief Frames awaiting response at once, well below the point where the adapter starts
+        /// dropping them
+        static constexpr size_t DEFAULT_MAX_IN_FLIGHT = 16;
+
+        /// @param candle candle the drives of the batch are attached to
+        /// @param maxInFlight frames awaiting response at once
+        explicit MDBatch(Candle* candle, const size_t maxInFlight = DEFAULT_MAX_IN_FLIGHT);
+
+        /// @brief Add read of the registers of the drive. Drives attached to another candle than
+        /// the batch complete with REQUEST_INVALID.
+        /// @return Index of the operation in the results
+        size_t read(const MD& md, std::span<const MDRegisterRef_S> regs);
+
+        /// @brief Add write of the registers of the drive, the register cache is not consulted
+        /// @return Index of the operation in the results
+        size_t write(const MD& md, std::span<const MDRegisterRef_S> regs);
+
+        template <class... T>
+        size_t read(const MD& md, MDRegisterEntry_S<T>&... regs)
+        {
+            const std::vector<MDRegisterRef_S> refs = {MDRegisterRef_S::from(regs)...};
+            return read(md, refs);
+        }
+
+        template <class... T>
+        size_t write(const MD& md, MDRegisterEntry_S<T>&... regs)
+        {
+            const std::vector<MDRegisterRef_S> refs = {MDRegisterRef_S::from(regs)...};
+            return write(md, refs);
+        }
+
+        /// @brief Number of operations added since the last submit
+        size_t size() const
+        {
+            return m_operations.size();
+        }
+
+        /// @brief Transfer all of the added operations in the background, the batch is empty
+        /// afterwards and can be filled again
+        /// @param onComplete called from the transferring thread once every operation finished,
+        /// before the future becomes ready
+        /// @return Results of the operations in the order they were added
+        std::future<Results_t> submit(Callback_t onComplete = nullptr);
+
+      private:
+        struct Pending_S
+        {
+            const MD*             md;
+            MD::RegisterRequest_S request;
+            MD::Error_t           prepared;  ///< Operation is not transferred unless OK
+        };
+
+        Logger m_log = Logger(Logger::ProgramLayer_E::TOP, "MD_BATCH");
+
+        Candle* const          m_candle;
+        const size_t           m_maxInFlight;
+        std::vector<Pending_S> m_operations;
+
+        size_t add(const MD& md, std::span<const MDRegisterRef_S> regs, const bool write);
+
+        /// @brief Transfer the frames of all operations and complete them
+        static Results_t execute(Candle*                 candle,
+                                 const size_t            maxInFlight,
+                                 std::vector<Pending_S>& operations);
+    };
+}  // namespace mab
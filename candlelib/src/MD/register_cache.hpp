@@ -0,0 +1,128 @@
+#pragma once
+
+#include <bitset>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "mab_types.hpp"
+#include "md_types.hpp"
+
+namespace mab
+{
+    /// @brief Last values acknowledged by the drive, used to skip writes which would not change
+    /// anything. Only read-write registers are cached, commands (write-only registers) are always
+    /// sent. Safe to share between threads.
+    class RegisterCache
+    {
+      public:
+        struct Stats_S
+        {
+            u64 skippedWrites   = 0;  ///< Registers not sent because the drive already has them
+            u64 skippedBytes    = 0;  ///< Serialized bytes of the skipped registers
+            u64 coalescedWrites = 0;  ///< Registers overridden by a later write in the same batch
+            u64 invalidations   = 0;
+        };
+
+        /// @brief Drop registers which the drive already holds and earlier writes of registers
+        /// written more than once (the last write wins). Commands are kept as they are, writing
+        /// one twice runs it twice.
+        /// @return Registers which have to be sent, in the original order
+        std::vector<MDRegisterRef_S> filter(std::span<const MDRegisterRef_S> regs)
+        {
+            std::unique_lock                            lock(m_mux);
+            std::vector<MDRegisterRef_S>                filtered;
+            std::bitset<MD_REGISTER_DESCRIPTORS.size()> seen;
+            for (auto reg = regs.rbegin(); reg != regs.rend(); reg++)
+            {
+                const auto idx = indexOf(reg->address);
+                if (idx.has_value() && reg->access == RegisterAccessLevel_E::RW)
+                {
+                    if (seen.test(idx.value()))
+                    {
+                        m_stats.coalescedWrites++;
+                        continue;
+                    }
+                    seen.set(idx.value());
+                    if (isCached(idx.value(), *reg))
+                    {
+                        m_stats.skippedWrites++;
+                        m_stats.skippedBytes += reg->getSerializedSize();
+                        continue;
+                    }
+                }
+                filtered.push_back(*reg);
+            }
+            return std::vector<MDRegisterRef_S>(filtered.rbegin(), filtered.rend());
+        }
+
+        /// @brief Remember the value acknowledged by the drive
+        void store(const MDRegisterRef_S& reg)
+        {
+            std::unique_lock lock(m_mux);
+            // these commands bring back configuration saved in the drive
+            if (reg.address == (u16)MDRegisterAddress_E::runReset ||
+                reg.address == (u16)MDRegisterAddress_E::runRestoreFactoryConfig)
+            {
+                invalidateAllLocked();
+                return;
+            }
+            const auto idx = indexOf(reg.address);
+            if (!idx.has_value() || reg.access != RegisterAccessLevel_E::RW)
+                return;
+            const auto& descriptor = MD_REGISTER_DESCRIPTORS[idx.value()];
+            std::memcpy(m_values.data.data() + descriptor.offset, reg.value, descriptor.size);
+            m_valid.set(idx.value());
+        }
+
+        void invalidate(const u16 address)
+        {
+            std::unique_lock lock(m_mux);
+            const auto       idx = indexOf(address);
+            if (idx.has_value())
+                m_valid.reset(idx.value());
+        }
+
+        void invalidateAll()
+        {
+            std::unique_lock lock(m_mux);
+            invalidateAllLocked();
+        }
+
+        Stats_S getStats() const
+        {
+            std::unique_lock lock(m_mux);
+            return m_stats;
+        }
+
+      private:
+        MDRegisterValueBlock_S                      m_values;
+        std::bitset<MD_REGISTER_DESCRIPTORS.size()> m_valid;
+        Stats_S                                     m_stats;
+        mutable std::mutex                          m_mux;
+
+        /// @brief Must be called with the mutex locked
+        void invalidateAllLocked()
+        {
+            m_valid.reset();
+            m_stats.invalidations++;
+        }
+
+        static std::optional<size_t> indexOf(const u16 address)
+        {
+            const auto* descriptor = MDRegisters_S::findByAddress(address);
+            if (descriptor == nullptr)
+                return std::nullopt;
+            return descriptor - MD_REGISTER_DESCRIPTORS.data();
+        }
+
+        bool isCached(const size_t idx, const MDRegisterRef_S& reg) const
+        {
+            const auto& descriptor = MD_REGISTER_DESCRIPTORS[idx];
+            return m_valid.test(idx) && reg.size == descriptor.size &&
+                   std::memcmp(m_values.data.data() + descriptor.offset, reg.value, reg.size) == 0;
+        }
+    };
+}  // namespace mab
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "mab_types.hpp"
+#include "md_types.hpp"
+
+namespace mab
+{
+    /// @brief Preformatted register frame for a set of registers known at compile time. Access
+    /// levels and layout are resolved during compilation, so every cycle only the value bytes are
+    /// patched before sending and values are parsed from constant offsets of the response.
+    /// @tparam Addresses registers carried by the frame, in the frame order
+    template <MDRegisterAddress_E... Addresses>
+    class RegisterFrame
+    {
+        template <MDRegisterAddress_E Address>
+        using value_t = typename MDRegisterTraits_S<Address>::value_t;
+
+      public:
+        using Values_t = std::tuple<value_t<Addresses>...>;
+
+        static_assert(sizeof...(Addresses) > 0, "Frame must carry at least one register");
+        static_assert((std::is_arithmetic_v<value_t<Addresses>> && ...),
+                      "Only numeric registers can be a part of the register frame");
+
+        /// @brief [frame id, 0x00]
+        static constexpr size_t HEADER_SIZE = 2;
+        static constexpr size_t FRAME_SIZE =
+            HEADER_SIZE + ((sizeof(u16) + sizeof(value_t<Addresses>)) + ...);
+        static_assert(FRAME_SIZE <= 64, "Registers do not fit into a single CAN FD frame");
+
+        static constexpr bool READABLE =
+            ((MDRegisterTraits_S<Addresses>::ACCESS != RegisterAccessLevel_E::WO) && ...);
+        static constexpr bool WRITABLE =
+            ((MDRegisterTraits_S<Addresses>::ACCESS != RegisterAccessLevel_E::RO) && ...);
+
+        /// @brief Register values, sent on write and overwritten on read
+        Values_t values{};
+
+        constexpr RegisterFrame()
+        {
+            writeAddresses(std::make_index_sequence<sizeof...(Addresses)>{});
+        }
+
+        /// @brief Value of the I-th register of the frame
+        template <size_t I>
+        auto& get()
+        {
+            return std::get<I>(values);
+        }
+
+        /// @brief Patch current values into the frame and get it ready to be sent as a write
+        /// @param frameId write frame id of the bus (see MD::registerFrameId())
+        std::span<const u8> prepareWrite(const MdFrameId_E frameId = MdFrameId_E::WRITE_REGISTER)
+        {
+            static_assert(WRITABLE, "Frame contains read-only registers");
+            m_frame[0] = (u8)frameId;
+            patchValues(std::make_index_sequence<sizeof...(Addresses)>{});
+            return m_frame;
+        }
+
+        /// @brief Get the frame ready to be sent as a read, value bytes are placeholders
+        /// @param frameId read frame id of the bus (see MD::registerFrameId())
+        std::span<const u8> prepareRead(const MdFrameId_E frameId = MdFrameId_E::READ_REGISTER)
+        {
+            static_assert(READABLE, "Frame contains write-only registers");
+            m_frame[0] = (u8)frameId;
+            return m_frame;
+        }
+
+        /// @brief Parse response to the read frame into values
+        /// @return false if the response does not match the frame layout or the frame id of the
+        /// last prepareRead()
+        bool parseRead(std::span<const u8> response)
+        {
+            if (response.size() < FRAME_SIZE || response[0] != m_frame[0])
+                return false;
+            return parseValues(response, std::make_index_sequence<sizeof...(Addresses)>{});
+        }
+
+      private:
+        /// @brief Offset of every register address in the frame, value follows the address
+        static constexpr std::array<size_t, sizeof...(Addresses)> OFFSETS = []()
+        {
+            std::array<size_t, sizeof...(Addresses)> offsets{};
+            size_t                                    offset = HEADER_SIZE;
+            size_t                                    idx    = 0;
+            ((offsets[idx++] = offset, offset += sizeof(u16) + sizeof(value_t<Addresses>)), ...);
+            return offsets;
+        }();
+
+        std::array<u8, FRAME_SIZE> m_frame{};
+
+        template <size_t... I>
+        constexpr void writeAddresses(std::index_sequence<I...>)
+        {
+            ((m_frame[OFFSETS[I]]     = (u8)MDRegisterTraits_S<Addresses>::ADDRESS,
+              m_frame[OFFSETS[I] + 1] = (u8)(MDRegisterTraits_S<Addresses>::ADDRESS >> 8)),
+             ...);
+        }
+
+        template <size_t... I>
+        void patchValues(std::index_sequence<I...>)
+        {
+            (std::memcpy(m_frame.data() + OFFSETS[I] + sizeof(u16),
+                         &std::get<I>(values),
+                         sizeof(std::get<I>(values))),
+             ...);
+        }
+
+        template <size_t... I>
+        bool parseValues(std::span<const u8> response, std::index_sequence<I...>)
+        {
+            // addresses are compared against the preformatted frame before taking the value
+            return ((response[OFFSETS[I]] == m_frame[OFFSETS[I]] &&
+                     response[OFFSETS[I] + 1] == m_frame[OFFSETS[I] + 1] &&
+                     (std::memcpy(&std::get<I>(values),
+                                  response.data() + OFFSETS[I] + sizeof(u16),
+                                  sizeof(std::get<I>(values))),
+                      true)) &&
+                    ...);
+        }
+    };
+}  // namespace mab
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <vector>
+
+namespace mab
+{
+    /// @brief Bounded lock-free queue for exactly one producer and one consumer thread. Storage is
+    /// allocated once on construction, push and pop never allocate nor block.
+    template <class T>
+    class SpscRing
+    {
+      public:
+        /// @param capacity maximum number of queued elements, rounded up to a power of two
+        explicit SpscRing(const size_t capacity)
+            : m_buffer(std::bit_ceil(capacity < 2 ? size_t(2) : capacity)),
+              m_mask(m_buffer.size() - 1)
+        {
+        }
+
+        SpscRing(const SpscRing&)            = delete;
+        SpscRing& operator=(const SpscRing&) = delete;
+
+        /// @brief Producer side
+        /// @return false if the ring is full, element is not queued then
+        bool push(const T& element) noexcept
+        {
+            const size_t head = m_head.load(std::memory_order_relaxed);
+            if (head - m_tail.load(std::memory_order_acquire) == m_buffer.size())
+                return false;
+            m_buffer[head & m_mask] = element;
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// @brief Consumer side
+        /// @return false if the ring is empty
+        bool pop(T& element) noexcept
+        {
+            const size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail == m_head.load(std::memory_order_acquire))
+                return false;
+            element = m_buffer[tail & m_mask];
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t size() const noexcept
+        {
+            return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+        }
+
+        size_t capacity() const noexcept
+        {
+            return m_buffer.size();
+        }
+
+      private:
+        std::vector<T> m_buffer;
+        const size_t   m_mask;
+        // indices grow monotonically, kept on separate cache lines so both sides do not contend
+        alignas(64) std::atomic<size_t> m_head{0};
+        alignas(64) std::atomic<size_t> m_tail{0};
+    };
+}  // namespace mab
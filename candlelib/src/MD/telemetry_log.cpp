@@ -0,0 +1,657 @@
+#include "telemetry_log.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mab
+{
+    namespace
+    {
+        constexpr size_t INDEX_ENTRY_SIZE = sizeof(u16) + sizeof(u32) + 4 * sizeof(u64);
+        constexpr size_t FOOTER_SIZE =
+            sizeof(u64) + sizeof(u32) + telemetryLog::INDEX_MAGIC.size();
+
+        template <typename T>
+        void put(std::vector<u8>& out, const T value)
+        {
+            for (size_t i = 0; i < sizeof(T); i++)
+                out.push_back((u8)((u64)value >> (8 * i)));
+        }
+
+        void putVarint(std::vector<u8>& out, u64 value)
+        {
+            while (value >= 0x80)
+            {
+                out.push_back((u8)(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back((u8)value);
+        }
+
+        constexpr u64 zigzag(const i64 value)
+        {
+            return ((u64)value << 1) ^ (u64)(value >> 63);
+        }
+
+        constexpr i64 unzigzag(const u64 value)
+        {
+            return (i64)(value >> 1) ^ -(i64)(value & 1);
+        }
+
+        /// @brief Bounds checked little endian reader, ok is cleared on the first overrun
+        struct Cursor_S
+        {
+            const u8* ptr;
+            const u8* end;
+            bool      ok = true;
+
+            template <typename T>
+            T get()
+            {
+                if ((size_t)(end - ptr) < sizeof(T))
+                {
+                    ok = false;
+                    return T{};
+                }
+                u64 value = 0;
+                for (size_t i = 0; i < sizeof(T); i++)
+                    value |= (u64)ptr[i] << (8 * i);
+                ptr += sizeof(T);
+                return (T)value;
+            }
+
+            u64 getVarint()
+            {
+                u64 value = 0;
+                for (size_t shift = 0; shift < 64; shift += 7)
+                {
+                    if (ptr == end)
+                        break;
+                    const u8 byte = *ptr++;
+                    value |= (u64)(byte & 0x7F) << shift;
+                    if (!(byte & 0x80))
+                        return value;
+                }
+                ok = false;
+                return 0;
+            }
+        };
+
+        class BitWriter
+        {
+          public:
+            explicit BitWriter(std::vector<u8>& out) : m_out(out)
+            {
+            }
+
+            void write(const u64 value, const u8 count)
+            {
+                for (int bit = count - 1; bit >= 0; bit--)
+                {
+                    m_byte = (u8)((m_byte << 1) | ((value >> bit) & 1));
+                    if (++m_bits == 8)
+                    {
+                        m_out.push_back(m_byte);
+                        m_byte = 0;
+                        m_bits = 0;
+                    }
+                }
+            }
+
+            void flush()
+            {
+                if (m_bits != 0)
+                    m_out.push_back((u8)(m_byte << (8 - m_bits)));
+                m_byte = 0;
+                m_bits = 0;
+            }
+
+          private:
+            std::vector<u8>& m_out;
+            u8               m_byte = 0;
+            u8               m_bits = 0;
+        };
+
+        class BitReader
+        {
+          public:
+            explicit BitReader(std::span<const u8> data) : m_data(data)
+            {
+            }
+
+            bool read(u64& value, const u8 count)
+            {
+                if (m_pos + count > m_data.size() * 8)
+                    return false;
+                value = 0;
+                for (u8 i = 0; i < count; i++, m_pos++)
+                    value = (value << 1) | ((m_data[m_pos / 8] >> (7 - m_pos % 8)) & 1);
+                return true;
+            }
+
+          private:
+            std::span<const u8> m_data;
+            size_t              m_pos = 0;
+        };
+
+        /// @brief Gorilla XOR compression of the f32 representation of the values
+        void encodeFloats(std::vector<u8>& out, const std::vector<double>& values)
+        {
+            BitWriter writer(out);
+            u32       previous         = 0;
+            u8        previousLeading  = 0xFF;  // no window yet
+            u8        previousTrailing = 0;
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                const u32 bits = std::bit_cast<u32>((float)values[i]);
+                if (i == 0)
+                {
+                    writer.write(bits, 32);
+                    previous = bits;
+                    continue;
+                }
+                const u32 xored = bits ^ previous;
+                previous        = bits;
+                if (xored == 0)
+                {
+                    writer.write(0, 1);
+                    continue;
+                }
+                writer.write(1, 1);
+                const u8 leading  = (u8)std::countl_zero(xored);
+                const u8 trailing = (u8)std::countr_zero(xored);
+                if (previousLeading != 0xFF && leading >= previousLeading &&
+                    trailing >= previousTrailing)
+                {
+                    // meaningful bits fit into the window of the previous value
+                    writer.write(0, 1);
+                    writer.write(xored >> previousTrailing,
+                                 32 - previousLeading - previousTrailing);
+                    continue;
+                }
+                const u8 length = 32 - leading - trailing;
+                writer.write(1, 1);
+                writer.write(leading, 5);
+                writer.write(length - 1, 5);
+                writer.write(xored >> trailing, length);
+                previousLeading  = leading;
+                previousTrailing = trailing;
+            }
+            writer.flush();
+        }
+
+        bool decodeFloats(std::span<const u8> data, const size_t rows, std::vector<double>& values)
+        {
+            BitReader reader(data);
+            u64       bits             = 0;
+            u32       previous         = 0;
+            u8        previousLeading  = 0;
+            u8        previousTrailing = 0;
+            for (size_t i = 0; i < rows; i++)
+            {
+                if (i == 0)
+                {
+                    if (!reader.read(bits, 32))
+                        return false;
+                    previous = (u32)bits;
+                    values.push_back(std::bit_cast<float>(previous));
+                    continue;
+                }
+                if (!reader.read(bits, 1))
+                    return false;
+                if (bits == 0)
+                {
+                    values.push_back(std::bit_cast<float>(previous));
+                    continue;
+                }
+                if (!reader.read(bits, 1))
+                    return false;
+                if (bits == 1)
+                {
+                    u64 leading = 0, length = 0;
+                    if (!reader.read(leading, 5) || !reader.read(length, 5) ||
+                        leading + length + 1 > 32)
+                        return false;
+                    previousLeading  = (u8)leading;
+                    previousTrailing = (u8)(32 - leading - (length + 1));
+                }
+                if (!reader.read(bits, 32 - previousLeading - previousTrailing))
+                    return false;
+                previous ^= (u32)(bits << previousTrailing);
+                values.push_back(std::bit_cast<float>(previous));
+            }
+            return true;
+        }
+
+        void encodeIntegers(std::vector<u8>& out, const std::vector<double>& values)
+        {
+            i64 previous = 0;
+            for (const double value : values)
+            {
+                const i64 current = std::llround(value);
+                putVarint(out, zigzag(current - previous));
+                previous = current;
+            }
+        }
+
+        bool decodeIntegers(std::span<const u8>  data,
+                            const size_t         rows,
+                            std::vector<double>& values)
+        {
+            Cursor_S cursor{data.data(), data.data() + data.size()};
+            i64      previous = 0;
+            for (size_t i = 0; i < rows && cursor.ok; i++)
+            {
+                previous += unzigzag(cursor.getVarint());
+                values.push_back((double)previous);
+            }
+            return cursor.ok;
+        }
+
+        void encodeTimestamps(std::vector<u8>& out, const std::vector<i64>& timestamps)
+        {
+            i64 previous      = 0;
+            i64 previousDelta = 0;
+            for (const i64 timestamp : timestamps)
+            {
+                // regular sampling makes most of these zero
+                const i64 delta = timestamp - previous;
+                putVarint(out, zigzag(delta - previousDelta));
+                previous      = timestamp;
+                previousDelta = delta;
+            }
+        }
+
+        bool decodeTimestamps(std::span<const u8> data, const size_t rows, std::vector<i64>& out)
+        {
+            Cursor_S cursor{data.data(), data.data() + data.size()};
+            i64      previous      = 0;
+            i64      previousDelta = 0;
+            for (size_t i = 0; i < rows && cursor.ok; i++)
+            {
+                previousDelta += unzigzag(cursor.getVarint());
+                previous += previousDelta;
+                out.push_back(previous);
+            }
+            return cursor.ok;
+        }
+    }  // namespace
+
+    namespace telemetryLog
+    {
+        Column_S mdColumn(const MDRegisterAddress_E address)
+        {
+            const auto* descriptor = MDRegisters_S::findByAddress((u16)address);
+            if (descriptor == nullptr || descriptor->type == MDRegisterType_E::CHAR_ARRAY)
+                throw std::runtime_error("TelemetryLog: Register " + std::to_string((u16)address) +
+                                         " can not be logged");
+            return Column_S{descriptor->address,
+                            descriptor->type == MDRegisterType_E::F32 ? Encoding_E::FLOAT_XOR
+                                                                      : Encoding_E::INT_DELTA,
+                            std::string(descriptor->name)};
+        }
+
+        Column_S pdsColumn(const propertyId_E property,
+                           const std::string& name,
+                           const Encoding_E   encoding)
+        {
+            return Column_S{(u16)property, encoding, name};
+        }
+    }  // namespace telemetryLog
+
+    TelemetryLogWriter::TelemetryLogWriter(const std::string&                        path,
+                                           const std::vector<telemetryLog::Table_S>& tables,
+                                           const size_t rowsPerChunk)
+        : m_file(path, std::ios::out | std::ios::binary | std::ios::trunc),
+          m_tables(tables),
+          m_rowsPerChunk(std::max<size_t>(rowsPerChunk, 1)),
+          m_pending(tables.size())
+    {
+        if (!m_file.is_open())
+            throw std::runtime_error("TelemetryLogWriter: Could not create " + path);
+
+        std::vector<u8> header(telemetryLog::FILE_MAGIC.begin(), telemetryLog::FILE_MAGIC.end());
+        put<u16>(header, telemetryLog::VERSION);
+        put<u16>(header, m_tables.size());
+        for (size_t table = 0; table < m_tables.size(); table++)
+        {
+            put<u8>(header, (u8)m_tables[table].source);
+            put<u16>(header, m_tables[table].canId);
+            put<u16>(header, m_tables[table].columns.size());
+            for (const auto& column : m_tables[table].columns)
+            {
+                const size_t nameLength = std::min<size_t>(column.name.size(), 0xFF);
+                put<u16>(header, column.id);
+                put<u8>(header, (u8)column.encoding);
+                put<u8>(header, nameLength);
+                header.insert(header.end(), column.name.begin(), column.name.begin() + nameLength);
+            }
+            m_pending[table].columns.resize(m_tables[table].columns.size());
+        }
+        m_file.write((const char*)header.data(), header.size());
+    }
+
+    TelemetryLogWriter::~TelemetryLogWriter()
+    {
+        close();
+    }
+
+    bool TelemetryLogWriter::append(const size_t            table,
+                                    const i64               timestampUs,
+                                    std::span<const double> values)
+    {
+        if (m_closed || table >= m_tables.size() ||
+            values.size() != m_tables[table].columns.size())
+            return false;
+
+        auto& pending = m_pending[table];
+        pending.timestamps.push_back(timestampUs);
+        for (size_t column = 0; column < values.size(); column++)
+            pending.columns[column].push_back(values[column]);
+
+        if (pending.timestamps.size() >= m_rowsPerChunk)
+            writeChunk(table);
+        return true;
+    }
+
+    void TelemetryLogWriter::close()
+    {
+        if (m_closed)
+            return;
+        for (size_t table = 0; table < m_tables.size(); table++)
+            writeChunk(table);
+
+        std::vector<u8> index;
+        for (const auto& chunk : m_chunks)
+        {
+            put<u16>(index, chunk.table);
+            put<u32>(index, chunk.rows);
+            put<u64>(index, chunk.offset);
+            put<u64>(index, chunk.size);
+            put<i64>(index, chunk.firstTimestamp);
+            put<i64>(index, chunk.lastTimestamp);
+        }
+        put<u64>(index, (u64)m_file.tellp());
+        put<u32>(index, m_chunks.size());
+        index.insert(
+            index.end(), telemetryLog::INDEX_MAGIC.begin(), telemetryLog::INDEX_MAGIC.end());
+        m_file.write((const char*)index.data(), index.size());
+        m_file.close();
+        if (m_file.fail())
+            m_log.error("Writing telemetry log failed!");
+        m_closed = true;
+    }
+
+    void TelemetryLogWriter::writeChunk(const size_t table)
+    {
+        auto& pending = m_pending[table];
+        if (pending.timestamps.empty())
+            return;
+
+        std::vector<u8> chunk;
+        std::vector<u8> column;
+        put<u32>(chunk, telemetryLog::CHUNK_MAGIC);
+        put<u16>(chunk, table);
+        put<u32>(chunk, pending.timestamps.size());
+
+        encodeTimestamps(column, pending.timestamps);
+        put<u32>(chunk, column.size());
+        chunk.insert(chunk.end(), column.begin(), column.end());
+        for (size_t idx = 0; idx < pending.columns.size(); idx++)
+        {
+            column.clear();
+            if (m_tables[table].columns[idx].encoding == telemetryLog::Encoding_E::FLOAT_XOR)
+                encodeFloats(column, pending.columns[idx]);
+            else
+                encodeIntegers(column, pending.columns[idx]);
+            put<u32>(chunk, column.size());
+            chunk.insert(chunk.end(), column.begin(), column.end());
+        }
+
+        m_chunks.push_back(telemetryLog::ChunkInfo_S{(u16)table,
+                                                     (u32)pending.timestamps.size(),
+                                                     (u64)m_file.tellp(),
+                                                     chunk.size(),
+                                                     pending.timestamps.front(),
+                                                     pending.timestamps.back()});
+        m_file.write((const char*)chunk.data(), chunk.size());
+
+        pending.timestamps.clear();
+        for (auto& values : pending.columns)
+            values.clear();
+    }
+
+    TelemetryLogReader::TelemetryLogReader(const std::string& path)
+    {
+#ifdef _WIN32
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+            throw std::runtime_error("TelemetryLogReader: Could not open " + path);
+        m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("TelemetryLogReader: Could not open " + path);
+        struct stat fileStat;
+        if (::fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+        {
+            void* mapping = ::mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED)
+            {
+                m_data = (const u8*)mapping;
+                m_size = fileStat.st_size;
+            }
+        }
+        ::close(fd);
+        if (m_data == nullptr)
+            throw std::runtime_error("TelemetryLogReader: Could not map " + path);
+#endif
+        try
+        {
+            parse();
+        }
+        catch (...)
+        {
+            unmap();
+            throw;
+        }
+    }
+
+    TelemetryLogReader::~TelemetryLogReader()
+    {
+        unmap();
+    }
+
+    void TelemetryLogReader::unmap()
+    {
+#ifndef _WIN32
+        if (m_data != nullptr)
+            ::munmap((void*)m_data, m_size);
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    void TelemetryLogReader::parse()
+    {
+        const size_t magicSize = telemetryLog::FILE_MAGIC.size();
+        if (m_size < magicSize + FOOTER_SIZE ||
+            std::memcmp(m_data, telemetryLog::FILE_MAGIC.data(), magicSize) != 0 ||
+            std::memcmp(m_data + m_size - telemetryLog::INDEX_MAGIC.size(),
+                        telemetryLog::INDEX_MAGIC.data(),
+                        telemetryLog::INDEX_MAGIC.size()) != 0)
+            throw std::runtime_error("TelemetryLogReader: Not a telemetry log");
+
+        Cursor_S header{m_data + magicSize, m_data + m_size};
+        if (header.get<u16>() != telemetryLog::VERSION)
+            throw std::runtime_error("TelemetryLogReader: Unsupported version");
+        const u16 tableCount = header.get<u16>();
+        for (u16 table = 0; table < tableCount && header.ok; table++)
+        {
+            telemetryLog::Table_S entry;
+            entry.source      = (telemetryLog::Source_E)header.get<u8>();
+            entry.canId       = header.get<u16>();
+            const u16 columns = header.get<u16>();
+            for (u16 column = 0; column < columns && header.ok; column++)
+            {
+                telemetryLog::Column_S col;
+                col.id              = header.get<u16>();
+                col.encoding        = (telemetryLog::Encoding_E)header.get<u8>();
+                const u8 nameLength = header.get<u8>();
+                if ((size_t)(header.end - header.ptr) < nameLength)
+                {
+                    header.ok = false;
+                    break;
+                }
+                col.name.assign((const char*)header.ptr, nameLength);
+                header.ptr += nameLength;
+                entry.columns.push_back(std::move(col));
+            }
+            m_tables.push_back(std::move(entry));
+        }
+
+        Cursor_S  footer{m_data + m_size - FOOTER_SIZE, m_data + m_size};
+        const u64 indexOffset = footer.get<u64>();
+        const u32 chunkCount  = footer.get<u32>();
+        // written so that none of the sums can overflow on damaged offsets
+        const u64 indexEnd = m_size - FOOTER_SIZE;
+        if (!header.ok || indexOffset > indexEnd ||
+            indexEnd - indexOffset != (u64)chunkCount * INDEX_ENTRY_SIZE)
+            throw std::runtime_error("TelemetryLogReader: Damaged header or index");
+
+        Cursor_S index{m_data + indexOffset, m_data + indexEnd};
+        for (u32 chunk = 0; chunk < chunkCount; chunk++)
+        {
+            telemetryLog::ChunkInfo_S info;
+            info.table          = index.get<u16>();
+            info.rows           = index.get<u32>();
+            info.offset         = index.get<u64>();
+            info.size           = index.get<u64>();
+            info.firstTimestamp = index.get<i64>();
+            info.lastTimestamp  = index.get<i64>();
+            if (info.table >= m_tables.size() || info.offset > indexOffset ||
+                info.size > indexOffset - info.offset)
+                throw std::runtime_error("TelemetryLogReader: Damaged index");
+            // every row takes at least a byte of the timestamp column, so the row count is
+            // bounded before anything is allocated for it
+            if (info.rows > info.size)
+                throw std::runtime_error("TelemetryLogReader: Damaged index");
+            m_chunks.push_back(info);
+        }
+    }
+
+    bool TelemetryLogReader::readChunk(const size_t                      chunkIdx,
+                                       std::vector<i64>&                 timestamps,
+                                       std::vector<std::vector<double>>& columns) const
+    {
+        timestamps.clear();
+        columns.clear();
+        if (chunkIdx >= m_chunks.size())
+            return false;
+
+        const auto& info  = m_chunks[chunkIdx];
+        const auto& table = m_tables[info.table];
+        Cursor_S    cursor{m_data + info.offset, m_data + info.offset + info.size};
+        if (cursor.get<u32>() != telemetryLog::CHUNK_MAGIC || cursor.get<u16>() != info.table ||
+            cursor.get<u32>() != info.rows)
+            return false;
+
+        auto nextColumn = [&cursor]() -> std::span<const u8>
+        {
+            const u32 length = cursor.get<u32>();
+            if (!cursor.ok || (size_t)(cursor.end - cursor.ptr) < length)
+            {
+                cursor.ok = false;
+                return {};
+            }
+            std::span<const u8> column(cursor.ptr, length);
+            cursor.ptr += length;
+            return column;
+        };
+
+        timestamps.reserve(info.rows);
+        if (!decodeTimestamps(nextColumn(), info.rows, timestamps) || !cursor.ok)
+            return false;
+
+        columns.resize(table.columns.size());
+        for (size_t idx = 0; idx < table.columns.size(); idx++)
+        {
+            const auto data = nextColumn();
+            columns[idx].reserve(info.rows);
+            const bool decoded =
+                table.columns[idx].encoding == telemetryLog::Encoding_E::FLOAT_XOR
+                    ? decodeFloats(data, info.rows, columns[idx])
+                    : decodeIntegers(data, info.rows, columns[idx]);
+            if (!decoded || !cursor.ok)
+                return false;
+        }
+        return true;
+    }
+
+    bool TelemetryLogReader::exportCsv(std::ostream& out, const std::optional<size_t> table) const
+    {
+        std::vector<i64>                 timestamps;
+        std::vector<std::vector<double>> columns;
+        std::optional<size_t>            headerTable;
+
+        const auto precision = out.precision(9);
+        bool       ok        = true;
+        for (size_t chunkIdx = 0; chunkIdx < m_chunks.size(); chunkIdx++)
+        {
+            const size_t tableIdx = m_chunks[chunkIdx].table;
+            if (table.has_value() && table.value() != tableIdx)
+                continue;
+            if (!readChunk(chunkIdx, timestamps, columns))
+            {
+                ok = false;
+                continue;
+            }
+
+            const auto& schema      = m_tables[tableIdx].columns;
+            auto        sameColumns = [&schema](const std::vector<telemetryLog::Column_S>& other)
+            {
+                return std::equal(schema.begin(),
+                                  schema.end(),
+                                  other.begin(),
+                                  other.end(),
+                                  [](const auto& a, const auto& b) { return a.name == b.name; });
+            };
+            if (!headerTable.has_value() || !sameColumns(m_tables[headerTable.value()].columns))
+            {
+                out << "timestamp_us,can_id";
+                for (const auto& column : schema)
+                    out << ',' << column.name;
+                out << '\n';
+                headerTable = tableIdx;
+            }
+
+            for (size_t row = 0; row < timestamps.size(); row++)
+            {
+                out << timestamps[row] << ',' << m_tables[tableIdx].canId;
+                for (size_t idx = 0; idx < columns.size(); idx++)
+                {
+                    if (schema[idx].encoding == telemetryLog::Encoding_E::FLOAT_XOR)
+                        out << ',' << (float)columns[idx][row];
+                    else
+                        out << ',' << (i64)columns[idx][row];
+                }
+                out << '\n';
+            }
+        }
+        out.precision(precision);
+        return ok;
+    }
+}  // namespace mab
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <array>
+#include <fstream>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "logger.hpp"
+#include "mab_types.hpp"
+#include "md_types.hpp"
+#include "pds_properties.hpp"
+
+namespace mab
+{
+    /// @brief Chunked columnar telemetry file.
+    ///
+    /// Layout (little endian):
+    /// - header: FILE_MAGIC, u16 version, u16 table count, tables
+    ///   - table: u8 source, u16 CAN id, u16 column count, columns
+    ///   - column: u16 register address / PDS property id, u8 encoding, u8 name length, name
+    /// - chunks: u32 CHUNK_MAGIC, u16 table, u32 rows, then every column prefixed with its u32
+    ///   byte length, timestamps first (delta-of-delta varints in microseconds)
+    /// - index: ChunkInfo_S of every chunk
+    /// - footer: u64 index offset, u32 chunk count, INDEX_MAGIC
+    ///
+    /// Float columns are XOR compressed (Gorilla), integer columns are stored as zigzag varint
+    /// deltas. The index at the end of the file lets readers reach any chunk without decoding the
+    /// ones before it.
+    namespace telemetryLog
+    {
+        constexpr std::array<char, 8> FILE_MAGIC  = {'M', 'A', 'B', 'T', 'L', 'O', 'G', '1'};
+        constexpr std::array<char, 8> INDEX_MAGIC = {'M', 'A', 'B', 'T', 'I', 'D', 'X', '1'};
+        constexpr u32                 CHUNK_MAGIC = 0x4B4E4843;  // "CHNK"
+        constexpr u16                 VERSION     = 1;
+
+        enum class Source_E : u8
+        {
+            MD  = 0,
+            PDS = 1
+        };
+
+        enum class Encoding_E : u8
+        {
+            FLOAT_XOR = 0,
+            INT_DELTA = 1
+        };
+
+        struct Column_S
+        {
+            u16         id;  ///< MD register address or PDS property id
+            Encoding_E  encoding;
+            std::string name;
+        };
+
+        /// @brief Columns sampled together from one device
+        struct Table_S
+        {
+            Source_E              source;
+            canId_t               canId;
+            std::vector<Column_S> columns;
+        };
+
+        struct ChunkInfo_S
+        {
+            u16 table;
+            u32 rows;
+            u64 offset;
+            u64 size;
+            i64 firstTimestamp;  ///< microseconds
+            i64 lastTimestamp;   ///< microseconds
+        };
+
+        /// @brief Column of an MD register, name and encoding come from the register list
+        Column_S mdColumn(const MDRegisterAddress_E address);
+
+        /// @brief Column of a PDS property
+        Column_S pdsColumn(const propertyId_E property,
+                           const std::string& name,
+                           const Encoding_E   encoding);
+    }  // namespace telemetryLog
+
+    /// @brief Writes telemetry rows into the columnar file, one chunk per table is buffered in
+    /// memory at a time
+    class TelemetryLogWriter
+    {
+      public:
+        static constexpr size_t DEFAULT_ROWS_PER_CHUNK = 4096;
+
+        TelemetryLogWriter(const TelemetryLogWriter&)            = delete;
+        TelemetryLogWriter& operator=(const TelemetryLogWriter&) = delete;
+
+        /// @brief Create the file and write the schema, throws if the file can not be created
+        TelemetryLogWriter(const std::string&                        path,
+                           const std::vector<telemetryLog::Table_S>& tables,
+                           const size_t rowsPerChunk = DEFAULT_ROWS_PER_CHUNK);
+
+        ~TelemetryLogWriter();
+
+        /// @brief Append a row to the table
+        /// @param values one value per column of the table, integer columns are rounded
+        /// @return false if the table does not exist or the row does not match its columns
+        bool append(const size_t table, const i64 timestampUs, std::span<const double> values);
+
+        /// @brief Write the pending chunks and the index, further appends are ignored
+        void close();
+
+      private:
+        struct Pending_S
+        {
+            std::vector<i64>                 timestamps;
+            std::vector<std::vector<double>> columns;
+        };
+
+        Logger m_log = Logger(Logger::ProgramLayer_E::TOP, "TELEMETRY_LOG");
+
+        std::ofstream                            m_file;
+        const std::vector<telemetryLog::Table_S> m_tables;
+        const size_t                             m_rowsPerChunk;
+        std::vector<Pending_S>                   m_pending;
+        std::vector<telemetryLog::ChunkInfo_S>   m_chunks;
+        bool                                     m_closed = false;
+
+        void writeChunk(const size_t table);
+    };
+
+    /// @brief Reads the columnar telemetry file through a memory mapping. Opening only parses the
+    /// schema and the chunk index, chunks are decoded on demand.
+    class TelemetryLogReader
+    {
+      public:
+        TelemetryLogReader(const TelemetryLogReader&)            = delete;
+        TelemetryLogReader& operator=(const TelemetryLogReader&) = delete;
+
+        /// @brief Map the file, throws if it can not be opened or is not a valid telemetry log
+        explicit TelemetryLogReader(const std::string& path);
+
+        ~TelemetryLogReader();
+
+        const std::vector<telemetryLog::Table_S>& getTables() const
+        {
+            return m_tables;
+        }
+
+        const std::vector<telemetryLog::ChunkInfo_S>& getChunks() const
+        {
+            return m_chunks;
+        }
+
+        /// @brief Decode a single chunk
+        /// @param timestamps row timestamps in microseconds
+        /// @param columns values of every column of the chunk table
+        /// @return false if the chunk is damaged
+        bool readChunk(const size_t                      chunkIdx,
+                       std::vector<i64>&                 timestamps,
+                       std::vector<std::vector<double>>& columns) const;
+
+        /// @brief Write the rows as CSV, header is repeated whenever the columns change
+        /// @param table export only this table
+        /// @return false if any of the chunks is damaged
+        bool exportCsv(std::ostream& out, const std::optional<size_t> table = std::nullopt) const;
+
+      private:
+        const u8* m_data = nullptr;
+        size_t    m_size = 0;
+#ifdef _WIN32
+        std::vector<u8> m_buffer;
+#endif
+
+        std::vector<telemetryLog::Table_S>     m_tables;
+        std::vector<telemetryLog::ChunkInfo_S> m_chunks;
+
+        void parse();
+        void unmap();
+    };
+}  // namespace mab
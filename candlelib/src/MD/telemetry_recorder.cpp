@@ -0,0 +1,140 @@
+#include "telemetry_recorder.hpp"
+
+#include <array>
+#include <stdexcept>
+
+namespace mab
+{
+    TelemetryRecorder::TelemetryRecorder(const std::string&          path,
+                                         const std::vector<canId_t>& canIds,
+                                         const size_t                capacity,
+                                         const Format_E              format)
+        : m_start(std::chrono::steady_clock::now())
+    {
+        for (const canId_t canId : canIds)
+            m_channels.push_back(std::make_unique<Channel_S>(canId, capacity));
+
+        if (format == Format_E::COLUMNAR)
+        {
+            std::vector<telemetryLog::Table_S> tables;
+            for (const canId_t canId : canIds)
+                tables.push_back(telemetryLog::Table_S{
+                    telemetryLog::Source_E::MD,
+                    canId,
+                    {telemetryLog::mdColumn(MDRegisterAddress_E::mainEncoderPosition),
+                     telemetryLog::mdColumn(MDRegisterAddress_E::mainEncoderVelocity),
+                     telemetryLog::mdColumn(MDRegisterAddress_E::motorTorque),
+                     telemetryLog::mdColumn(MDRegisterAddress_E::motorTemperature)}});
+            m_logWriter = std::make_unique<TelemetryLogWriter>(path, tables);
+        }
+        else
+        {
+            m_file.open(path, std::ios::out | std::ios::trunc);
+            if (!m_file.is_open())
+                throw std::runtime_error("TelemetryRecorder: Could not open " + path);
+            m_file << "timestamp_us,can_id,position,velocity,torque,temperature\n";
+        }
+
+        m_writer = std::jthread(&TelemetryRecorder::writerLoop, this);
+    }
+
+    TelemetryRecorder::~TelemetryRecorder()
+    {
+        m_writer.request_stop();
+        if (m_writer.joinable())
+            m_writer.join();
+        drain();
+        if (m_logWriter != nullptr)
+            m_logWriter->close();
+        else
+            m_file.flush();
+    }
+
+    bool TelemetryRecorder::record(const size_t driveIdx, const Sample_S& sample) noexcept
+    {
+        if (driveIdx >= m_channels.size())
+            return false;
+        Channel_S& channel = *m_channels[driveIdx];
+        if (!channel.ring.push(sample))
+        {
+            channel.dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        channel.recorded.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void TelemetryRecorder::flush()
+    {
+        std::unique_lock lock(m_writerMux);
+        m_drainRequested = true;
+        m_writerCv.notify_all();
+        m_writerCv.wait(lock, [this]() { return !m_drainRequested; });
+    }
+
+    TelemetryRecorder::Stats_S TelemetryRecorder::getStats() const
+    {
+        Stats_S stats;
+        for (const auto& channel : m_channels)
+        {
+            stats.recorded += channel->recorded.load(std::memory_order_relaxed);
+            stats.dropped += channel->dropped.load(std::memory_order_relaxed);
+        }
+        stats.written = m_written.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void TelemetryRecorder::writerLoop(std::stop_token stopToken)
+    {
+        while (!stopToken.stop_requested())
+        {
+            bool requested = false;
+            {
+                std::unique_lock lock(m_writerMux);
+                m_writerCv.wait_for(
+                    lock, stopToken, DRAIN_PERIOD, [this]() { return m_drainRequested; });
+                // samples queued before the request are visible to the drain below
+                requested = m_drainRequested;
+            }
+            drain();
+            if (requested)
+            {
+                if (m_logWriter == nullptr)
+                    m_file.flush();
+                std::unique_lock lock(m_writerMux);
+                m_drainRequested = false;
+                m_writerCv.notify_all();
+            }
+        }
+    }
+
+    void TelemetryRecorder::drain()
+    {
+        Sample_S sample;
+        u64      written = 0;
+        for (size_t idx = 0; idx < m_channels.size(); idx++)
+        {
+            auto& channel = *m_channels[idx];
+            while (channel.ring.pop(sample))
+            {
+                const auto timestamp =
+                    std::chrono::duration_cast<std::chrono::microseconds>(sample.timestamp -
+                                                                          m_start);
+                if (m_logWriter != nullptr)
+                {
+                    const std::array<double, 4> values = {
+                        sample.position, sample.velocity, sample.torque, sample.temperature};
+                    m_logWriter->append(idx, timestamp.count(), values);
+                }
+                else
+                    m_file << timestamp.count() << ',' << channel.canId << ',' << sample.position
+                           << ',' << sample.velocity << ',' << sample.torque << ','
+                           << sample.temperature << '\n';
+                written++;
+            }
+        }
+        if (m_logWriter == nullptr && !m_file.good())
+            m_log.error("Writing telemetry failed!");
+        m_written.fetch_add(written, std::memory_order_relaxed);
+    }
+}  // namespace mab
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger.hpp"
+#include "mab_types.hpp"
+#include "spsc_ring.hpp"
+#include "telemetry_log.hpp"
+
+namespace mab
+{
+    /// @brief Captures drive state samples at the control rate and writes them to a CSV or columnar
+    /// (see TelemetryLogWriter) file in the background. Every drive has its own preallocated ring,
+    /// so recording from the control thread never allocates nor blocks. When the writer does not
+    /// keep up, samples are dropped and counted.
+    class TelemetryRecorder
+    {
+      public:
+        struct Sample_S
+        {
+            std::chrono::steady_clock::time_point timestamp;
+            float                                 position    = 0.0f;
+            float                                 velocity    = 0.0f;
+            float                                 torque      = 0.0f;
+            float                                 temperature = 0.0f;
+        };
+
+        struct Stats_S
+        {
+            u64 recorded = 0;  ///< Samples queued by the control thread
+            u64 dropped  = 0;  ///< Samples lost because the ring of the drive was full
+            u64 written  = 0;  ///< Samples written to the file
+        };
+
+        enum class Format_E
+        {
+            CSV,
+            COLUMNAR
+        };
+
+        static constexpr size_t DEFAULT_CAPACITY = 8192;
+        /// @brief How often the writer thread drains the rings
+        static constexpr std::chrono::milliseconds DRAIN_PERIOD = std::chrono::milliseconds(10);
+
+        TelemetryRecorder(const TelemetryRecorder&)            = delete;
+        TelemetryRecorder& operator=(const TelemetryRecorder&) = delete;
+
+        /// @brief Open the file and start the writer thread, throws if the file can not be opened
+        /// @param path output file
+        /// @param canIds drives to record, sample of the n-th drive is recorded with index n
+        /// @param capacity samples buffered per drive
+        /// @param format output file format
+        TelemetryRecorder(const std::string&          path,
+                          const std::vector<canId_t>& canIds,
+                          const size_t                capacity = DEFAULT_CAPACITY,
+                          const Format_E              format   = Format_E::CSV);
+
+        /// @brief Stop the writer thread, samples queued until then are still written
+        ~TelemetryRecorder();
+
+        /// @brief Queue sample of the drive, safe to call from one control thread
+        /// @return false if the sample was dropped
+        bool record(const size_t driveIdx, const Sample_S& sample) noexcept;
+
+        /// @brief Number of recorded drives
+        size_t size() const
+        {
+            return m_channels.size();
+        }
+
+        /// @brief Wait until all of the samples queued so far are written to the file
+        void flush();
+
+        Stats_S getStats() const;
+
+      private:
+        struct Channel_S
+        {
+            Channel_S(const canId_t id, const size_t capacity) : canId(id), ring(capacity)
+            {
+            }
+
+            const canId_t      canId;
+            SpscRing<Sample_S> ring;
+            std::atomic<u64>   recorded{0};
+            std::atomic<u64>   dropped{0};
+        };
+
+        Logger m_log = Logger(Logger::ProgramLayer_E::TOP, "TELEMETRY");
+
+        std::vector<std::unique_ptr<Channel_S>>     m_channels;
+        std::ofstream                               m_file;
+        std::unique_ptr<TelemetryLogWriter>         m_logWriter;
+        std::atomic<u64>                            m_written{0};
+        const std::chrono::steady_clock::time_point m_start;
+
+        std::mutex                  m_writerMux;
+        std::condition_variable_any m_writerCv;
+        bool                        m_drainRequested = false;
+        std::jthread                m_writer;
+
+        void writerLoop(std::stop_token stopToken);
+
+        /// @brief Write all of the queued samples, only called by the writer thread
+        void drain();
+    };
+}  // namespace mab
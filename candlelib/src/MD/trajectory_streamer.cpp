@@ -0,0 +1,264 @@
+#include "trajectory_streamer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace mab
+{
+    Trajectory Trajectory::fromSamples(const std::vector<double>&      positions,
+                                       const std::chrono::microseconds period)
+    {
+        Trajectory   trajectory;
+        const double h = std::chrono::duration<double>(period).count();
+        if (positions.size() < 2 || h <= 0.0)
+            return trajectory;
+
+        // finite difference velocities, one-sided at the ends
+        std::vector<double> velocities(positions.size());
+        velocities.front() = (positions[1] - positions[0]) / h;
+        velocities.back()  = (positions.back() - positions[positions.size() - 2]) / h;
+        for (size_t i = 1; i + 1 < positions.size(); i++)
+            velocities[i] = (positions[i + 1] - positions[i - 1]) / (2 * h);
+
+        for (size_t i = 0; i + 1 < positions.size(); i++)
+        {
+            const double p0 = positions[i], p1 = positions[i + 1];
+            const double v0 = velocities[i], v1 = velocities[i + 1];
+            trajectory.addSegment(Segment_S{h,
+                                            {p0,
+                                             v0,
+                                             (3 * (p1 - p0) / h - 2 * v0 - v1) / h,
+                                             (2 * (p0 - p1) / h + v0 + v1) / (h * h)}});
+        }
+        return trajectory;
+    }
+
+    void Trajectory::addSegment(const Segment_S& segment)
+    {
+        if (!(segment.duration > 0.0))
+            return;
+        m_starts.push_back(m_duration);
+        m_segments.push_back(segment);
+        m_duration += segment.duration;
+    }
+
+    Trajectory::Point_S Trajectory::sample(double time) const
+    {
+        if (m_segments.empty())
+            return Point_S{};
+        time = std::clamp(time, 0.0, m_duration);
+
+        // last segment starting at or before the time
+        const auto   it  = std::upper_bound(m_starts.begin(), m_starts.end(), time);
+        const size_t idx = std::max<ptrdiff_t>(it - m_starts.begin() - 1, 0);
+        const auto&  c   = m_segments[idx].coeffs;
+        const double s   = std::min(time - m_starts[idx], m_segments[idx].duration);
+        return Point_S{c[0] + s * (c[1] + s * (c[2] + s * c[3])),
+                       c[1] + s * (2 * c[2] + s * 3 * c[3])};
+    }
+
+    TrajectoryStreamer::TrajectoryStreamer(MDGroup& group, const std::chrono::microseconds period)
+        : m_group(group),
+          m_period(period),
+          m_writesVelocity(group.isWritten(MDRegisterAddress_E::targetVelocity)),
+          m_drives(group.size())
+    {
+        if (!group.isWritten(MDRegisterAddress_E::targetPosition))
+            throw std::runtime_error("TrajectoryStreamer: targetPosition is not written");
+        if (!group.isRead(MDRegisterAddress_E::mainEncoderPosition))
+            throw std::runtime_error("TrajectoryStreamer: mainEncoderPosition is not read");
+    }
+
+    bool TrajectoryStreamer::append(const size_t      driveIdx,
+                                    const Trajectory& trajectory,
+                                    const bool        last)
+    {
+        std::unique_lock lock(m_mux);
+        if (driveIdx >= m_drives.size() || trajectory.empty())
+            return false;
+
+        Drive_S& drive = m_drives[driveIdx];
+        // after an underrun the new data starts now instead of in the past
+        const double start = std::max(drive.end, now() - drive.phaseOffset);
+        drive.queue.push_back(Queued_S{trajectory, start});
+        drive.end         = start + trajectory.duration();
+        drive.last        = last;
+        drive.lowNotified = false;
+        return true;
+    }
+
+    void TrajectoryStreamer::setPhaseOffset(const size_t                    driveIdx,
+                                            const std::chrono::microseconds offset)
+    {
+        std::unique_lock lock(m_mux);
+        if (driveIdx < m_drives.size())
+            m_drives[driveIdx].phaseOffset = std::chrono::duration<double>(offset).count();
+    }
+
+    void TrajectoryStreamer::setLowWatermark(const std::chrono::microseconds      watermark,
+                                             std::function<void(size_t driveIdx)> callback)
+    {
+        std::unique_lock lock(m_mux);
+        m_watermark            = std::chrono::duration<double>(watermark).count();
+        m_lowWatermarkCallback = std::move(callback);
+    }
+
+    Trajectory::Point_S TrajectoryStreamer::advance(const size_t driveIdx, const double time)
+    {
+        Drive_S& drive = m_drives[driveIdx];
+        while (drive.queue.size() > 1 &&
+               time > drive.queue.front().start + drive.queue.front().trajectory.duration())
+            drive.queue.pop_front();
+
+        if (drive.queue.empty())
+        {
+            if (!drive.last)
+                drive.underruns++;
+            return drive.hold;
+        }
+
+        const Queued_S& front = drive.queue.front();
+        if (time < front.start)
+        {
+            drive.hold = Trajectory::Point_S{front.trajectory.sample(0.0).position, 0.0};
+            return drive.hold;
+        }
+        if (time > front.start + front.trajectory.duration())
+        {
+            drive.hold = Trajectory::Point_S{
+                front.trajectory.sample(front.trajectory.duration()).position, 0.0};
+            drive.queue.pop_front();
+            if (!drive.last)
+                drive.underruns++;
+            return drive.hold;
+        }
+        drive.hold = front.trajectory.sample(time - front.start);
+        return drive.hold;
+    }
+
+    MD::Error_t TrajectoryStreamer::readHoldPositions()
+    {
+        const auto&         state = m_group.getState();
+        std::vector<double> positions(m_drives.size());
+        for (size_t driveIdx = 0; driveIdx < m_drives.size(); driveIdx++)
+        {
+            if (state.errors[driveIdx] == MD::Error_t::OK)
+            {
+                positions[driveIdx] = state.positions[driveIdx];
+                continue;
+            }
+            MDRegisters_S     registers;
+            const MD::Error_t result =
+                m_group.getMd(driveIdx).readRegisters(registers.mainEncoderPosition);
+            if (result != MD::Error_t::OK)
+            {
+                m_log.error("Could not read position of drive %zu", driveIdx);
+                return result;
+            }
+            positions[driveIdx] = registers.mainEncoderPosition.value;
+        }
+
+        std::unique_lock lock(m_mux);
+        for (size_t driveIdx = 0; driveIdx < m_drives.size(); driveIdx++)
+            m_drives[driveIdx].hold.position = positions[driveIdx];
+        return MD::Error_t::OK;
+    }
+
+    MD::Error_t TrajectoryStreamer::step()
+    {
+        // until the first data arrives the drives stay where they are, so their positions have
+        // to be known before anything is commanded
+        if (!m_holdPositionsRead)
+        {
+            const MD::Error_t result = readHoldPositions();
+            if (result != MD::Error_t::OK)
+            {
+                std::unique_lock lock(m_mux);
+                m_failedExchanges++;
+                return result;
+            }
+            m_holdPositionsRead = true;
+        }
+
+        std::vector<size_t>                  lowDrives;
+        std::function<void(size_t driveIdx)> lowWatermarkCallback;
+        {
+            std::unique_lock lock(m_mux);
+            const double     time = now();
+            for (size_t driveIdx = 0; driveIdx < m_drives.size(); driveIdx++)
+            {
+                Drive_S&                  drive    = m_drives[driveIdx];
+                const double              local    = time - drive.phaseOffset;
+                const Trajectory::Point_S setpoint = advance(driveIdx, local);
+                m_group.setValue<float>(
+                    driveIdx, MDRegisterAddress_E::targetPosition, setpoint.position);
+                if (m_writesVelocity)
+                    m_group.setValue<float>(
+                        driveIdx, MDRegisterAddress_E::targetVelocity, setpoint.velocity);
+
+                if (m_lowWatermarkCallback && !drive.last && !drive.lowNotified &&
+                    drive.end - local < m_watermark)
+                {
+                    drive.lowNotified = true;
+                    lowDrives.push_back(driveIdx);
+                }
+            }
+            m_cycle++;
+            if (!lowDrives.empty())
+                lowWatermarkCallback = m_lowWatermarkCallback;
+        }
+
+        // outside of the lock, so the callback can append right away
+        for (const size_t driveIdx : lowDrives)
+            lowWatermarkCallback(driveIdx);
+
+        const MD::Error_t result = m_group.exchange();
+        if (result != MD::Error_t::OK)
+        {
+            std::unique_lock lock(m_mux);
+            m_failedExchanges++;
+        }
+        return result;
+    }
+
+    MD::Error_t TrajectoryStreamer::run()
+    {
+        m_stopRequested.store(false);
+        MD::Error_t status = MD::Error_t::OK;
+        auto        next   = std::chrono::steady_clock::now();
+        while (!m_stopRequested.load() && !finished())
+        {
+            if (step() != MD::Error_t::OK)
+                status = MD::Error_t::TRANSFER_FAILED;
+            next += m_period;
+            std::this_thread::sleep_until(next);
+        }
+        return status;
+    }
+
+    bool TrajectoryStreamer::finished() const
+    {
+        std::unique_lock lock(m_mux);
+        const double     time = now();
+        return std::all_of(m_drives.begin(),
+                           m_drives.end(),
+                           [time](const Drive_S& drive)
+                           { return drive.last && time - drive.phaseOffset > drive.end; });
+    }
+
+    TrajectoryStreamer::Stats_S TrajectoryStreamer::getStats() const
+    {
+        std::unique_lock lock(m_mux);
+        Stats_S          stats;
+        stats.cycles          = m_cycle;
+        stats.failedExchanges = m_failedExchanges;
+        const double time     = now();
+        for (const auto& drive : m_drives)
+        {
+            stats.underruns.push_back(drive.underruns);
+            stats.lookahead.push_back(std::max(0.0, drive.end - (time - drive.phaseOffset)));
+        }
+        return stats;
+    }
+}  // namespace mab
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "MDGroup.hpp"
+#include "logger.hpp"
+#include "mab_types.hpp"
+
+namespace mab
+{
+    /// @brief Time-parameterized position trajectory made of cubic polynomial segments
+    class Trajectory
+    {
+      public:
+        /// @brief p(s) = c[0] + c[1]s + c[2]s^2 + c[3]s^3, s is the time from the segment start
+        struct Segment_S
+        {
+            double                duration;  ///< seconds
+            std::array<double, 4> coeffs;
+        };
+
+        struct Point_S
+        {
+            double position = 0.0;  ///< radians
+            double velocity = 0.0;  ///< radians per second
+        };
+
+        Trajectory() = default;
+
+        /// @brief Trajectory passing through evenly spaced samples, velocities at the samples are
+        /// estimated from the neighbours (cubic Hermite interpolation)
+        /// @param positions samples in radians, at least two
+        /// @param period time between the samples
+        static Trajectory fromSamples(const std::vector<double>&      positions,
+                                      const std::chrono::microseconds period);
+
+        /// @brief Append polynomial segment, segments with non-positive duration are ignored
+        void addSegment(const Segment_S& segment);
+
+        /// @brief Total duration in seconds
+        double duration() const
+        {
+            return m_duration;
+        }
+
+        bool empty() const
+        {
+            return m_segments.empty();
+        }
+
+        /// @brief Evaluate the trajectory, time is clamped to its duration
+        /// @param time seconds from the trajectory start
+        Point_S sample(double time) const;
+
+      private:
+        std::vector<Segment_S> m_segments;
+        /// @brief Start time of every segment
+        std::vector<double> m_starts;
+        double              m_duration = 0.0;
+    };
+
+    /// @brief Streams trajectories of the drives of an MDGroup. Every cycle the trajectories are
+    /// interpolated at the same time point, written as targetPosition (and targetVelocity when it
+    /// is a part of the group write set) and exchanged in one batch.
+    class TrajectoryStreamer
+    {
+      public:
+        struct Stats_S
+        {
+            u64                 cycles          = 0;
+            u64                 failedExchanges = 0;
+            std::vector<u64>    underruns;  ///< Cycles each drive held position waiting for data
+            std::vector<double> lookahead;  ///< Queued seconds ahead of the current time
+        };
+
+        /// @brief Throws if the group does not write targetPosition or does not read
+        /// mainEncoderPosition
+        /// @param group drives to command
+        /// @param period cycle period
+        TrajectoryStreamer(MDGroup& group, const std::chrono::microseconds period);
+
+        /// @brief Queue trajectory of the drive after the ones already queued
+        /// @param last no more data follows, the drive holds the final position without counting
+        /// underruns
+        /// @return false if the drive does not exist or the trajectory is empty
+        bool append(const size_t driveIdx, const Trajectory& trajectory, const bool last = false);
+
+        /// @brief Delay the trajectories of the drive against the common time base, used to align
+        /// drives whose motion has to be phase shifted. Has to be set before the first cycle.
+        void setPhaseOffset(const size_t driveIdx, const std::chrono::microseconds offset);
+
+        /// @brief Called from the streaming thread when the queued time of a drive drops below the
+        /// watermark, so the producer can append more data in time
+        void setLowWatermark(const std::chrono::microseconds      watermark,
+                             std::function<void(size_t driveIdx)> callback);
+
+        /// @brief Run a single cycle: interpolate, write setpoints and exchange with the drives.
+        /// The first cycle reads the positions of the drives which were not exchanged with yet,
+        /// drives without data hold them instead of jumping to zero.
+        MD::Error_t step();
+
+        /// @brief Run cycles at the period until all of the drives reached the end of their last
+        /// trajectory or stop() was called
+        /// @return TRANSFER_FAILED if any of the exchanges failed
+        MD::Error_t run();
+
+        /// @brief Make run() return after the current cycle, safe to call from any thread
+        void stop()
+        {
+            m_stopRequested.store(true);
+        }
+
+        /// @brief true when all of the drives reached the end of their last trajectory
+        bool finished() const;
+
+        Stats_S getStats() const;
+
+      private:
+        struct Queued_S
+        {
+            Trajectory trajectory;
+            double     start;  ///< seconds on the time base of the drive
+        };
+
+        struct Drive_S
+        {
+            std::deque<Queued_S> queue;
+            double               end         = 0.0;  ///< end of the queued data
+            double               phaseOffset = 0.0;
+            bool                 last        = false;
+            bool                 lowNotified = false;
+            u64                  underruns   = 0;
+            Trajectory::Point_S  hold;
+        };
+
+        Logger m_log = Logger(Logger::ProgramLayer_E::TOP, "TRAJECTORY");
+
+        MDGroup&                        m_group;
+        const std::chrono::microseconds m_period;
+        const bool                      m_writesVelocity;
+        std::vector<Drive_S>            m_drives;
+        u64                             m_cycle           = 0;
+        u64                             m_failedExchanges = 0;
+        std::atomic_bool                m_stopRequested{false};
+        /// @brief Hold positions are known, touched only by the streaming thread
+        bool m_holdPositionsRead = false;
+
+        double                               m_watermark = 0.0;
+        std::function<void(size_t driveIdx)> m_lowWatermarkCallback;
+
+        mutable std::mutex m_mux;
+
+        /// @brief Time of the current cycle on the common time base
+        double now() const
+        {
+            return m_cycle * std::chrono::duration<double>(m_period).count();
+        }
+
+        /// @brief Read the positions the drives hold until their data arrives
+        MD::Error_t readHoldPositions();
+
+        /// @brief Setpoint of the drive at the time, drops the finished trajectories
+        Trajectory::Point_S advance(const size_t driveIdx, const double time);
+    };
+}  // namespace mab
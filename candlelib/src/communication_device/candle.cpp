@@ -1,8 +1,10 @@
 #include "candle.hpp"
 
+#include <algorithm>
 #include <exception>
 #include <MD.hpp>
 #include <optional>
+#include <thread>
 #include "candle_types.hpp"
 #include "mab_types.hpp"
 
@@ -67,7 +69,7 @@ namespace mab
             m_log.error("Bus not initialized!");
             return candleTypes::Error_t::INITIALIZATION_ERROR;
         }
-        m_bus->disconnect();
+        // already claimed interface is kept as it is, no need to enumerate the device again
         I_CommunicationInterface::Error_t connectStatus = m_bus->connect();
         if (connectStatus != I_CommunicationInterface::Error_t::OK)
         {
@@ -75,7 +77,7 @@ namespace mab
             return candleTypes::Error_t::INITIALIZATION_ERROR;
         }
 
-        candleTypes::Error_t initStatus = legacyCheckConnection();
+        candleTypes::Error_t initStatus = negotiateCapabilities();
         if (initStatus == candleTypes::Error_t::OK)
         {
             m_isInitialized = true;
@@ -110,21 +112,26 @@ namespace mab
     }
     std::optional<version_ut> Candle::getCandleVersion() const
     {
+        if (m_isInitialized)
+            return m_capabilities.version;
+
         auto buffer       = datarateCommandFrame(m_canDatarate, m_dontUseFDCANFrames);
         auto dataResponse = busTransfer(&buffer, 6);
-        if (dataResponse != candleTypes::Error_t::OK || buffer.size() < 6)
-        {
+        if (dataResponse != candleTypes::Error_t::OK)
             return std::nullopt;
-        }
-        else
-        {
-            version_ut candleVersion;
-            candleVersion.s.tag      = buffer[2];
-            candleVersion.s.revision = buffer[3];
-            candleVersion.s.minor    = buffer[4];
-            candleVersion.s.major    = buffer[5];
-            return candleVersion;
-        }
+        return parseVersion(buffer);
+    }
+
+    std::optional<version_ut> Candle::parseVersion(const std::vector<u8>& datarateResponse)
+    {
+        if (datarateResponse.size() < 6)
+            return std::nullopt;
+        version_ut candleVersion;
+        candleVersion.s.tag      = datarateResponse[2];
+        candleVersion.s.revision = datarateResponse[3];
+        candleVersion.s.minor    = datarateResponse[4];
+        candleVersion.s.major    = datarateResponse[5];
+        return candleVersion;
     }
 
     void Candle::cfTransferLoop(std::stop_token stopToken) noexcept
@@ -196,16 +203,36 @@ namespace mab
         }
         // frameDump(*data);
 
+        BusLock busLock(*this, false);
+
+        const u32 generation = m_busGeneration.load();
         if (responseLength == 0)
         {
             I_CommunicationInterface::Error_t comError = m_bus->transfer(*data, timeoutMs);
+            if (comError == I_CommunicationInterface::Error_t::NOT_CONNECTED &&
+                recoverBus(generation))
+                comError = m_bus->transfer(*data, timeoutMs);
             if (comError)
                 return candleTypes::Error_t::UNKNOWN_ERROR;
         }
         else
         {
+            const auto submitted = std::chrono::steady_clock::now();
             std::pair<std::vector<u8>, I_CommunicationInterface::Error_t> result =
                 m_bus->transfer(*data, timeoutMs, responseLength);
+            if (result.second == I_CommunicationInterface::Error_t::NOT_CONNECTED &&
+                recoverBus(generation))
+                result = m_bus->transfer(*data, timeoutMs, responseLength);
+            if (result.second == I_CommunicationInterface::Error_t::OK &&
+                !m_busTimingCaptured.load(std::memory_order_relaxed))
+            {
+                std::lock_guard lock(m_timingMux);
+                if (!m_busTimingCaptured.load())
+                {
+                    m_busTiming = BusTiming_S{submitted, std::chrono::steady_clock::now()};
+                    m_busTimingCaptured.store(true);
+                }
+            }
 
             data->clear();
             data->insert(data->begin(), result.first.begin(), result.first.end());
@@ -219,11 +246,273 @@ namespace mab
         return candleTypes::Error_t::OK;
     }
 
+    Candle::BusLock::BusLock(const Candle& candle, const bool urgent) : m_candle(candle)
+    {
+        std::unique_lock lock(m_candle.m_busMux);
+        if (urgent)
+            m_candle.m_urgentWaiting++;
+        m_candle.m_busReleased.wait(lock,
+                                    [&]()
+                                    {
+                                        return !m_candle.m_busHeld &&
+                                               (urgent || m_candle.m_urgentWaiting == 0);
+                                    });
+        if (urgent)
+            m_candle.m_urgentWaiting--;
+        m_candle.m_busHeld = true;
+    }
+
+    Candle::BusLock::~BusLock()
+    {
+        {
+            std::lock_guard lock(m_candle.m_busMux);
+            m_candle.m_busHeld = false;
+        }
+        m_candle.m_busReleased.notify_all();
+    }
+
+    bool Candle::recoverBus(const u32 generation) const
+    {
+        if (!m_autoReconnect.load() || !m_isInitialized)
+            return false;
+
+        std::unique_lock lock(m_recoveryMux);
+        if (m_busGeneration.load() != generation)
+            return true;
+
+        m_log.warn("Connection to CANdle lost, reconnecting...");
+        const auto start     = std::chrono::steady_clock::now();
+        bool       recovered = m_bus->reconnect() == I_CommunicationInterface::Error_t::OK;
+        if (recovered)
+        {
+            // device could have rebooted, so its datarate configuration is restored
+            auto datarateFrame = datarateCommandFrame(m_canDatarate, m_dontUseFDCANFrames);
+            recovered = m_bus->transfer(datarateFrame, DEFAULT_CAN_TIMEOUT + 1, 6).second ==
+                        I_CommunicationInterface::Error_t::OK;
+        }
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+
+        std::unique_lock metricsLock(m_metricsMux);
+        if (!recovered)
+        {
+            m_metrics.failedReconnects++;
+            m_log.error("Could not reconnect to CANdle!");
+            return false;
+        }
+        m_metrics.reconnects++;
+        m_metrics.lastReconnectTime = elapsed;
+        m_metrics.maxReconnectTime  = std::max(m_metrics.maxReconnectTime, elapsed);
+        m_busGeneration++;
+        m_log.info("Reconnected to CANdle in %lld us", (long long)elapsed.count());
+        return true;
+    }
+
+    void Candle::resetBusTiming() const
+    {
+        std::lock_guard lock(m_timingMux);
+        m_busTiming = BusTiming_S();
+        m_busTimingCaptured.store(false);
+    }
+
+    Candle::BusTiming_S Candle::getBusTiming() const
+    {
+        std::lock_guard lock(m_timingMux);
+        return m_busTiming;
+    }
+
+    Candle::Metrics_S Candle::getMetrics() const
+    {
+        std::unique_lock lock(m_metricsMux);
+        return m_metrics;
+    }
+
+    void Candle::setRetryPolicy(const RetryPolicy_S& policy)
+    {
+        std::unique_lock lock(m_retryMux);
+        m_retryPolicy = policy;
+        m_retryAttempts.store(std::max<u32>(policy.maxAttempts, 1));
+        m_retryTokens = {(double)policy.lostBudget, (double)policy.corruptBudget};
+        m_retryRefill = std::chrono::steady_clock::now();
+    }
+
+    Candle::RetryStats_S Candle::getRetryStats(const canId_t canId) const
+    {
+        std::unique_lock lock(m_retryMux);
+        const auto       it = m_retryStats.find(canId);
+        return it == m_retryStats.end() ? RetryStats_S() : it->second;
+    }
+
+    bool Candle::allowRetry(const FailureClass_E failure) const
+    {
+        bool allowed = false;
+        {
+            std::unique_lock lock(m_retryMux);
+            // token bucket per failure class, refilled at the budget rate up to one second worth
+            const auto   now     = std::chrono::steady_clock::now();
+            const double elapsed = std::chrono::duration<double>(now - m_retryRefill).count();
+            m_retryRefill        = now;
+            const std::array<double, 2> budgets = {(double)m_retryPolicy.lostBudget,
+                                                   (double)m_retryPolicy.corruptBudget};
+            for (size_t i = 0; i < budgets.size(); i++)
+                m_retryTokens[i] = std::min(m_retryTokens[i] + elapsed * budgets[i], budgets[i]);
+
+            double& tokens = m_retryTokens[(size_t)failure];
+            allowed        = tokens >= 1.0;
+            if (allowed)
+                tokens -= 1.0;
+        }
+
+        std::unique_lock metricsLock(m_metricsMux);
+        if (allowed)
+            m_metrics.retries++;
+        else
+            m_metrics.retriesDenied++;
+        return allowed;
+    }
+
+    void Candle::accountRetries(const canId_t canId, const u32 retries, const bool success) const
+    {
+        if (retries == 0)
+            return;
+        std::unique_lock lock(m_retryMux);
+        RetryStats_S&    stats = m_retryStats[canId];
+        stats.retries += retries;
+        if (success)
+            stats.recovered++;
+        else
+            stats.failed++;
+    }
+
     const std::pair<std::vector<u8>, candleTypes::Error_t> Candle::transferCANFrame(
         const canId_t         canId,
         const std::vector<u8> dataToSend,
         const size_t          responseSize,
-        const u32             timeoutMs) const
+        const u32             timeoutMs,
+        const bool            idempotent) const
+    {
+        const u32 maxAttempts = idempotent ? m_retryAttempts.load() : 1;
+        u32       retries     = 0;
+        while (true)
+        {
+            auto result = transferCANFrameOnce(canId, dataToSend, responseSize, timeoutMs);
+
+            std::optional<FailureClass_E> failure;
+            switch (result.second)
+            {
+                case candleTypes::Error_t::CAN_DEVICE_NOT_RESPONDING:
+                case candleTypes::Error_t::RESPONSE_TIMEOUT:
+                    // legacy frames carry no sequence number, so a response arriving after the
+                    // timeout would be taken for the response to the retry
+                    if (usesPackedTransfers())
+                        failure = FailureClass_E::LOST;
+                    break;
+                case candleTypes::Error_t::BAD_RESPONSE:
+                    failure = FailureClass_E::CORRUPT;
+                    break;
+                default:
+                    break;
+            }
+            if (!failure.has_value() || retries + 1 >= maxAttempts || !allowRetry(*failure))
+            {
+                accountRetries(canId, retries, result.second == candleTypes::Error_t::OK);
+                return result;
+            }
+            retries++;
+            m_log.debug("Retrying CAN frame to id: %d", canId);
+        }
+    }
+
+    const std::pair<std::vector<u8>, candleTypes::Error_t> Candle::transferCANFrameOnce(
+        const canId_t          canId,
+        const std::vector<u8>& dataToSend,
+        const size_t           responseSize,
+        const u32              timeoutMs) const
+    {
+        if (!m_adaptiveTimeouts.load())
+            return transferCANFrameWithTimeout(
+                canId, dataToSend, responseSize, std::chrono::milliseconds(timeoutMs));
+
+        // the estimate may only extend the timeout the caller asked for
+        const std::chrono::microseconds timeout =
+            std::max<std::chrono::microseconds>(m_rtt.getTimeout(canId),
+                                                std::chrono::milliseconds(timeoutMs));
+        const auto start  = std::chrono::steady_clock::now();
+        auto       result = transferCANFrameWithTimeout(canId, dataToSend, responseSize, timeout);
+        if (result.second == candleTypes::Error_t::OK)
+            m_rtt.addSample(canId,
+                            std::chrono::duration_cast<std::chrono::microseconds>(
+                                std::chrono::steady_clock::now() - start));
+        else if (result.second == candleTypes::Error_t::CAN_DEVICE_NOT_RESPONDING)
+            m_rtt.addTimeout(canId);
+        return result;
+    }
+
+    std::pair<std::vector<u8>, CANdleFrameAdapter::Error_t> Candle::accumulateFrameManaged(
+        const canId_t         canId,
+        const std::vector<u8> dataToSend,
+        const u16             timeout100us,
+        const bool            idempotent) const
+    {
+        const u32 maxAttempts = idempotent ? m_retryAttempts.load() : 1;
+        u32       retries     = 0;
+        while (true)
+        {
+            const bool adaptive = m_adaptiveTimeouts.load();
+            // the estimate may only extend the timeout the caller asked for
+            const u16 timeout =
+                adaptive ? (u16)std::clamp<s64>((m_rtt.getTimeout(canId).count() + 99) / 100,
+                                                timeout100us,
+                                                UINT16_MAX)
+                         : timeout100us;
+            const auto start  = std::chrono::steady_clock::now();
+            auto       result = m_cfAdapter.accumulateFrame(canId, dataToSend, timeout);
+            // node that did not respond leaves its slot of the packed frame empty, it backs off
+            // the estimate instead of being sampled with the whole timeout as its round trip
+            if (result.second == CANdleFrameAdapter::Error_t::OK && result.first.empty())
+                result.second = CANdleFrameAdapter::Error_t::FRAME_LOST;
+
+            std::optional<FailureClass_E> failure;
+            switch (result.second)
+            {
+                case CANdleFrameAdapter::Error_t::OK:
+                    if (adaptive && !result.first.empty())
+                        m_rtt.addSample(canId,
+                                        std::chrono::duration_cast<std::chrono::microseconds>(
+                                            std::chrono::steady_clock::now() - start));
+                    break;
+                case CANdleFrameAdapter::Error_t::FRAME_LOST:
+                    if (adaptive)
+                        m_rtt.addTimeout(canId);
+                    failure = FailureClass_E::LOST;
+                    break;
+                case CANdleFrameAdapter::Error_t::READER_TIMEOUT:
+                    failure = FailureClass_E::LOST;
+                    break;
+                case CANdleFrameAdapter::Error_t::INVALID_CANDLE_FRAME:
+                    if (adaptive)
+                        m_rtt.addTimeout(canId);
+                    failure = FailureClass_E::CORRUPT;
+                    break;
+                default:
+                    break;
+            }
+            // the frame goes into the packed frame accumulated right now, so only the lost frame
+            // is sent again and not the whole batch it was a part of
+            if (!failure.has_value() || retries + 1 >= maxAttempts || !allowRetry(*failure))
+            {
+                accountRetries(canId, retries, result.second == CANdleFrameAdapter::Error_t::OK);
+                return result;
+            }
+            retries++;
+        }
+    }
+
+    const std::pair<std::vector<u8>, candleTypes::Error_t> Candle::transferCANFrameWithTimeout(
+        const canId_t                   canId,
+        const std::vector<u8>&          dataToSend,
+        const size_t                    responseSize,
+        const std::chrono::microseconds timeout) const
     {
         candleTypes::Error_t communicationStatus = candleTypes::Error_t::OK;
 
@@ -244,7 +533,12 @@ namespace mab
                 dataToSend, candleTypes::Error_t::DATA_TOO_LONG);
         }
 
-        auto buffer = std::vector<u8>(dataToSend);
+        if (usesPackedTransfers())
+            return transferPackedCANFrame(
+                canId, dataToSend, (u16)std::min<s64>((timeout.count() + 99) / 100, UINT16_MAX));
+
+        const u32 timeoutMs = (u32)std::min<s64>((timeout.count() + 999) / 1000, UINT8_MAX);
+        auto      buffer    = std::vector<u8>(dataToSend);
 
         const auto candleCommandCANframe =
             sendCanFrameHeader(dataToSend.size(), u16(canId), timeoutMs);
@@ -274,16 +568,166 @@ namespace mab
         return std::pair<std::vector<u8>, candleTypes::Error_t>(response, communicationStatus);
     }
 
-    // TODO: this must be changed to something less invasive
-    candleTypes::Error_t Candle::legacyCheckConnection()
+    candleTypes::Error_t Candle::sendCANFrameUnacknowledged(const canId_t          canId,
+                                                            const std::vector<u8>& dataToSend) const
     {
-        auto datarateFrame = datarateCommandFrame(m_canDatarate, m_dontUseFDCANFrames);
+        if (!m_isInitialized)
+            return candleTypes::Error_t::UNINITIALIZED;
+        if (dataToSend.size() > m_maxCANFrameSize)
+        {
+            m_log.error("CAN frame too long!");
+            return candleTypes::Error_t::DATA_TOO_LONG;
+        }
+
+        if (usesPackedTransfers())
+        {
+            switch (m_cfAdapter.postFrame(canId, dataToSend))
+            {
+                case CANdleFrameAdapter::Error_t::OK:
+                    return candleTypes::Error_t::OK;
+                case CANdleFrameAdapter::Error_t::READER_TIMEOUT:
+                    return candleTypes::Error_t::RESPONSE_TIMEOUT;
+                case CANdleFrameAdapter::Error_t::INVALID_BUS_FRAME:
+                    return candleTypes::Error_t::BAD_RESPONSE;
+                default:
+                    return candleTypes::Error_t::UNKNOWN_ERROR;
+            }
+        }
 
-        auto testConnectionFrame = std::vector<u8>(datarateFrame.begin(), datarateFrame.end());
+        // legacy transfers are request-response on USB, only the wait for the node is skipped
+        auto [response, error] =
+            transferCANFrameWithTimeout(canId, dataToSend, 0, std::chrono::microseconds(0));
+        if (error == candleTypes::Error_t::CAN_DEVICE_NOT_RESPONDING)
+            return candleTypes::Error_t::OK;
+        return error;
+    }
+
+    Candle::UrgentTransfer_S Candle::prepareUrgentTransfer(
+        const std::vector<std::pair<canId_t, std::vector<u8>>>& frames) const
+    {
+        UrgentTransfer_S transfer;
+        for (const auto& [canId, data] : frames)
+        {
+            if (data.empty() || data.size() > m_maxCANFrameSize)
+            {
+                m_log.error("Invalid urgent CAN frame for id: %d!", canId);
+                return UrgentTransfer_S();
+            }
+        }
 
-        const candleTypes::Error_t connectionStatus = busTransfer(&testConnectionFrame, 6);
+        if (usesPackedTransfers())
+        {
+            transfer.packed    = true;
+            transfer.busFrames = CANdleFrameAdapter::packFrames(frames);
+            return transfer;
+        }
+
+        // zero timeout, the CANdle puts the frame on the bus and does not wait for the node
+        for (const auto& [canId, data] : frames)
+        {
+            auto buffer = sendCanFrameHeader(u8(data.size()), u16(canId), 0);
+            buffer.insert(buffer.end(), data.begin(), data.end());
+            transfer.busFrames.push_back(std::move(buffer));
+        }
+        return transfer;
+    }
+
+    Candle::UrgentReport_S Candle::sendUrgentTransfer(const UrgentTransfer_S& transfer) const
+    {
+        const auto     start = std::chrono::steady_clock::now();
+        UrgentReport_S report;
+        if (!m_isInitialized)
+        {
+            report.result = candleTypes::Error_t::UNINITIALIZED;
+            return report;
+        }
+        if (transfer.busFrames.empty())
+        {
+            report.result = candleTypes::Error_t::DATA_EMPTY;
+            return report;
+        }
+
+        BusLock busLock(*this, true);
+        for (const auto& busFrame : transfer.busFrames)
+        {
+            // packed response mirrors the request
+            const size_t responseLength =
+                transfer.packed ? busFrame.size() : 64 + 2 /*response header size*/;
+            auto [response, error] =
+                m_bus->transfer(busFrame, DEFAULT_CAN_TIMEOUT + 1, responseLength);
+            if (error != I_CommunicationInterface::Error_t::OK)
+                report.result = candleTypes::Error_t::UNKNOWN_ERROR;
+            else if (transfer.packed &&
+                     (response.size() < 2 || response[0] != CANdleFrame::DTO_PARSE_ID ||
+                      !response[1] /*ACK*/))
+                report.result = candleTypes::Error_t::BAD_RESPONSE;
+        }
+
+        report.timeToWire = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+        if (report.result != candleTypes::Error_t::OK)
+            m_log.error("Urgent transfer failed!");
+        return report;
+    }
+
+    const std::pair<std::vector<u8>, candleTypes::Error_t> Candle::transferPackedCANFrame(
+        const canId_t canId, const std::vector<u8>& dataToSend, const u16 timeout100us) const
+    {
+        auto [response, error] = m_cfAdapter.accumulateFrame(canId, dataToSend, timeout100us);
+        switch (error)
+        {
+            case CANdleFrameAdapter::Error_t::OK:
+                // node that did not respond leaves its slot of the packed frame empty
+                if (response.empty())
+                {
+                    m_log.error("CAN frame did not reach target device with id: %d!", canId);
+                    return std::make_pair(dataToSend,
+                                          candleTypes::Error_t::CAN_DEVICE_NOT_RESPONDING);
+                }
+                return std::make_pair(response, candleTypes::Error_t::OK);
+            case CANdleFrameAdapter::Error_t::READER_TIMEOUT:
+                return std::make_pair(dataToSend, candleTypes::Error_t::RESPONSE_TIMEOUT);
+            case CANdleFrameAdapter::Error_t::FRAME_LOST:
+                m_log.error("CAN frame did not reach target device with id: %d!", canId);
+                return std::make_pair(dataToSend, candleTypes::Error_t::CAN_DEVICE_NOT_RESPONDING);
+            case CANdleFrameAdapter::Error_t::INVALID_CANDLE_FRAME:
+                m_log.error("Response of the device with id: %d was damaged!", canId);
+                return std::make_pair(dataToSend, candleTypes::Error_t::BAD_RESPONSE);
+            case CANdleFrameAdapter::Error_t::INVALID_BUS_FRAME:
+                return std::make_pair(dataToSend, candleTypes::Error_t::BAD_RESPONSE);
+            default:
+                return std::make_pair(dataToSend, candleTypes::Error_t::UNKNOWN_ERROR);
+        }
+    }
+
+    candleTypes::Error_t Candle::negotiateCapabilities()
+    {
+        auto datarateFrame = datarateCommandFrame(m_canDatarate, m_dontUseFDCANFrames);
+
+        const candleTypes::Error_t connectionStatus = busTransfer(&datarateFrame, 6);
         if (connectionStatus != candleTypes::Error_t::OK)
             return connectionStatus;
+
+        m_capabilities         = candleTypes::Capabilities_t();
+        m_capabilities.version = parseVersion(datarateFrame);
+        m_capabilities.canFD   = !m_dontUseFDCANFrames;
+        if (m_capabilities.version.has_value())
+        {
+            const auto& version = m_capabilities.version.value().s;
+            m_capabilities.packedFrames = version.major > PACKED_FRAMES_MIN_MAJOR ||
+                                          (version.major == PACKED_FRAMES_MIN_MAJOR &&
+                                           version.minor >= PACKED_FRAMES_MIN_MINOR);
+            // frame count is a part of the packed frame header since its introduction
+            m_capabilities.variablePacking = m_capabilities.packedFrames;
+            m_log.debug("CANdle firmware version: %d.%d.%d",
+                        version.major,
+                        version.minor,
+                        version.revision);
+        }
+        else
+        {
+            m_log.warn("CANdle did not report its firmware version");
+        }
         return candleTypes::Error_t::OK;
     }
 
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <optional>
 #include <string_view>
@@ -10,6 +12,8 @@
 #include <map>
 #include <future>
 #include <mutex>
+#include <condition_variable>
+#include <unordered_map>
 
 #include "candle_types.hpp"
 #include "logger.hpp"
@@ -19,6 +23,7 @@
 #include "mab_types.hpp"
 #include "candle_frame_adapter.hpp"
 #include "candle_frame_dto.hpp"
+#include "rtt_estimator.hpp"
 
 namespace mab
 {
@@ -42,6 +47,62 @@ namespace mab
         static constexpr u32 CANDLE_VID = 0x69;
         static constexpr u32 CANDLE_PID = 0x1000;
 
+        /// @brief Statistics of the link between the host and the CANdle device
+        struct Metrics_S
+        {
+            u32                       reconnects       = 0;  ///< Successful link recoveries
+            u32                       failedReconnects = 0;  ///< Recoveries that gave up
+            std::chrono::microseconds lastReconnectTime{0};  ///< Duration of the last recovery
+            std::chrono::microseconds maxReconnectTime{0};   ///< Longest recovery so far
+            u64 retries       = 0;  ///< Requests sent again after a lost or corrupted frame
+            u64 retriesDenied = 0;  ///< Retries refused because the retry budget was used up
+        };
+
+        /// @brief Host side timestamps of the first bus exchange with a response since
+        /// resetBusTiming()
+        struct BusTiming_S
+        {
+            /// @brief Request handed over to the communication interface
+            std::optional<std::chrono::steady_clock::time_point> submitted;
+            /// @brief Response of the CANdle received
+            std::optional<std::chrono::steady_clock::time_point> responded;
+        };
+
+        /// @brief Retransmission of idempotent requests whose frames were lost or corrupted
+        struct RetryPolicy_S
+        {
+            u32 maxAttempts = 1;  ///< Attempts of every idempotent request, 1 disables retries
+            /// @brief Retries per second allowed after frames the node did not respond to, keeps
+            /// a dead node from multiplying the traffic
+            u32 lostBudget = 100;
+            /// @brief Retries per second allowed after corrupted frames
+            u32 corruptBudget = 100;
+        };
+
+        /// @brief Retransmission counters of a single node
+        struct RetryStats_S
+        {
+            u64 retries   = 0;  ///< Frames sent again
+            u64 recovered = 0;  ///< Requests which succeeded after a retry
+            u64 failed    = 0;  ///< Requests which failed despite retries
+        };
+
+        /// @brief CAN frames serialized into bus transfers ahead of time, see
+        /// prepareUrgentTransfer()
+        struct UrgentTransfer_S
+        {
+            std::vector<std::vector<u8>> busFrames;
+            bool                         packed = false;  ///< Packed CANdle frames or legacy ones
+        };
+
+        /// @brief Outcome of an urgent transfer
+        struct UrgentReport_S
+        {
+            candleTypes::Error_t result = candleTypes::Error_t::OK;
+            /// @brief Time from the call until the CANdle reported the last frame as sent
+            std::chrono::microseconds timeToWire{0};
+        };
+
         Candle() = delete;
 
         Candle(const Candle&) = delete;
@@ -62,12 +123,38 @@ namespace mab
         /// response)
         /// @param timeoutMs Time after which candle will stop waiting for node response in
         /// miliseconds
+        /// @param idempotent Request can be safely repeated, lost or corrupted frames are then
+        /// retransmitted according to the retry policy. Lost frames are only retransmitted over
+        /// packed transfers, which tell late responses apart.
         /// @return
         const std::pair<std::vector<u8>, candleTypes::Error_t> transferCANFrame(
             const canId_t         canId,
             const std::vector<u8> dataToSend,
             const size_t          responseSize,
-            const u32             timeoutMs = DEFAULT_CAN_TIMEOUT) const;
+            const u32             timeoutMs  = DEFAULT_CAN_TIMEOUT,
+            const bool            idempotent = false) const;
+
+        /// @brief Send CAN frame without waiting for the node response. With packed frames the
+        /// call returns as soon as the frame is queued, otherwise as soon as the CANdle has put it
+        /// on the bus. Errors on the node side are not reported, they have to be checked by reading
+        /// the node status.
+        /// @param canId Target CAN node ID
+        /// @param dataToSend Data to be transferred via CAN bus
+        /// @return Error if the frame could not be queued or sent
+        candleTypes::Error_t sendCANFrameUnacknowledged(const canId_t          canId,
+                                                        const std::vector<u8>& dataToSend) const;
+
+        /// @brief Serialize CAN frames for sendUrgentTransfer(), so that nothing has to be built
+        /// when they are needed. Frames are sent without waiting for the node responses.
+        /// @param frames CAN ID and data of every frame
+        /// @return Prepared transfer, without any bus frames if any of the CAN frames is invalid
+        UrgentTransfer_S prepareUrgentTransfer(
+            const std::vector<std::pair<canId_t, std::vector<u8>>>& frames) const;
+
+        /// @brief Send prepared frames ahead of the regular traffic. A bus transfer already in
+        /// progress is completed first, transfers issued meanwhile by other threads are held until
+        /// the urgent frames are sent.
+        UrgentReport_S sendUrgentTransfer(const UrgentTransfer_S& transfer) const;
 
         /// @brief Initialize candle
         candleTypes::Error_t init();
@@ -76,8 +163,71 @@ namespace mab
         /// @return Error on failure
         candleTypes::Error_t reset();
 
+        /// @brief Get CANdle firmware version, cached during initialization
         std::optional<version_ut> getCandleVersion() const;
 
+        /// @brief Get protocol features negotiated with the device during initialization
+        const candleTypes::Capabilities_t& getCapabilities() const
+        {
+            return m_capabilities;
+        }
+
+        /// @brief Whether transferCANFrame() goes through packed frames, batching users should
+        /// follow the same choice
+        bool usesPackedTransfers() const
+        {
+            return m_capabilities.packedFrames && m_bus->preferPackedTransfers();
+        }
+
+        /// @brief Maximum payload of a single CAN frame (8 for CAN 2.0, 64 for CAN-FD)
+        size_t getMaxCANFrameSize() const
+        {
+            return m_maxCANFrameSize;
+        }
+
+        /// @brief Get link statistics
+        Metrics_S getMetrics() const;
+
+        /// @brief Start capturing timestamps of the next bus exchange
+        void resetBusTiming() const;
+
+        /// @brief Timestamps of the first bus exchange since resetBusTiming()
+        BusTiming_S getBusTiming() const;
+
+        /// @brief When enabled (default) transfers that fail because the bus was lost wait for the
+        /// device to come back, claim it again and are retried once
+        void setAutoReconnect(const bool enable)
+        {
+            m_autoReconnect.store(enable);
+        }
+
+        /// @brief When enabled, node timeouts requested by the callers are extended to ones
+        /// derived from the measured round trip times of every node (see RttEstimator). The
+        /// requested timeout stays the lower bound.
+        void setAdaptiveTimeouts(const bool enable)
+        {
+            m_adaptiveTimeouts.store(enable);
+        }
+
+        /// @brief Round trip statistics of the nodes, also used to override their timeout bounds
+        RttEstimator& getRttEstimator()
+        {
+            return m_rtt;
+        }
+
+        /// @brief Set retransmission policy of idempotent requests
+        void setRetryPolicy(const RetryPolicy_S& policy);
+
+        /// @brief Get retransmission counters of the node
+        RetryStats_S getRetryStats(const canId_t canId) const;
+
+        /// @brief Whether idempotent requests whose frames were lost are sent again by the candle,
+        /// which takes packed transfers and a retry policy with more than one attempt
+        bool retriesLostFrames() const
+        {
+            return m_retryAttempts.load() > 1 && usesPackedTransfers();
+        }
+
         /// @brief Command the application to reboot into a bootloader and await commands.
         /// @param usb initialized usb interface (bootloader only works via USB)
         /// @return Error on failure
@@ -91,21 +241,46 @@ namespace mab
         /// response)
         /// @param timeout100us Time after which candle will stop waiting for node response in
         /// units of 100 microseconds
+        /// @param idempotent Request can be safely repeated, a lost or corrupted frame is then
+        /// queued again into the next packed frame according to the retry policy
         /// @return Future containing response can frame (undefined on error being not OK) and error
         /// code
         inline std::future<std::pair<std::vector<u8>, CANdleFrameAdapter::Error_t>>
         transferCANFrameAsync(const canId_t          canId,
                               const std::vector<u8>& dataToSend,
                               const size_t           responseSize,
-                              const u16              timeout100us = DEFAULT_CAN_TIMEOUT * 10)
+                              const u16              timeout100us = DEFAULT_CAN_TIMEOUT * 10,
+                              const bool             idempotent   = false)
+        {
+            return std::async(std::launch::async,
+                              &Candle::transferCANFramePacked,
+                              this,
+                              canId,
+                              dataToSend,
+                              responseSize,
+                              timeout100us,
+                              idempotent);
+        }
+
+        /// @brief Blocking counterpart of transferCANFrameAsync(), meant for callers keeping
+        /// several frames in flight from their own threads. Frames of concurrent callers are packed
+        /// together.
+        /// @return Response can frame (undefined on error being not OK) and error code
+        inline std::pair<std::vector<u8>, CANdleFrameAdapter::Error_t> transferCANFramePacked(
+            const canId_t          canId,
+            const std::vector<u8>& dataToSend,
+            const size_t           responseSize,
+            const u16              timeout100us = DEFAULT_CAN_TIMEOUT * 10,
+            const bool             idempotent   = false) const
         {
-            auto ret = std::async(std::launch::async,
-                                  &CANdleFrameAdapter::accumulateFrame,
-                                  &m_cfAdapter,
-                                  canId,
-                                  dataToSend,
-                                  timeout100us);
-            return ret;
+            (void)responseSize;
+            if (m_adaptiveTimeouts.load() || (idempotent && m_retryAttempts.load() > 1))
+                return accumulateFrameManaged(canId, dataToSend, timeout100us, idempotent);
+            auto result = m_cfAdapter.accumulateFrame(canId, dataToSend, timeout100us);
+            // node that did not respond leaves its slot of the packed frame empty
+            if (result.second == CANdleFrameAdapter::Error_t::OK && result.first.empty())
+                result.second = CANdleFrameAdapter::Error_t::FRAME_LOST;
+            return result;
         }
 
         inline std::future<std::pair<std::vector<u8>, CANdleFrameAdapter::Error_t>>
@@ -133,22 +308,115 @@ namespace mab
         const bool   m_dontUseFDCANFrames = false;
         const size_t m_maxCANFrameSize    = 64;
 
+        candleTypes::Capabilities_t m_capabilities;
+
+        /// @brief Oldest firmware handling packed CANdle frames
+        static constexpr u8 PACKED_FRAMES_MIN_MAJOR = 2;
+        static constexpr u8 PACKED_FRAMES_MIN_MINOR = 4;
+
         mutable std::mutex                         m_cfSyncMux;
         std::shared_ptr<std::function<void(void)>> m_cfsync;
-        CANdleFrameAdapter                         m_cfAdapter;
+        mutable CANdleFrameAdapter                 m_cfAdapter;
         std::jthread                               m_cfTransferThread;
         std::counting_semaphore<7>                 m_cfTransferSemaphore{0};
         std::atomic_bool                           m_cfTransferAlive{false};
 
         void cfTransferLoop(std::stop_token stopToken) noexcept;
 
+        mutable RttEstimator m_rtt;
+        std::atomic_bool     m_adaptiveTimeouts{false};
+
+        mutable std::mutex                                m_retryMux;
+        RetryPolicy_S                                     m_retryPolicy;
+        std::atomic_uint32_t                              m_retryAttempts{1};
+        mutable std::array<double, 2>                     m_retryTokens{};  ///< Per failure class
+        mutable std::chrono::steady_clock::time_point     m_retryRefill;
+        mutable std::unordered_map<canId_t, RetryStats_S> m_retryStats;
+
+        /// @brief Exclusive hold of the bus for a whole request/response exchange, urgent transfers
+        /// waiting for the bus get it before the regular ones
+        class BusLock
+        {
+          public:
+            BusLock(const Candle& candle, const bool urgent);
+            ~BusLock();
+            BusLock(const BusLock&)            = delete;
+            BusLock& operator=(const BusLock&) = delete;
+
+          private:
+            const Candle& m_candle;
+        };
+
+        mutable std::mutex              m_busMux;
+        mutable std::condition_variable m_busReleased;
+        mutable bool                    m_busHeld       = false;  ///< Guarded by m_busMux
+        mutable u32                     m_urgentWaiting = 0;      ///< Guarded by m_busMux
+
+        std::atomic_bool             m_autoReconnect{true};
+        mutable std::mutex           m_recoveryMux;
+        mutable std::atomic_uint32_t m_busGeneration{0};  ///< Incremented on every recovery
+        mutable std::mutex           m_metricsMux;
+        mutable Metrics_S            m_metrics;
+
+        mutable std::mutex       m_timingMux;
+        mutable BusTiming_S      m_busTiming;
+        mutable std::atomic_bool m_busTimingCaptured{false};
+
+        /// @brief Restore the bus after it was lost
+        /// @param generation bus generation observed before the failed transfer, if it differs
+        /// another thread has already recovered the bus
+        /// @return true if the bus is usable again
+        bool recoverBus(const u32 generation) const;
+
+        /// @brief Transfer single CAN frame through the packed frames pipeline, used when the bus
+        /// prefers packed transfers
+        const std::pair<std::vector<u8>, candleTypes::Error_t> transferPackedCANFrame(
+            const canId_t canId, const std::vector<u8>& dataToSend, const u16 timeout100us) const;
+
+        /// @brief Transfer CAN frame with the node timeout, rounded up to the resolution of the
+        /// transfer path
+        const std::pair<std::vector<u8>, candleTypes::Error_t> transferCANFrameWithTimeout(
+            const canId_t                   canId,
+            const std::vector<u8>&          dataToSend,
+            const size_t                    responseSize,
+            const std::chrono::microseconds timeout) const;
+
+        /// @brief Single attempt of transferCANFrame()
+        const std::pair<std::vector<u8>, candleTypes::Error_t> transferCANFrameOnce(
+            const canId_t          canId,
+            const std::vector<u8>& dataToSend,
+            const size_t           responseSize,
+            const u32              timeoutMs) const;
+
+        /// @brief Packed transfer with adaptive timeout and retransmissions when enabled
+        std::pair<std::vector<u8>, CANdleFrameAdapter::Error_t> accumulateFrameManaged(
+            const canId_t         canId,
+            const std::vector<u8> dataToSend,
+            const u16             timeout100us,
+            const bool            idempotent) const;
+
+        enum class FailureClass_E : u8
+        {
+            LOST    = 0,  ///< Node did not respond
+            CORRUPT = 1,  ///< Frame or response damaged on the way
+        };
+
+        /// @brief Take a retry of the node from the budget of the failure class
+        /// @return false if the budget is used up
+        bool allowRetry(const FailureClass_E failure) const;
+
+        /// @brief Account finished request which needed retransmissions
+        void accountRetries(const canId_t canId, const u32 retries, const bool success) const;
+
         candleTypes::Error_t busTransfer(std::vector<u8>* data,
                                          size_t           responseLength = 0,
                                          const u32 timeoutMs = DEFAULT_CAN_TIMEOUT + 1) const;
 
-        // TODO: this method is temporary and must be changed, must have some way for bus to check
-        // functional connection
-        candleTypes::Error_t legacyCheckConnection();
+        /// @brief Configure the datarate and read device capabilities from the response, this is
+        /// the only round trip of the initialization
+        candleTypes::Error_t negotiateCapabilities();
+
+        static std::optional<version_ut> parseVersion(const std::vector<u8>& datarateResponse);
 
         static constexpr std::array<u8, 2> resetCommandFrame()
         {
@@ -256,16 +524,30 @@ namespace mab
         std::shared_ptr<candleTypes::busTypes_t> busType  = nullptr;
         std::optional<std::string_view>          pathOrId;
         std::optional<bool>                      useCAN20Frames;
+        /// @brief Data-ready line of the SPI HAT, SPI device is polled when not set
+        std::optional<SPI::DataReadyLine_S> spiDataReadyLine;
+        /// @brief Locator owning the libusb context, the process wide one is used when not set
+        std::shared_ptr<UsbDeviceLocator> usbLocator = nullptr;
 
         std::function<void()> preBuildTask = []() {};
 
         std::optional<Candle*> build() const
         {
             preBuildTask();
+            auto bus = connectBus();
+            if (bus == nullptr)
+                return {};
+            return build(std::move(bus));
+        }
+
+        /// @brief Create and connect the communication interface of the CANdle
+        /// @return nullptr on failure
+        std::unique_ptr<I_CommunicationInterface> connectBus() const
+        {
             if (datarate == nullptr || busType == nullptr)
             {
                 m_logger.error("Parameters missing. Could create Candle.");
-                return {};
+                return nullptr;
             }
             std::unique_ptr<I_CommunicationInterface> bus;
             switch (*busType)
@@ -273,33 +555,47 @@ namespace mab
                 case candleTypes::busTypes_t::USB:
                     bus = std::make_unique<mab::USB>(Candle::CANDLE_VID,
                                                      Candle::CANDLE_PID,
-                                                     std::string(pathOrId.value_or(std::string())));
+                                                     std::string(pathOrId.value_or(std::string())),
+                                                     usbLocator);
                     if (bus->connect() != I_CommunicationInterface::Error_t::OK)
                     {
                         m_logger.error("Could not connect USB device!");
-                        return {};
+                        return nullptr;
                     }
                     break;
                 case mab::candleTypes::SPI:
                     bus = std::make_unique<mab::SPI>(
-                        std::string(pathOrId.value_or("/dev/spidev0.0")));
+                        std::string(pathOrId.value_or("/dev/spidev0.0")), spiDataReadyLine);
                     if (bus->connect() != I_CommunicationInterface::Error_t::OK)
                     {
                         m_logger.error("Could not connect USB device!");
-                        return {};
+                        return nullptr;
                     }
                     break;
                 default:
                     m_logger.error("Unimplemented bus type");
-                    return {};
+                    return nullptr;
+            }
+            return bus;
+        }
+
+        /// @brief Create and initialize the CANdle on an already connected interface
+        std::optional<Candle*> build(std::unique_ptr<I_CommunicationInterface> bus) const
+        {
+            if (datarate == nullptr || bus == nullptr)
+            {
+                m_logger.error("Parameters missing. Could create Candle.");
+                return {};
             }
-            Candle* candle = new Candle(*datarate, std::move(bus), useCAN20Frames.value_or(false));
-            if (candle == nullptr || candle->init() != candleTypes::Error_t::OK)
+            // released only once initialized, so that a failed candle does not keep its bus
+            auto candle =
+                std::make_unique<Candle>(*datarate, std::move(bus), useCAN20Frames.value_or(false));
+            if (candle->init() != candleTypes::Error_t::OK)
             {
                 m_logger.error("Could not initialize CANdle device!");
                 return {};
             }
-            return candle;
+            return candle.release();
         }
     };
 }  // namespace mab
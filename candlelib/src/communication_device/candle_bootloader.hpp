@@ -1,4 +1,5 @@
 #pragma once
+#include <chrono>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -39,6 +40,9 @@ namespace mab
 
         static constexpr size_t PAGE_SIZE_STM32G474 = 0x800;
 
+        /// @brief Time given to the CANdle to reboot from the app into the bootloader
+        static constexpr std::chrono::milliseconds REBOOT_TIMEOUT = std::chrono::milliseconds(3000);
+
         /* implementation inside candle bootloader */
         static constexpr size_t CANDLE_BOOTLOADER_BUFFER_SIZE = 0x800;
 
@@ -71,8 +75,11 @@ namespace mab
         Logger log(Logger::ProgramLayer_E::TOP, "BOOTLOADER_PRELOADER");
         log.info("Looking for CANdle...");
 
+        // Both interfaces share one locator, so the bootloader is detected as soon as it enumerates
+        auto locator = UsbDeviceLocator::getShared();
+
         // Detecting candle app and enter bootloader command if present
-        auto busApp = std::make_unique<USB>(Candle::CANDLE_VID, Candle::CANDLE_PID);
+        auto busApp = std::make_unique<USB>(Candle::CANDLE_VID, Candle::CANDLE_PID, "", locator);
         if (busApp->connect() == I_CommunicationInterface::Error_t::OK)
         {
             log.info("Found! Rebooting to bootloader...");
@@ -81,7 +88,6 @@ namespace mab
                 log.error("Failed to communicate with candle");
                 return {};
             }
-            usleep(1000000);  // wait for reboot TODO: maybe change to something more robust
         }
         else
         {
@@ -90,12 +96,17 @@ namespace mab
 
         // Bootloader connection
         log.info("Looking for bootloader...");
-        busApp = nullptr;  // necessary because context exit in libusb destroys ALL of the contexts
-                           // for some reason! So no implementation can live while the
-                           // libusb_exit(context) is called.
+        if (!locator->waitForDevice(CandleBootloader::BOOTLOADER_VID,
+                                    CandleBootloader::BOOTLOADER_PID,
+                                    "",
+                                    CandleBootloader::REBOOT_TIMEOUT))
+        {
+            log.error("Bootloader not found!");
+            return {};
+        }
 
-        auto busBoot = std::make_unique<USB>(CandleBootloader::BOOTLOADER_VID,
-                                             CandleBootloader::BOOTLOADER_PID);
+        auto busBoot = std::make_unique<USB>(
+            CandleBootloader::BOOTLOADER_VID, CandleBootloader::BOOTLOADER_PID, "", locator);
         if (busBoot->connect() == I_CommunicationInterface::Error_t::OK)
         {
             log.info("Found!");
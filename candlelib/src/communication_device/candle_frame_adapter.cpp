@@ -1,5 +1,6 @@
 #include "candle_frame_adapter.hpp"
 #include "algorithm"
+#include "bit"
 #include "chrono"
 #include "crc.hpp"
 namespace mab
@@ -16,31 +17,14 @@ namespace mab
         }
 
         std::unique_lock lock(m_mutex);
-        const size_t     seqIdx = m_count++;
-        CANdleFrame      cf;
-        u8               buf[cf.DTO_SIZE] = {0};
-
-        // Fill and serialize frame object
-        cf.init(canId, m_count, timeout100us);
-        if (cf.addData(data.data(), data.size()) != CANdleFrame::Error_t::OK)
+        const auto       seqIdx = appendFrame(canId, data, timeout100us);
+        if (!seqIdx.has_value())
         {
-            m_log.error("Could not generate CANdle Frame!");
+            m_sem.release();
             return std::make_pair<std::vector<u8>, Error_t>({}, Error_t::INVALID_BUS_FRAME);
         }
-        cf.serialize(buf);
         u64 thisFrameIdx = m_frameIndex;
-        m_packedFrames[m_frameIndex].insert(
-            m_packedFrames[m_frameIndex].end(), buf, buf + cf.DTO_SIZE);
-
-        // Notify host object that the reader must run
-        if (auto func = m_requestTransfer.lock())
-        {
-            (*func)();
-        }
-        else
-        {
-            m_log.warn("No thread to notify to start transfer!");
-        }
+        notifyTransfer();
 
         // Add notifier if not done for this frame
         if (m_notifiers.find(thisFrameIdx) == m_notifiers.end())
@@ -57,6 +41,18 @@ namespace mab
             m_log.error("Frame writer timed out! Frame was lost");
             return std::make_pair<std::vector<u8>, Error_t>({}, Error_t::READER_TIMEOUT);
         }
+        if (auto corruptIt = m_corrupted.find(thisFrameIdx); corruptIt != m_corrupted.end())
+        {
+            const u8 slot = (u8)(1 << seqIdx.value());
+            if (corruptIt->second & slot)
+            {
+                corruptIt->second &= (u8)~slot;
+                if (corruptIt->second == 0)
+                    m_corrupted.erase(corruptIt);
+                return std::make_pair<std::vector<u8>, Error_t>({}, Error_t::INVALID_CANDLE_FRAME);
+            }
+        }
+
         auto responseIt = m_responseBuffer.find(thisFrameIdx);
         if (responseIt == m_responseBuffer.end())
         {
@@ -65,8 +61,8 @@ namespace mab
             return std::make_pair<std::vector<u8>, Error_t>(std::vector<u8>(), Error_t::FRAME_LOST);
         }
 
-        auto buff = m_responseBuffer[thisFrameIdx][seqIdx];
-        m_responseBuffer[thisFrameIdx][seqIdx].clear();
+        auto buff = m_responseBuffer[thisFrameIdx][seqIdx.value()];
+        m_responseBuffer[thisFrameIdx][seqIdx.value()].clear();
         bool shouldDelete = true;
         for (auto responseCANFrames : m_responseBuffer[thisFrameIdx])
         {
@@ -82,6 +78,71 @@ namespace mab
         return std::make_pair<std::vector<u8>, Error_t>(std::vector(std::move(buff)), Error_t::OK);
     }
 
+    CANdleFrameAdapter::Error_t CANdleFrameAdapter::postFrame(const canId_t          canId,
+                                                              const std::vector<u8>& data)
+    {
+        auto success = m_sem.try_acquire_for(std::chrono::milliseconds(READER_TIMEOUT));
+        if (!success)
+        {
+            m_log.error("Frame timed out! CANdle is overloaded!");
+            return Error_t::READER_TIMEOUT;
+        }
+
+        std::unique_lock lock(m_mutex);
+        // zero timeout, the CANdle does not wait for the node to respond
+        const auto seqIdx = appendFrame(canId, data, 0);
+        if (!seqIdx.has_value())
+        {
+            m_sem.release();
+            return Error_t::INVALID_BUS_FRAME;
+        }
+        m_unacknowledged[m_frameIndex] |= (u8)(1 << seqIdx.value());
+        notifyTransfer();
+        return Error_t::OK;
+    }
+
+    std::optional<size_t> CANdleFrameAdapter::appendFrame(const canId_t          canId,
+                                                          const std::vector<u8>& data,
+                                                          const u16              timeout100us)
+    {
+        const size_t seqIdx = m_count;
+        CANdleFrame  cf;
+        u8           buf[cf.DTO_SIZE] = {0};
+
+        // Fill and serialize frame object
+        cf.init(canId, seqIdx + 1, timeout100us);
+        if (cf.addData(data.data(), data.size()) != CANdleFrame::Error_t::OK)
+        {
+            m_log.error("Could not generate CANdle Frame!");
+            return std::nullopt;
+        }
+        m_count++;
+        cf.serialize(buf);
+        m_packedFrames[m_frameIndex].insert(
+            m_packedFrames[m_frameIndex].end(), buf, buf + cf.DTO_SIZE);
+        return seqIdx;
+    }
+
+    void CANdleFrameAdapter::failPackedFrame(const u64 idx, const u8 unacknowledged)
+    {
+        // the response can not be trusted, so none of its frames gets a response
+        m_corrupted[idx] = (u8)(((1 << FRAME_BUFFER_SIZE) - 1) & ~unacknowledged);
+        m_notifiers[idx].notify_all();
+    }
+
+    void CANdleFrameAdapter::notifyTransfer()
+    {
+        // Notify host object that the reader must run
+        if (auto func = m_requestTransfer.lock())
+        {
+            (*func)();
+        }
+        else
+        {
+            m_log.warn("No thread to notify to start transfer!");
+        }
+    }
+
     std::pair<std::vector<u8>, std::atomic<u64>> CANdleFrameAdapter::getPackedFrame()
     {
         std::unique_lock lock(m_mutex);
@@ -103,6 +164,12 @@ namespace mab
 
         lock.unlock();
 
+        finalizePackedFrame(packedFrame, count);
+        return std::make_pair(packedFrame, m_frameIndex - 1);
+    }
+
+    void CANdleFrameAdapter::finalizePackedFrame(std::vector<u8>& packedFrame, const u8 count)
+    {
         auto countIter      = packedFrame.begin() + 2 /*PARSE_ID + ACK*/;
         *countIter          = count;
         u32 calculatedCRC32 = Crc::calcCrc((const char*)packedFrame.data(), packedFrame.size());
@@ -110,7 +177,35 @@ namespace mab
         packedFrame.push_back(calculatedCRC32 >> 8);
         packedFrame.push_back(calculatedCRC32 >> 16);
         packedFrame.push_back(calculatedCRC32 >> 24);
-        return std::make_pair(packedFrame, m_frameIndex - 1);
+    }
+
+    std::vector<std::vector<u8>> CANdleFrameAdapter::packFrames(
+        const std::vector<std::pair<canId_t, std::vector<u8>>>& frames)
+    {
+        std::vector<std::vector<u8>> packedFrames;
+        u8                           count = 0;
+        for (const auto& [canId, data] : frames)
+        {
+            if (count == FRAME_BUFFER_SIZE)
+            {
+                finalizePackedFrame(packedFrames.back(), count);
+                count = 0;
+            }
+            if (count == 0)
+                packedFrames.push_back({CANdleFrame::DTO_PARSE_ID, 0x1, 0x0});
+
+            CANdleFrame cf;
+            u8          buf[cf.DTO_SIZE] = {0};
+            cf.init(canId, count + 1, 0);
+            if (cf.addData(data.data(), data.size()) != CANdleFrame::Error_t::OK)
+                return {};
+            cf.serialize(buf);
+            packedFrames.back().insert(packedFrames.back().end(), buf, buf + cf.DTO_SIZE);
+            count++;
+        }
+        if (count != 0)
+            finalizePackedFrame(packedFrames.back(), count);
+        return packedFrames;
     }
 
     CANdleFrameAdapter::Error_t CANdleFrameAdapter::parsePackedFrame(
@@ -118,19 +213,26 @@ namespace mab
     {
         std::unique_lock lock(m_mutex);
 
+        u8 unacknowledged = 0;
+        if (auto it = m_unacknowledged.find(idx); it != m_unacknowledged.end())
+        {
+            unacknowledged = it->second;
+            m_unacknowledged.erase(it);
+        }
+
         m_responseBuffer[idx] = std::array<std::vector<u8>, FRAME_BUFFER_SIZE>();
         auto pfIterator       = packedFrames.begin();
         if (*pfIterator != CANdleFrame::DTO_PARSE_ID)
         {
             m_log.error("Wrong parse ID of CANdle Frames!");
-            m_notifiers[idx].notify_all();
+            failPackedFrame(idx, unacknowledged);
             return Error_t::INVALID_BUS_FRAME;
         }
         pfIterator++;
         if (!*pfIterator /*ACK*/)
         {
             m_log.error("Error inside the CANdle Device!");
-            m_notifiers[idx].notify_all();
+            failPackedFrame(idx, unacknowledged);
             return Error_t::INVALID_BUS_FRAME;
         }
         pfIterator++;
@@ -140,7 +242,7 @@ namespace mab
                 PACKED_SIZE - ((FRAME_BUFFER_SIZE - count) * CANdleFrame::DTO_SIZE))
         {
             m_log.error("Invalid message size!");
-            m_notifiers[idx].notify_all();
+            failPackedFrame(idx, unacknowledged);
             return Error_t::INVALID_BUS_FRAME;
         }
 
@@ -155,11 +257,13 @@ namespace mab
         if (readCRC32 != calculatedCRC32)
         {
             m_log.error("Invalid message checksum! 0x%08x != 0x%08x", readCRC32, calculatedCRC32);
-            m_notifiers[idx].notify_all();
+            failPackedFrame(idx, unacknowledged);
             return Error_t::INVALID_BUS_FRAME;
         }
         pfIterator -= count * CANdleFrame::DTO_SIZE;  // Rollback to the data head
 
+        const bool nobodyWaits = std::popcount(unacknowledged) == count;
+
         Error_t err = Error_t::OK;
         for (; count != 0; count--)
         {
@@ -177,11 +281,18 @@ namespace mab
                 continue;
             }
             size_t subidx = cf.sequenceNo() - 1;
+            if (unacknowledged & (1 << subidx))
+                continue;
             m_log.debug("Parsing bus frame %u with CAN frame %u", idx.load(), subidx + 1);
             m_responseBuffer[idx][subidx].insert(
                 m_responseBuffer[idx][subidx].begin(), cf.data(), cf.data() + cf.length());
         }
         m_notifiers[idx].notify_all();
+        if (nobodyWaits)
+        {
+            m_responseBuffer.erase(idx);
+            m_notifiers.erase(idx);
+        }
 
         m_log.debug("Memory state data:");
         m_log.debug("Packed frames size: %u ; Responses size: %u ; Notifiers size: %u",
@@ -205,6 +316,13 @@ namespace mab
                 m_responseBuffer.erase(idx);
                 m_notifiers.erase(idx);
             }
+            std::erase_if(m_corrupted,
+                          [this](const auto& entry)
+                          { return entry.first + DEPRECATION_FRAME_COUNT < m_frameIndex; });
+            // packed frames which never came back from the bus
+            std::erase_if(m_unacknowledged,
+                          [this](const auto& entry)
+                          { return entry.first + DEPRECATION_FRAME_COUNT < m_frameIndex; });
         }
         return err;
     }
@@ -67,6 +67,21 @@ namespace mab
                                                             const std::vector<u8>& data,
                                                             const u16              timeout100us);
 
+        /// @brief Queue CAN frame without waiting for the node response. The frame slot is freed
+        /// as soon as the packed frame is handed to the bus and whatever the node answers is
+        /// dropped
+        /// @param canId Target CAN node ID
+        /// @param data Data to be transferred via CAN bus
+        /// @return OK when the frame was queued, error code otherwise
+        Error_t postFrame(const canId_t canId, const std::vector<u8>& data);
+
+        /// @brief Pack CAN frames into complete packed frames without touching the accumulation
+        /// buffer. The frames have zero timeout, so the CANdle does not wait for the nodes.
+        /// @param frames CAN ID and data of every frame
+        /// @return packed frames ready to be sent via bus, empty if any of the frames is invalid
+        static std::vector<std::vector<u8>> packFrames(
+            const std::vector<std::pair<canId_t, std::vector<u8>>>& frames);
+
         /// @brief Get packed frame ready to be sent via bus, clears internal buffer for fresh frame
         /// accumulation
         /// @return packed candle frames (Header,ACK placeholder, length, candle frame(s), CRC32)
@@ -94,11 +109,32 @@ namespace mab
             std::make_pair<u64, std::vector<u8>>(0, {CANdleFrame::DTO_PARSE_ID, 0x1, 0x0})};
         std::unordered_map<u64, std::array<std::vector<u8>, FRAME_BUFFER_SIZE>> m_responseBuffer;
         std::unordered_map<u64, std::condition_variable>                        m_notifiers;
+        /// @brief Sequence slots of the packed frames nobody waits for, bit 0 is the first frame
+        std::unordered_map<u64, u8> m_unacknowledged;
+        /// @brief Sequence slots of the packed frames which came back damaged, bit 0 is the first
+        /// frame, cleared by the waiting frames
+        std::unordered_map<u64, u8> m_corrupted;
 
         std::mutex m_mutex;
         // std::condition_variable   m_cv;
         std::counting_semaphore<> m_sem = std::counting_semaphore<>((ptrdiff_t)FRAME_BUFFER_SIZE);
 
         const std::weak_ptr<std::function<void(void)>> m_requestTransfer;
+
+        /// @brief Serialize frame into the currently accumulated packed frame, must be called with
+        /// the mutex locked
+        /// @return sequence index of the frame inside of the packed frame
+        std::optional<size_t> appendFrame(const canId_t          canId,
+                                          const std::vector<u8>& data,
+                                          const u16              timeout100us);
+
+        void notifyTransfer();
+
+        /// @brief Wake up the frames waiting for the packed frame and report them as damaged,
+        /// must be called with the mutex locked
+        void failPackedFrame(const u64 idx, const u8 unacknowledged);
+
+        /// @brief Fill in the frame count and append CRC32 of the packed frame
+        static void finalizePackedFrame(std::vector<u8>& packedFrame, const u8 count);
     };
 }  // namespace mab
@@ -111,3 +111,45 @@ TEST_F(CandleFrameAdapterTest, readerFailError)
     }
     EXPECT_EQ(CANdleFrameAdapter::Error_t::READER_TIMEOUT, lastResult);
 }
+
+TEST_F(CandleFrameAdapterTest, postedFramesReleaseSlotOnTransmit)
+{
+    mab::CANdleFrameAdapter cfa(m_sync);
+
+    for (size_t i = 0; i < CANdleFrameAdapter::FRAME_BUFFER_SIZE; i++)
+        EXPECT_EQ(CANdleFrameAdapter::Error_t::OK, cfa.postFrame(100 + i, mockDataVector[i]));
+    EXPECT_EQ(CANdleFrameAdapter::FRAME_BUFFER_SIZE, cfa.getCount());
+
+    // slots are free before the response is parsed
+    auto fr = cfa.getPackedFrame();
+    EXPECT_EQ(CANdleFrameAdapter::Error_t::OK, cfa.postFrame(100, mockDataVector[0]));
+    EXPECT_EQ(CANdleFrameAdapter::Error_t::OK, cfa.parsePackedFrame(fr.first, fr.second.load()));
+}
+
+TEST_F(CandleFrameAdapterTest, postedFramesMixWithAcknowledged)
+{
+    mab::CANdleFrameAdapter cfa(m_sync);
+
+    std::jthread thread(&CandleFrameAdapterTest::mockReadWrite, this, &cfa);
+
+    std::vector<std::future<std::pair<std::vector<u8>, CANdleFrameAdapter::Error_t>>> futures;
+    for (size_t i = 0; i < CANDLE_FRAME_COUNT; i++)
+    {
+        EXPECT_EQ(CANdleFrameAdapter::Error_t::OK, cfa.postFrame(100, mockDataVector[i]));
+        futures.push_back(std::async(std::launch::async,
+                                     &CANdleFrameAdapter::accumulateFrame,
+                                     &cfa,
+                                     200,
+                                     mockDataVector[i],
+                                     10));
+    }
+
+    for (size_t i = 0; i < futures.size(); i++)
+    {
+        auto result = futures[i].get();
+        EXPECT_EQ(CANdleFrameAdapter::Error_t::OK, result.second);
+        EXPECT_EQ(mockDataVector[i], result.first);
+    }
+    thread.request_stop();
+    m_binSem.release();
+}
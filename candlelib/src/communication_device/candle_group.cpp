@@ -0,0 +1,202 @@
+#include "candle_group.hpp"
+
+#include <algorithm>
+#include <future>
+#include <set>
+
+namespace mab
+{
+    CandleGroup::CandleGroup(std::vector<std::unique_ptr<Candle>>&& candles,
+                             const std::vector<BusConfig_S>&        topology)
+    {
+        if (candles.size() != topology.size())
+            throw std::runtime_error("Number of CANdles does not match the topology!");
+
+        for (size_t busIdx = 0; busIdx < candles.size(); busIdx++)
+        {
+            auto bus    = std::make_unique<Bus_S>();
+            bus->candle = std::move(candles[busIdx]);
+            bus->nodes  = topology[busIdx].nodes;
+            for (const canId_t canId : bus->nodes)
+            {
+                if (!m_routes.emplace(canId, busIdx).second)
+                    m_log.warn("Node %d declared on more than one bus, using the first one", canId);
+            }
+            Bus_S* busPtr = bus.get();
+            bus->worker =
+                std::jthread([busPtr](std::stop_token stopToken) { workerLoop(*busPtr, stopToken); });
+            m_buses.push_back(std::move(bus));
+        }
+        m_log.debug("Created group of %d CANdles", m_buses.size());
+    }
+
+    CandleGroup::~CandleGroup()
+    {
+        flush();
+        for (auto& bus : m_buses)
+        {
+            bus->worker.request_stop();
+            bus->jobCv.notify_all();
+            if (bus->worker.joinable())
+                bus->worker.join();
+        }
+    }
+
+    Candle* CandleGroup::getCandle(const size_t busIdx) const
+    {
+        if (busIdx >= m_buses.size())
+            return nullptr;
+        return m_buses[busIdx]->candle.get();
+    }
+
+    std::optional<size_t> CandleGroup::busOf(const canId_t canId) const
+    {
+        auto route = m_routes.find(canId);
+        if (route == m_routes.end())
+            return std::nullopt;
+        return route->second;
+    }
+
+    void CandleGroup::post(const size_t busIdx, std::function<void(Candle&)> job)
+    {
+        if (busIdx >= m_buses.size())
+        {
+            m_log.error("Bus %d does not exist!", busIdx);
+            return;
+        }
+        Bus_S& bus = *m_buses[busIdx];
+        {
+            std::unique_lock lock(bus.mux);
+            bus.jobs.emplace_back([&bus, job = std::move(job)]() { job(*bus.candle); });
+        }
+        bus.jobCv.notify_one();
+    }
+
+    void CandleGroup::flush()
+    {
+        for (auto& bus : m_buses)
+        {
+            std::unique_lock lock(bus->mux);
+            bus->idleCv.wait(lock, [&bus]() { return bus->jobs.empty() && !bus->busy; });
+        }
+    }
+
+    std::chrono::microseconds CandleGroup::cycle(const BusTask_t& task)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t busIdx = 0; busIdx < m_buses.size(); busIdx++)
+        {
+            const auto& nodes = m_buses[busIdx]->nodes;
+            post(busIdx, [busIdx, &nodes, &task](Candle& candle) { task(busIdx, candle, nodes); });
+        }
+        flush();
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+    }
+
+    void CandleGroup::workerLoop(Bus_S& bus, std::stop_token stopToken)
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock lock(bus.mux);
+                bus.jobCv.wait(lock,
+                               [&bus, &stopToken]()
+                               { return !bus.jobs.empty() || stopToken.stop_requested(); });
+                if (bus.jobs.empty())
+                    return;
+                job = std::move(bus.jobs.front());
+                bus.jobs.pop_front();
+                bus.busy = true;
+            }
+            job();
+            {
+                std::unique_lock lock(bus.mux);
+                bus.busy = false;
+            }
+            bus.idleCv.notify_all();
+        }
+    }
+
+    std::unique_ptr<CandleGroup> attachCandleGroup(
+        const std::vector<CandleGroup::BusConfig_S>& topology)
+    {
+        Logger log(Logger::ProgramLayer_E::TOP, "CANDLE_GROUP_BUILDER");
+
+        // with several buses every one has to name its device, otherwise all of them would
+        // claim the first CANdle found
+        if (topology.size() > 1)
+        {
+            std::set<std::string> serials;
+            for (const auto& busConfig : topology)
+            {
+                if (busConfig.serialNo.empty())
+                {
+                    log.error("Every bus of a multi CANdle group needs a serial number!");
+                    return nullptr;
+                }
+                if (!serials.insert(busConfig.serialNo).second)
+                {
+                    log.error("CANdle %s is assigned to more than one bus!",
+                              busConfig.serialNo.c_str());
+                    return nullptr;
+                }
+            }
+        }
+
+        // keeps the context alive for the whole bring-up so it is not recreated per device
+        auto locator = UsbDeviceLocator::getShared();
+
+        // devices are located and claimed one by one, locating peeks at the devices on the bus
+        // and must not race with another bus claiming them. Only the CANdle initialization,
+        // which takes most of the time, runs in parallel.
+        std::vector<CandleBuilder>                             builders(topology.size());
+        std::vector<std::unique_ptr<I_CommunicationInterface>> buses;
+        bool                                                    allAttached = true;
+        for (size_t busIdx = 0; busIdx < topology.size(); busIdx++)
+        {
+            const auto&    busConfig = topology[busIdx];
+            CandleBuilder& builder   = builders[busIdx];
+            builder.datarate         = std::make_shared<CANdleDatarate_E>(busConfig.datarate);
+            builder.busType          = std::make_shared<candleTypes::busTypes_t>(busConfig.busType);
+            builder.useCAN20Frames   = busConfig.useCAN20Frames;
+            builder.usbLocator       = locator;
+            if (!busConfig.serialNo.empty())
+                builder.pathOrId = busConfig.serialNo;
+            buses.push_back(builder.connectBus());
+            if (buses.back() == nullptr)
+            {
+                log.error("Could not connect CANdle %s!", busConfig.serialNo.c_str());
+                allAttached = false;
+            }
+        }
+        if (!allAttached)
+            return nullptr;
+
+        std::vector<std::future<std::optional<Candle*>>> pending;
+        for (size_t busIdx = 0; busIdx < topology.size(); busIdx++)
+        {
+            pending.push_back(std::async(std::launch::async,
+                                         [&builder = builders[busIdx],
+                                          bus      = std::move(buses[busIdx])]() mutable
+                                         { return builder.build(std::move(bus)); }));
+        }
+
+        std::vector<std::unique_ptr<Candle>> candles;
+        for (size_t busIdx = 0; busIdx < pending.size(); busIdx++)
+        {
+            auto candle = pending[busIdx].get();
+            if (!candle.has_value() || candle.value() == nullptr)
+            {
+                log.error("Could not attach CANdle %s!", topology[busIdx].serialNo.c_str());
+                allAttached = false;
+                continue;
+            }
+            candles.emplace_back(candle.value());
+        }
+        if (!allAttached)
+            return nullptr;
+        return std::make_unique<CandleGroup>(std::move(candles), topology);
+    }
+}  // namespace mab
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "candle.hpp"
+#include "candle_types.hpp"
+#include "logger.hpp"
+#include "mab_types.hpp"
+
+namespace mab
+{
+    /// @brief Set of CANdle devices working as one system. Every CANdle gets its own worker thread
+    /// so transfers on separate buses run concurrently, and devices on the network are routed to
+    /// the CANdle they are physically connected to according to the declared topology.
+    class CandleGroup
+    {
+      public:
+        /// @brief Description of a single CAN bus of the group
+        struct BusConfig_S
+        {
+            std::string             serialNo;  ///< CANdle serial number (or SPI device path)
+            CANdleDatarate_E        datarate       = CANdleDatarate_E::CAN_DATARATE_1M;
+            candleTypes::busTypes_t busType        = candleTypes::busTypes_t::USB;
+            bool                    useCAN20Frames = false;
+            std::vector<canId_t>    nodes;  ///< CAN ids of the devices connected to this bus
+        };
+
+        /// @brief Per bus task executed during the cycle
+        using BusTask_t =
+            std::function<void(size_t busIdx, Candle& candle, const std::vector<canId_t>& nodes)>;
+
+        CandleGroup(const CandleGroup&)            = delete;
+        CandleGroup& operator=(const CandleGroup&) = delete;
+        ~CandleGroup();
+
+        /// @brief Create group from already initialized CANdles
+        /// @param candles CANdle devices, one per bus
+        /// @param topology bus descriptions in the same order as candles, only nodes are used
+        CandleGroup(std::vector<std::unique_ptr<Candle>>&& candles,
+                    const std::vector<BusConfig_S>&        topology);
+
+        /// @brief Number of buses in the group
+        size_t size() const
+        {
+            return m_buses.size();
+        }
+
+        /// @brief Get CANdle handling the bus
+        /// @return nullptr if out of range
+        Candle* getCandle(const size_t busIdx) const;
+
+        /// @brief Get nodes declared on the bus
+        const std::vector<canId_t>& getNodes(const size_t busIdx) const
+        {
+            return m_buses.at(busIdx)->nodes;
+        }
+
+        /// @brief Get index of the bus the node is connected to
+        std::optional<size_t> busOf(const canId_t canId) const;
+
+        /// @brief Create device handle (MD, MDCO, Pds) bound to the CANdle the node is connected to
+        /// @param canId CAN id of the node, must be declared in the topology
+        /// @param args additional constructor arguments following canId and Candle pointer
+        /// @return Device handle or nullptr if the node is not a part of the topology
+        template <typename Device_T, typename... Args>
+        std::unique_ptr<Device_T> attach(const canId_t canId, Args&&... args) const
+        {
+            auto busIdx = busOf(canId);
+            if (!busIdx.has_value())
+            {
+                m_log.error("Node %d is not a part of the topology!", canId);
+                return nullptr;
+            }
+            return std::make_unique<Device_T>(
+                canId, m_buses[busIdx.value()]->candle.get(), std::forward<Args>(args)...);
+        }
+
+        /// @brief Queue a job on the worker of the bus, jobs of one bus are executed in order
+        void post(const size_t busIdx, std::function<void(Candle&)> job);
+
+        /// @brief Block until all jobs queued on all buses are finished
+        void flush();
+
+        /// @brief Run the task for every bus concurrently and wait for all of them to finish
+        /// @return Time it took for the slowest bus to complete the task
+        std::chrono::microseconds cycle(const BusTask_t& task);
+
+      private:
+        struct Bus_S
+        {
+            std::unique_ptr<Candle>           candle;
+            std::vector<canId_t>              nodes;
+            std::mutex                        mux;
+            std::condition_variable           jobCv;
+            std::condition_variable           idleCv;
+            std::deque<std::function<void()>> jobs;
+            bool                              busy = false;
+            std::jthread                      worker;
+        };
+
+        Logger m_log = Logger(Logger::ProgramLayer_E::TOP, "CANDLE_GROUP");
+
+        std::vector<std::unique_ptr<Bus_S>>  m_buses;
+        std::unordered_map<canId_t, size_t> m_routes;
+
+        static void workerLoop(Bus_S& bus, std::stop_token stopToken);
+    };
+
+    /// @brief Open all CANdles of the topology in parallel and create a group out of them. All USB
+    /// devices share one libusb context and event thread.
+    /// @param topology bus descriptions, one per CANdle
+    /// @return Configured group or nullptr if any of the CANdles could not be initialized
+    std::unique_ptr<CandleGroup> attachCandleGroup(
+        const std::vector<CandleGroup::BusConfig_S>& topology);
+}  // namespace mab
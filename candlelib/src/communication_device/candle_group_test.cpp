@@ -0,0 +1,139 @@
+#include <I_communication_interface_mock.hpp>
+#include <candle_group.hpp>
+#include <cycle_coordinator.hpp>
+#include <MD.hpp>
+#include <mab_types.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+using ::testing::_;
+using ::testing::Return;
+
+class CandleGroupTest : public ::testing::Test
+{
+  protected:
+    std::vector<mab::CandleGroup::BusConfig_S> topology;
+    std::unique_ptr<mab::CandleGroup>          group;
+
+    void SetUp() override
+    {
+        Logger::g_m_verbosity          = Logger::Verbosity_E::SILENT;
+        ::testing::FLAGS_gmock_verbose = "error";
+
+        topology.push_back({.serialNo = "A", .nodes = {100, 101}});
+        topology.push_back({.serialNo = "B", .nodes = {200}});
+
+        std::vector<std::unique_ptr<mab::Candle>> candles;
+        for (size_t i = 0; i < topology.size(); i++)
+        {
+            auto bus = std::make_unique<MockBus>();
+            EXPECT_CALL(*bus, connect())
+                .WillRepeatedly(Return(mab::I_CommunicationInterface::Error_t::OK));
+            EXPECT_CALL(*bus, transfer(_, _, _))
+                .WillRepeatedly(Return(std::pair(std::vector<u8>({0x2, 0x1}),
+                                                 mab::I_CommunicationInterface::Error_t::OK)));
+            candles.emplace_back(mab::attachCandle(mab::CAN_DATARATE_1M, std::move(bus)));
+        }
+        group = std::make_unique<mab::CandleGroup>(std::move(candles), topology);
+    }
+};
+
+TEST_F(CandleGroupTest, routesNodesToTheirBus)
+{
+    EXPECT_EQ(group->busOf(101), 0u);
+    EXPECT_EQ(group->busOf(200), 1u);
+    EXPECT_FALSE(group->busOf(300).has_value());
+
+    auto md = group->attach<mab::MD>(200);
+    ASSERT_NE(md, nullptr);
+    EXPECT_EQ(md->m_canId, 200);
+    EXPECT_EQ(group->attach<mab::MD>(300), nullptr);
+}
+
+TEST_F(CandleGroupTest, cycleRunsBusesConcurrently)
+{
+    std::mutex              mux;
+    std::condition_variable cv;
+    size_t                  arrived = 0;
+    std::atomic<size_t>     met     = 0;
+
+    group->cycle(
+        [&](size_t busIdx, mab::Candle& candle, const std::vector<mab::canId_t>& nodes)
+        {
+            EXPECT_EQ(&candle, group->getCandle(busIdx));
+            EXPECT_EQ(nodes, topology[busIdx].nodes);
+            // every bus waits for all the others, which only succeeds if they run in parallel
+            std::unique_lock lock(mux);
+            arrived++;
+            cv.notify_all();
+            if (cv.wait_for(lock,
+                            std::chrono::seconds(1),
+                            [&]() { return arrived == topology.size(); }))
+                met++;
+        });
+    EXPECT_EQ(met.load(), topology.size());
+}
+
+TEST_F(CandleGroupTest, flushWaitsForPostedJobs)
+{
+    std::atomic<int> done = 0;
+    for (int i = 0; i < 10; i++)
+        group->post(i % 2, [&done](mab::Candle&) { done++; });
+    group->flush();
+    EXPECT_EQ(done.load(), 10);
+}
+
+TEST_F(CandleGroupTest, coordinatorDelaysFasterBus)
+{
+    using namespace std::chrono_literals;
+    using TimePoint_t = mab::CycleCoordinator::TimePoint_t;
+
+    // every worker thread keeps its own fake time, waiting jumps straight to the deadline
+    static thread_local TimePoint_t fakeNow;
+    // bus 1 needs 4 ms longer for the round trip than bus 0
+    const std::vector<std::chrono::microseconds> roundTrips = {1000us, 5000us};
+
+    mab::CycleCoordinator::TimeSource_S timeSource;
+    timeSource.now       = []() { return fakeNow; };
+    timeSource.waitUntil = [](const TimePoint_t deadline)
+    { fakeNow = std::max(fakeNow, deadline); };
+    timeSource.busTiming = [&](mab::Candle& candle)
+    {
+        const size_t busIdx = group->getCandle(0) == &candle ? 0 : 1;
+        return mab::Candle::BusTiming_S{fakeNow, fakeNow + roundTrips[busIdx]};
+    };
+    timeSource.resetBusTiming = [](mab::Candle&) {};
+
+    mab::CycleCoordinator coordinator(*group, 100us, timeSource);
+    auto task = [](size_t, mab::Candle&, const std::vector<mab::canId_t>&) {};
+
+    // without estimates both buses are released together, frames of bus 1 land 2 ms later
+    auto report = coordinator.run(task);
+    EXPECT_EQ(report.achievedSkew, 2000us);
+    EXPECT_FALSE(report.withinWindow);
+    EXPECT_EQ(report.latencies[1], 5000us);
+
+    report = coordinator.run(task);
+    ASSERT_EQ(report.releaseOffsets.size(), 2u);
+    EXPECT_EQ(report.releaseOffsets[0], 2000us);
+    EXPECT_EQ(report.releaseOffsets[1], 0us);
+    EXPECT_EQ(report.achievedSkew, 0us);
+    EXPECT_TRUE(report.withinWindow);
+    EXPECT_GT(coordinator.getLatencyEstimate(1), coordinator.getLatencyEstimate(0));
+}
+
+TEST_F(CandleGroupTest, attachRejectsAmbiguousTopology)
+{
+    // devices are never touched when the buses can not be told apart
+    std::vector<mab::CandleGroup::BusConfig_S> unnamed = {{.serialNo = "A"}, {.serialNo = ""}};
+    EXPECT_EQ(mab::attachCandleGroup(unnamed), nullptr);
+
+    std::vector<mab::CandleGroup::BusConfig_S> duplicated = {{.serialNo = "A"}, {.serialNo = "A"}};
+    EXPECT_EQ(mab::attachCandleGroup(duplicated), nullptr);
+}
@@ -1,10 +1,16 @@
 
 #include <I_communication_interface_mock.hpp>
 #include <candle.hpp>
+#include <cyclic_executor.hpp>
+#include <crc.hpp>
+#include <rtt_estimator.hpp>
 #include <mab_types.hpp>
 
+#include <atomic>
 #include <bit>
+#include <future>
 #include <memory>
+#include <thread>
 #include <variant>
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
@@ -18,6 +24,9 @@ class CandleTest : public ::testing::Test
     std::unique_ptr<MockBus> mockBus;
     std::vector<u8>          mockData;
     u32                      mockId = 100;
+    // datarate command response reporting firmware 2.4.1
+    std::vector<u8> versionResponse = {
+        mab::Candle::CandleCommands_t::CANDLE_CONFIG_DATARATE, 0x1, 'r', 1, 4, 2};
 
     struct __attribute__((packed)) exampleFrame_t
     {
@@ -47,6 +56,25 @@ TEST_F(CandleTest, failAttach)
     mab::detachCandle(candle);
 }
 
+TEST_F(CandleTest, failedBuildReleasesBus)
+{
+    EXPECT_CALL(*mockBus, transfer(_, _, _))
+        .WillRepeatedly(
+            Return(std::pair(mockData, mab::I_CommunicationInterface::Error_t::UNKNOWN_ERROR)));
+    bool disconnected = false;
+    EXPECT_CALL(*mockBus, disconnect())
+        .WillOnce(
+            [&]()
+            {
+                disconnected = true;
+                return mab::I_CommunicationInterface::Error_t::OK;
+            });
+    mab::CandleBuilder builder;
+    builder.datarate = std::make_shared<mab::CANdleDatarate_E>(mab::CAN_DATARATE_1M);
+    EXPECT_FALSE(builder.build(std::move(mockBus)).has_value());
+    EXPECT_TRUE(disconnected);
+}
+
 TEST_F(CandleTest, passAttach)
 {
     EXPECT_CALL(*mockBus, connect())
@@ -90,3 +118,442 @@ TEST_F(CandleTest, successAfterInit)
     ASSERT_EQ(result.second, mab::candleTypes::Error_t::OK);
     mab::detachCandle(candle);
 }
+
+TEST_F(CandleTest, busTimingCapturesFirstExchange)
+{
+    EXPECT_CALL(*mockBus, connect())
+        .Times(1)
+        .WillOnce(Return(mab::I_CommunicationInterface::Error_t::OK));
+    EXPECT_CALL(*mockBus, transfer(_, _, _))
+        .WillRepeatedly(Return(std::pair(mockData, mab::I_CommunicationInterface::Error_t::OK)));
+    auto candle = mab::attachCandle(mab::CAN_DATARATE_1M, std::move(mockBus));
+
+    candle->resetBusTiming();
+    EXPECT_FALSE(candle->getBusTiming().submitted.has_value());
+
+    const auto before = std::chrono::steady_clock::now();
+    ASSERT_EQ(candle->transferCANFrame(mockId, mockData, mockData.size()).second,
+              mab::candleTypes::Error_t::OK);
+    const auto first = candle->getBusTiming();
+    ASSERT_TRUE(first.submitted.has_value() && first.responded.has_value());
+    EXPECT_GE(*first.submitted, before);
+    EXPECT_GE(*first.responded, *first.submitted);
+
+    // later exchanges do not overwrite the first one
+    candle->transferCANFrame(mockId, mockData, mockData.size());
+    EXPECT_EQ(candle->getBusTiming().submitted, first.submitted);
+    mab::detachCandle(candle);
+}
+
+TEST_F(CandleTest, capabilitiesNegotiatedOnceAtInit)
+{
+    EXPECT_CALL(*mockBus, connect())
+        .Times(1)
+        .WillOnce(Return(mab::I_CommunicationInterface::Error_t::OK));
+    EXPECT_CALL(*mockBus, disconnect()).Times(1);
+    EXPECT_CALL(*mockBus, transfer(_, _, _))
+        .Times(1)
+        .WillOnce(Return(std::pair(versionResponse, mab::I_CommunicationInterface::Error_t::OK)));
+    auto candle = mab::attachCandle(mab::CAN_DATARATE_1M, std::move(mockBus));
+    ASSERT_NE(candle, nullptr);
+    for (int i = 0; i < 3; i++)
+    {
+        auto version = candle->getCandleVersion();
+        ASSERT_TRUE(version.has_value());
+        EXPECT_EQ(version.value().s.major, 2);
+        EXPECT_EQ(version.value().s.minor, 4);
+    }
+    EXPECT_TRUE(candle->getCapabilities().packedFrames);
+    EXPECT_TRUE(candle->getCapabilities().canFD);
+    mab::detachCandle(candle);
+}
+
+TEST_F(CandleTest, packedTransferWhenBusPrefersIt)
+{
+    EXPECT_CALL(*mockBus, connect())
+        .Times(1)
+        .WillOnce(Return(mab::I_CommunicationInterface::Error_t::OK));
+    EXPECT_CALL(*mockBus, preferPackedTransfers()).WillRepeatedly(Return(true));
+    EXPECT_CALL(*mockBus, transfer(_, _, _))
+        .Times(2)
+        .WillOnce(Return(std::pair(versionResponse, mab::I_CommunicationInterface::Error_t::OK)))
+        .WillOnce(
+            [](std::vector<u8> data, const u32, const size_t)
+            {
+                // CANdle echoes the packed frame back, which is a valid response
+                EXPECT_EQ(data.at(0), mab::CANdleFrame::DTO_PARSE_ID);
+                return std::pair(data, mab::I_CommunicationInterface::Error_t::OK);
+            });
+    auto candle = mab::attachCandle(mab::CAN_DATARATE_1M, std::move(mockBus));
+    auto result = candle->transferCANFrame(mockId, mockData, mockData.size());
+    ASSERT_EQ(result.second, mab::candleTypes::Error_t::OK);
+    EXPECT_EQ(result.first, mockData);
+    mab::detachCandle(candle);
+}
+
+TEST_F(CandleTest, reconnectAndRetryWhenBusIsLost)
+{
+    EXPECT_CALL(*mockBus, connect())
+        .Times(1)
+        .WillOnce(Return(mab::I_CommunicationInterface::Error_t::OK));
+    EXPECT_CALL(*mockBus, reconnect())
+        .Times(1)
+        .WillOnce(Return(mab::I_CommunicationInterface::Error_t::OK));
+    EXPECT_CALL(*mockBus, transfer(_, _, _))
+        .Times(4)
+        .WillOnce(Return(std::pair(mockData, mab::I_CommunicationInterface::Error_t::OK)))
+        .WillOnce(Return(
+            std::pair(std::vector<u8>(), mab::I_CommunicationInterface::Error_t::NOT_CONNECTED)))
+        .WillOnce(Return(std::pair(mockData, mab::I_CommunicationInterface::Error_t::OK)))
+        .WillOnce(Return(std::pair(mockData, mab::I_CommunicationInterface::Error_t::OK)));
+    auto candle = mab::attachCandle(mab::CAN_DATARATE_1M, std::move(mockBus));
+    auto result = candle->transferCANFrame(mockId, mockData, mockData.size());
+    ASSERT_EQ(result.second, mab::candleTypes::Error_t::OK);
+    EXPECT_EQ(candle->getMetrics().reconnects, 1u);
+    EXPECT_EQ(candle->getMetrics().failedReconnects, 0u);
+    mab::detachCandle(candle);
+}
+
+TEST(LatencyHistogramTest, bucketsArePowersOfTwo)
+{
+    using namespace std::chrono_literals;
+    mab::LatencyHistogram histogram;
+    histogram.record(-5us);
+    histogram.record(500ns);
+    for (int i = 0; i < 97; i++)
+        histogram.record(3us);
+    histogram.record(1500us);
+
+    auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.samples, 100u);
+    EXPECT_EQ(snapshot.counts[0], 2u);
+    EXPECT_EQ(snapshot.counts[2], 97u);
+    EXPECT_EQ(snapshot.counts[11], 1u);
+    EXPECT_EQ(snapshot.maxUs, 1500u);
+    EXPECT_EQ(snapshot.percentileUs(50), 4u);
+    EXPECT_EQ(snapshot.percentileUs(100), 1500u);
+    EXPECT_DOUBLE_EQ(snapshot.meanUs(), (97 * 3 + 1500) / 100.0);
+
+    histogram.reset();
+    EXPECT_EQ(histogram.snapshot().samples, 0u);
+}
+
+TEST_F(CandleTest, cyclicExecutorBatchesFramesAndCountsMisses)
+{
+    using namespace std::chrono_literals;
+    EXPECT_CALL(*mockBus, connect())
+        .Times(1)
+        .WillOnce(Return(mab::I_CommunicationInterface::Error_t::OK));
+    EXPECT_CALL(*mockBus, transfer(_, _, _))
+        .WillRepeatedly(Return(std::pair(mockData, mab::I_CommunicationInterface::Error_t::OK)));
+    auto candle = mab::attachCandle(mab::CAN_DATARATE_1M, std::move(mockBus));
+    ASSERT_NE(candle, nullptr);
+
+    mab::CyclicExecutor executor(candle, {.period = 1ms, .spinTail = 100us});
+    std::vector<size_t> responseCounts;
+    executor.run(
+        [&](mab::CyclicExecutor::Cycle_S& cycle)
+        {
+            responseCounts.push_back(cycle.responses.size());
+            cycle.queue(mockId, mockData, mockData.size());
+            cycle.queue(mockId + 1, mockData, mockData.size());
+            // one overrun long enough to skip a few deadlines
+            if (cycle.index == 5)
+                std::this_thread::sleep_for(3500us);
+            if (cycle.index == 19)
+                executor.stop();
+        });
+
+    ASSERT_EQ(responseCounts.size(), 20u);
+    EXPECT_EQ(responseCounts[0], 0u);
+    EXPECT_EQ(responseCounts[1], 2u);
+
+    auto stats = executor.getStats();
+    EXPECT_EQ(stats.cycles, 20u);
+    EXPECT_GE(stats.deadlineMisses, 3u);
+    EXPECT_EQ(stats.failedFrames, 0u);
+    EXPECT_EQ(stats.wakeupLatency.samples, 20u);
+    EXPECT_EQ(stats.exchangeLatency.samples, 20u);
+
+    executor.resetStats();
+    EXPECT_EQ(executor.getStats().cycles, 0u);
+    mab::detachCandle(candle);
+}
+
+TEST_F(CandleTest, urgentTransferIsPackedAheadOfTime)
+{
+    EXPECT_CALL(*mockBus, connect())
+        .Times(1)
+        .WillOnce(Return(mab::I_CommunicationInterface::Error_t::OK));
+    EXPECT_CALL(*mockBus, preferPackedTransfers()).WillRepeatedly(Return(true));
+    std::vector<std::vector<u8>> sent;
+    EXPECT_CALL(*mockBus, transfer(_, _, _))
+        .WillOnce(Return(std::pair(versionResponse, mab::I_CommunicationInterface::Error_t::OK)))
+        .WillRepeatedly(
+            [&](std::vector<u8> data, const u32, const size_t)
+            {
+                sent.push_back(data);
+                return std::pair(data, mab::I_CommunicationInterface::Error_t::OK);
+            });
+    auto candle = mab::attachCandle(mab::CAN_DATARATE_1M, std::move(mockBus));
+    ASSERT_NE(candle, nullptr);
+
+    std::vector<std::pair<mab::canId_t, std::vector<u8>>> frames;
+    for (mab::canId_t canId = 10; canId < 19; canId++)
+        frames.emplace_back(canId, std::vector<u8>{0x42, 0x00, 0x42, 0x01, 64, 0x00});
+    auto transfer = candle->prepareUrgentTransfer(frames);
+    EXPECT_TRUE(transfer.packed);
+    ASSERT_EQ(transfer.busFrames.size(), 2u);
+    EXPECT_EQ(transfer.busFrames[0][2], mab::CANdleFrameAdapter::FRAME_BUFFER_SIZE);
+    EXPECT_EQ(transfer.busFrames[1][2], 2);
+    EXPECT_TRUE(sent.empty());
+
+    auto report = candle->sendUrgentTransfer(transfer);
+    EXPECT_EQ(report.result, mab::candleTypes::Error_t::OK);
+    EXPECT_EQ(sent, transfer.busFrames);
+
+    frames.emplace_back(20, std::vector<u8>(65, 0));
+    EXPECT_TRUE(candle->prepareUrgentTransfer(frames).busFrames.empty());
+    EXPECT_EQ(candle->sendUrgentTransfer({}).result, mab::candleTypes::Error_t::DATA_EMPTY);
+    mab::detachCandle(candle);
+}
+
+TEST_F(CandleTest, urgentTransferWaitsForExchangeOnTheBus)
+{
+    EXPECT_CALL(*mockBus, connect())
+        .Times(1)
+        .WillOnce(Return(mab::I_CommunicationInterface::Error_t::OK));
+    std::promise<void> regularEntered;
+    std::promise<void> releaseRegular;
+    auto               regularReleased = releaseRegular.get_future().share();
+    std::atomic_bool   regularDone{false};
+    std::atomic_bool   urgentSent{false};
+    EXPECT_CALL(*mockBus, transfer(_, _, _))
+        .WillOnce(Return(std::pair(mockData, mab::I_CommunicationInterface::Error_t::OK)))
+        .WillRepeatedly(
+            [&](std::vector<u8> data, const u32, const size_t)
+            {
+                if (data.back() == 0x55)
+                {
+                    // the regular exchange has to be complete before the urgent frame goes out
+                    EXPECT_TRUE(regularDone.load());
+                    urgentSent.store(true);
+                    return std::pair(data, mab::I_CommunicationInterface::Error_t::OK);
+                }
+                regularEntered.set_value();
+                regularReleased.wait();
+                regularDone.store(true);
+                return std::pair(data, mab::I_CommunicationInterface::Error_t::OK);
+            });
+    auto candle = mab::attachCandle(mab::CAN_DATARATE_1M, std::move(mockBus));
+    ASSERT_NE(candle, nullptr);
+
+    auto regular = std::async(std::launch::async,
+                              [&]()
+                              { return candle->transferCANFrame(mockId, {0x41, 0x00}, 2); });
+    regularEntered.get_future().wait();
+
+    auto transfer = candle->prepareUrgentTransfer({{mab::canId_t(mockId), {0x42, 0x55}}});
+    ASSERT_EQ(transfer.busFrames.size(), 1u);
+    auto urgent = std::async(std::launch::async,
+                             [&]() { return candle->sendUrgentTransfer(transfer); });
+    EXPECT_EQ(urgent.wait_for(std::chrono::milliseconds(20)), std::future_status::timeout);
+    EXPECT_FALSE(urgentSent.load());
+
+    releaseRegular.set_value();
+    EXPECT_EQ(urgent.get().result, mab::candleTypes::Error_t::OK);
+    EXPECT_TRUE(urgentSent.load());
+    regular.get();
+    mab::detachCandle(candle);
+}
+
+TEST_F(CandleTest, lostLegacyFrameIsNotRetried)
+{
+    EXPECT_CALL(*mockBus, connect())
+        .Times(1)
+        .WillOnce(Return(mab::I_CommunicationInterface::Error_t::OK));
+    // the node did not respond, its late response could come with the next transfer
+    const std::vector<u8> notResponding = {0x04, 0x00};
+    EXPECT_CALL(*mockBus, transfer(_, _, _))
+        .Times(2)
+        .WillOnce(Return(std::pair(mockData, mab::I_CommunicationInterface::Error_t::OK)))
+        .WillOnce(Return(std::pair(notResponding, mab::I_CommunicationInterface::Error_t::OK)));
+    auto candle = mab::attachCandle(mab::CAN_DATARATE_1M, std::move(mockBus));
+    ASSERT_NE(candle, nullptr);
+
+    candle->setRetryPolicy({.maxAttempts = 3, .lostBudget = 10, .corruptBudget = 10});
+    auto result = candle->transferCANFrame(mockId, mockData, mockData.size(), 1, true);
+    EXPECT_EQ(result.second, mab::candleTypes::Error_t::CAN_DEVICE_NOT_RESPONDING);
+    EXPECT_EQ(candle->getRetryStats(mockId).retries, 0u);
+    mab::detachCandle(candle);
+}
+
+TEST(RttEstimatorTest, timeoutFollowsMeasuredRoundTrips)
+{
+    using namespace std::chrono_literals;
+    mab::RttEstimator estimator({.initial = 2000us, .floor = 200us, .ceiling = 10000us});
+    EXPECT_EQ(estimator.getTimeout(10), 2000us);
+
+    // first sample sets the deviation to half of it: 400 + 4 * 200
+    estimator.addSample(10, 400us);
+    EXPECT_EQ(estimator.getTimeout(10), 1200us);
+    for (int i = 0; i < 100; i++)
+        estimator.addSample(10, 400us);
+    auto estimate = estimator.getEstimate(10);
+    EXPECT_EQ(estimate.smoothed, 400us);
+    EXPECT_EQ(estimate.samples, 101u);
+    EXPECT_EQ(estimate.timeout, 400us);
+
+    // timeouts back off up to the ceiling, a response restores the estimate
+    estimator.addTimeout(10);
+    EXPECT_EQ(estimator.getTimeout(10), 800us);
+    for (int i = 0; i < 10; i++)
+        estimator.addTimeout(10);
+    EXPECT_EQ(estimator.getTimeout(10), 10000us);
+    estimator.addSample(10, 400us);
+    EXPECT_EQ(estimator.getTimeout(10), 400us);
+
+    estimator.addSample(11, 10us);
+    EXPECT_EQ(estimator.getTimeout(11), 200us);
+    estimator.setBounds(11, 50us, 100us);
+    EXPECT_EQ(estimator.getTimeout(11), 50us);
+    estimator.setBounds(12, std::nullopt, 1000us);
+    EXPECT_EQ(estimator.getTimeout(12), 1000us);
+}
+
+TEST_F(CandleTest, adaptiveTimeoutExtendsRequestedOne)
+{
+    EXPECT_CALL(*mockBus, connect())
+        .Times(1)
+        .WillOnce(Return(mab::I_CommunicationInterface::Error_t::OK));
+    std::vector<u8> nodeTimeouts;
+    EXPECT_CALL(*mockBus, transfer(_, _, _))
+        .WillOnce(Return(std::pair(mockData, mab::I_CommunicationInterface::Error_t::OK)))
+        .WillRepeatedly(
+            [&](std::vector<u8> data, const u32, const size_t)
+            {
+                nodeTimeouts.push_back(data.at(2));
+                return std::pair(mockData, mab::I_CommunicationInterface::Error_t::OK);
+            });
+    auto candle = mab::attachCandle(mab::CAN_DATARATE_1M, std::move(mockBus));
+    ASSERT_NE(candle, nullptr);
+
+    candle->transferCANFrame(mockId, mockData, mockData.size(), 10);
+    candle->setAdaptiveTimeouts(true);
+    candle->getRttEstimator().setBounds(mockId, std::chrono::microseconds(3500), std::nullopt);
+    candle->transferCANFrame(mockId, mockData, mockData.size(), 10);
+    candle->transferCANFrame(mockId, mockData, mockData.size(), 2);
+    // legacy frames carry the node timeout in whole milliseconds
+    EXPECT_EQ(nodeTimeouts, (std::vector<u8>{10, 10, 4}));
+    EXPECT_EQ(candle->getRttEstimator().getEstimate(mockId).samples, 2u);
+    mab::detachCandle(candle);
+}
+
+TEST_F(CandleTest, adaptiveTimeoutBacksOffForSilentNode)
+{
+    EXPECT_CALL(*mockBus, connect())
+        .Times(1)
+        .WillOnce(Return(mab::I_CommunicationInterface::Error_t::OK));
+    EXPECT_CALL(*mockBus, preferPackedTransfers()).WillRepeatedly(Return(true));
+    EXPECT_CALL(*mockBus, transfer(_, _, _))
+        .WillOnce(Return(std::pair(versionResponse, mab::I_CommunicationInterface::Error_t::OK)))
+        .WillRepeatedly(
+            [](std::vector<u8> data, const u32, const size_t)
+            {
+                // node does not respond, CANdle leaves the slot empty [..., length, seq, data]
+                data.at(3 + 4) = 0;
+                const u32 crc  = Crc::calcCrc((const char*)data.data(), data.size() - 4);
+                for (size_t byte = 0; byte < 4; byte++)
+                    data[data.size() - 4 + byte] = (u8)(crc >> (8 * byte));
+                return std::pair(data, mab::I_CommunicationInterface::Error_t::OK);
+            });
+    auto candle = mab::attachCandle(mab::CAN_DATARATE_1M, std::move(mockBus));
+    ASSERT_NE(candle, nullptr);
+
+    candle->setAdaptiveTimeouts(true);
+    for (int transfer = 0; transfer < 3; transfer++)
+        EXPECT_EQ(candle->transferCANFramePacked(mockId, mockData, mockData.size()).second,
+                  mab::CANdleFrameAdapter::Error_t::FRAME_LOST);
+    auto estimate = candle->getRttEstimator().getEstimate(mockId);
+    EXPECT_EQ(estimate.samples, 0u);
+    EXPECT_EQ(estimate.backoff, 3u);
+    mab::detachCandle(candle);
+}
+
+TEST_F(CandleTest, idempotentFrameRetriedAfterSilentNode)
+{
+    EXPECT_CALL(*mockBus, connect())
+        .Times(1)
+        .WillOnce(Return(mab::I_CommunicationInterface::Error_t::OK));
+    EXPECT_CALL(*mockBus, preferPackedTransfers()).WillRepeatedly(Return(true));
+    int transfers = 0;
+    EXPECT_CALL(*mockBus, transfer(_, _, _))
+        .WillOnce(Return(std::pair(versionResponse, mab::I_CommunicationInterface::Error_t::OK)))
+        .WillRepeatedly(
+            [&](std::vector<u8> data, const u32, const size_t)
+            {
+                // node responds only to the second frame, the first slot is left empty
+                if (transfers++ == 0)
+                {
+                    data.at(3 + 4) = 0;
+                    const u32 crc  = Crc::calcCrc((const char*)data.data(), data.size() - 4);
+                    for (size_t byte = 0; byte < 4; byte++)
+                        data[data.size() - 4 + byte] = (u8)(crc >> (8 * byte));
+                }
+                return std::pair(data, mab::I_CommunicationInterface::Error_t::OK);
+            });
+    auto candle = mab::attachCandle(mab::CAN_DATARATE_1M, std::move(mockBus));
+    ASSERT_NE(candle, nullptr);
+
+    EXPECT_FALSE(candle->retriesLostFrames());
+    candle->setRetryPolicy({.maxAttempts = 2, .lostBudget = 10, .corruptBudget = 10});
+    EXPECT_TRUE(candle->retriesLostFrames());
+    auto result = candle->transferCANFrame(mockId, mockData, mockData.size(), 1, true);
+    EXPECT_EQ(result.second, mab::candleTypes::Error_t::OK);
+    EXPECT_EQ(result.first, mockData);
+    EXPECT_EQ(candle->getRetryStats(mockId).recovered, 1u);
+    mab::detachCandle(candle);
+}
+
+TEST_F(CandleTest, idempotentFrameRetriedAfterCorruptedResponse)
+{
+    EXPECT_CALL(*mockBus, connect())
+        .Times(1)
+        .WillOnce(Return(mab::I_CommunicationInterface::Error_t::OK));
+    EXPECT_CALL(*mockBus, preferPackedTransfers()).WillRepeatedly(Return(true));
+    int  transfers = 0;
+    auto echo      = [&](std::vector<u8> data, const u32, const size_t)
+    {
+        // responses to all but the third packed frame have a broken checksum
+        if (transfers++ != 2)
+            data.back() ^= 0xFF;
+        return std::pair(data, mab::I_CommunicationInterface::Error_t::OK);
+    };
+    EXPECT_CALL(*mockBus, transfer(_, _, _))
+        .WillOnce(Return(std::pair(versionResponse, mab::I_CommunicationInterface::Error_t::OK)))
+        .WillRepeatedly(echo);
+    auto candle = mab::attachCandle(mab::CAN_DATARATE_1M, std::move(mockBus));
+    ASSERT_NE(candle, nullptr);
+
+    candle->setRetryPolicy({.maxAttempts = 3, .lostBudget = 10, .corruptBudget = 1});
+
+    // writes are not repeated
+    auto result = candle->transferCANFrame(mockId, mockData, mockData.size(), 1, false);
+    EXPECT_EQ(result.second, mab::candleTypes::Error_t::BAD_RESPONSE);
+
+    result = candle->transferCANFrame(mockId, mockData, mockData.size(), 1, true);
+    EXPECT_EQ(result.second, mab::candleTypes::Error_t::OK);
+    EXPECT_EQ(result.first, mockData);
+    auto stats = candle->getRetryStats(mockId);
+    EXPECT_EQ(stats.retries, 1u);
+    EXPECT_EQ(stats.recovered, 1u);
+
+    // budget of corrupted frame retries is used up
+    result = candle->transferCANFrame(mockId, mockData, mockData.size(), 1, true);
+    EXPECT_EQ(result.second, mab::candleTypes::Error_t::BAD_RESPONSE);
+    auto metrics = candle->getMetrics();
+    EXPECT_EQ(metrics.retries, 1u);
+    EXPECT_EQ(metrics.retriesDenied, 1u);
+    EXPECT_EQ(candle->getRetryStats(mockId + 1).retries, 0u);
+    mab::detachCandle(candle);
+}
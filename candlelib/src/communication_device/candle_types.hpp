@@ -1,6 +1,7 @@
 #pragma once
 
 #include "mab_types.hpp"
+#include <optional>
 #include <vector>
 
 #ifdef WIN32
@@ -44,6 +45,15 @@ namespace mab
             {
             }
         };
+
+        /// @brief Protocol features of the CANdle device, negotiated once during initialization
+        struct Capabilities_t
+        {
+            std::optional<version_ut> version;  ///< Firmware version, empty if not reported
+            bool packedFrames    = false;  ///< Packed CANdle frames (asynchronous API, 2.4+)
+            bool canFD           = false;  ///< CAN-FD frames are used on the bus
+            bool variablePacking = false;  ///< Packed frames may carry less than the max count
+        };
     }  // namespace candleTypes
     constexpr u32 DEFAULT_CAN_TIMEOUT = 2;  // ms
 }  // namespace mab
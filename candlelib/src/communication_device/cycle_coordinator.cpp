@@ -0,0 +1,118 @@
+#include "cycle_coordinator.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace mab
+{
+    CycleCoordinator::CycleCoordinator(CandleGroup&                    group,
+                                       const std::chrono::microseconds skewWindow)
+        : CycleCoordinator(group, skewWindow, systemTimeSource())
+    {
+    }
+
+    CycleCoordinator::CycleCoordinator(CandleGroup&                    group,
+                                       const std::chrono::microseconds skewWindow,
+                                       TimeSource_S                    timeSource)
+        : m_group(group),
+          m_skewWindow(skewWindow),
+          m_latencyUs(group.size(), 0.0f),
+          m_time(std::move(timeSource))
+    {
+    }
+
+    CycleCoordinator::TimeSource_S CycleCoordinator::systemTimeSource()
+    {
+        return TimeSource_S{[]() { return Clock_t::now(); },
+                            &CycleCoordinator::waitUntil,
+                            [](Candle& candle) { return candle.getBusTiming(); },
+                            [](Candle& candle) { candle.resetBusTiming(); }};
+    }
+
+    std::chrono::microseconds CycleCoordinator::getLatencyEstimate(const size_t busIdx) const
+    {
+        if (busIdx >= m_latencyUs.size())
+            return std::chrono::microseconds(0);
+        return std::chrono::microseconds((s64)m_latencyUs[busIdx]);
+    }
+
+    std::vector<std::chrono::microseconds> CycleCoordinator::computeOffsets() const
+    {
+        // Frame is assumed to reach the wire after half of the round trip, so the bus with the
+        // longest way to the wire is released first and the others wait for the difference
+        const float slowestUs = *std::max_element(m_latencyUs.begin(), m_latencyUs.end());
+
+        std::vector<std::chrono::microseconds> offsets;
+        for (const float latencyUs : m_latencyUs)
+            offsets.emplace_back((s64)((slowestUs - latencyUs) / 2.0f));
+        return offsets;
+    }
+
+    void CycleCoordinator::waitUntil(const TimePoint_t deadline)
+    {
+        if (deadline - Clock_t::now() > SPIN_THRESHOLD)
+            std::this_thread::sleep_until(deadline - SPIN_THRESHOLD);
+        while (Clock_t::now() < deadline)
+        {
+        }
+    }
+
+    CycleCoordinator::CycleReport_S CycleCoordinator::run(const CandleGroup::BusTask_t& task)
+    {
+        const size_t busCount = m_group.size();
+        if (busCount == 0)
+            return CycleReport_S();
+
+        CycleReport_S report;
+        report.releaseOffsets = computeOffsets();
+
+        std::vector<Candle::BusTiming_S> timings(busCount);
+
+        const auto cycleStart = m_time.now() + RELEASE_LEAD;
+        for (size_t busIdx = 0; busIdx < busCount; busIdx++)
+        {
+            const auto releaseAt = cycleStart + report.releaseOffsets[busIdx];
+            m_group.post(busIdx,
+                         [&, busIdx, releaseAt](Candle& candle)
+                         {
+                             m_time.resetBusTiming(candle);
+                             m_time.waitUntil(releaseAt);
+                             task(busIdx, candle, m_group.getNodes(busIdx));
+                             timings[busIdx] = m_time.busTiming(candle);
+                         });
+        }
+        m_group.flush();
+
+        std::vector<TimePoint_t> wireTimes;
+        for (size_t busIdx = 0; busIdx < busCount; busIdx++)
+        {
+            const auto& timing = timings[busIdx];
+            if (!timing.submitted.has_value() || !timing.responded.has_value())
+            {
+                report.latencies.emplace_back(0);
+                continue;
+            }
+            const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                *timing.responded - *timing.submitted);
+            report.latencies.push_back(latency);
+            wireTimes.push_back(*timing.submitted + latency / 2);
+
+            float& estimate = m_latencyUs[busIdx];
+            estimate        = estimate == 0.0f ? latency.count()
+                                               : estimate + LATENCY_SMOOTHING *
+                                                                (latency.count() - estimate);
+        }
+        if (wireTimes.size() > 1)
+        {
+            const auto [earliest, latest] =
+                std::minmax_element(wireTimes.begin(), wireTimes.end());
+            report.achievedSkew =
+                std::chrono::duration_cast<std::chrono::microseconds>(*latest - *earliest);
+        }
+        report.withinWindow = report.achievedSkew <= m_skewWindow;
+        if (!report.withinWindow)
+            m_log.debug("Cycle skew of %lld us exceeds the window",
+                        (long long)report.achievedSkew.count());
+        return report;
+    }
+}  // namespace mab
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include "candle_group.hpp"
+#include "logger.hpp"
+#include "mab_types.hpp"
+
+namespace mab
+{
+    /// @brief Aligns the moment setpoints reach every bus of a CandleGroup. Each CANdle has its own
+    /// submit to response latency (USB scheduling, bus load), so the coordinator tracks it per bus
+    /// and delays the release of faster buses so that frames hit all of them at the same time.
+    ///
+    /// Latencies and the achieved skew are taken from the timestamps of the first bus exchange of
+    /// every bus in the cycle (see Candle::getBusTiming()); a frame is assumed to hit the wire
+    /// halfway between handing the request over and receiving the response.
+    class CycleCoordinator
+    {
+      public:
+        using Clock_t     = std::chrono::steady_clock;
+        using TimePoint_t = Clock_t::time_point;
+
+        /// @brief Outcome of a single coordinated cycle
+        struct CycleReport_S
+        {
+            /// @brief Spread between the earliest and the latest wire time measured in the cycle
+            std::chrono::microseconds achievedSkew{0};
+            bool                      withinWindow = false;
+            /// @brief Release delay applied to each bus relative to the cycle start
+            std::vector<std::chrono::microseconds> releaseOffsets;
+            /// @brief Measured submit to response latency of each bus, 0 if the bus did not
+            /// exchange any frame
+            std::vector<std::chrono::microseconds> latencies;
+        };
+
+        /// @brief Time source of the coordinator, replaceable for testing
+        struct TimeSource_S
+        {
+            std::function<TimePoint_t()>                now;
+            std::function<void(const TimePoint_t)>      waitUntil;
+            std::function<Candle::BusTiming_S(Candle&)> busTiming;
+            std::function<void(Candle&)>                resetBusTiming;
+        };
+
+        /// @brief Create coordinator for the group
+        /// @param group group to coordinate, must outlive the coordinator
+        /// @param skewWindow maximum acceptable skew between buses
+        explicit CycleCoordinator(CandleGroup&                    group,
+                                  const std::chrono::microseconds skewWindow =
+                                      std::chrono::microseconds(200));
+
+        /// @param timeSource clock and bus timestamps used instead of the system ones
+        CycleCoordinator(CandleGroup&                    group,
+                         const std::chrono::microseconds skewWindow,
+                         TimeSource_S                    timeSource);
+
+        /// @brief Run the task on all buses, releasing each one so the frames land together
+        CycleReport_S run(const CandleGroup::BusTask_t& task);
+
+        /// @brief Get latency estimate of the bus
+        std::chrono::microseconds getLatencyEstimate(const size_t busIdx) const;
+
+        void setSkewWindow(const std::chrono::microseconds skewWindow)
+        {
+            m_skewWindow = skewWindow;
+        }
+
+      private:
+        /// @brief Weight of the newest latency sample in the moving average
+        static constexpr float LATENCY_SMOOTHING = 0.2f;
+        /// @brief Time between scheduling and the earliest release, covers worker wake up
+        static constexpr std::chrono::microseconds RELEASE_LEAD = std::chrono::microseconds(100);
+        /// @brief Final part of the wait for release is spun to avoid scheduler wake up jitter
+        static constexpr std::chrono::microseconds SPIN_THRESHOLD = std::chrono::microseconds(200);
+
+        Logger m_log = Logger(Logger::ProgramLayer_E::TOP, "CYCLE_COORDINATOR");
+
+        CandleGroup&              m_group;
+        std::chrono::microseconds m_skewWindow;
+        std::vector<float>        m_latencyUs;  ///< Moving average per bus, 0 means no sample yet
+        TimeSource_S              m_time;
+
+        std::vector<std::chrono::microseconds> computeOffsets() const;
+
+        static TimeSource_S systemTimeSource();
+
+        static void waitUntil(const TimePoint_t deadline);
+    };
+}  // namespace mab
@@ -0,0 +1,138 @@
+#include "cyclic_executor.hpp"
+
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <time.h>
+#endif
+
+namespace mab
+{
+    CyclicExecutor::CyclicExecutor(Candle* candle, const Config_S& config)
+        : m_candle(candle), m_config(config)
+    {
+        if (m_candle == nullptr)
+            throw std::invalid_argument("CyclicExecutor requires a CANdle");
+        if (m_config.period.count() <= 0)
+            throw std::invalid_argument("CyclicExecutor period has to be positive");
+    }
+
+    void CyclicExecutor::waitUntil(const std::chrono::steady_clock::time_point deadline) const
+    {
+        const auto wakeUp = deadline - m_config.spinTail;
+#ifndef _WIN32
+        // steady_clock is CLOCK_MONOTONIC on Linux, an absolute deadline does not accumulate the
+        // error of computing relative sleeps
+        const auto sinceEpoch =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(wakeUp.time_since_epoch());
+        timespec target{};
+        target.tv_sec  = sinceEpoch.count() / 1'000'000'000;
+        target.tv_nsec = sinceEpoch.count() % 1'000'000'000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, nullptr) == EINTR)
+        {
+        }
+#else
+        std::this_thread::sleep_until(wakeUp);
+#endif
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+        }
+    }
+
+    void CyclicExecutor::exchange(Cycle_S& cycle)
+    {
+        cycle.responses.clear();
+        if (cycle.frames.empty())
+            return;
+
+        if (m_candle->usesPackedTransfers())
+        {
+            // all of the frames are queued before any of them is awaited
+            std::vector<std::future<std::pair<std::vector<u8>, CANdleFrameAdapter::Error_t>>>
+                pending;
+            for (const auto& frame : cycle.frames)
+                pending.push_back(
+                    m_candle->transferCANFrameAsync(frame.canId, frame.data, frame.responseSize));
+            for (auto& future : pending)
+            {
+                auto [response, error] = future.get();
+                cycle.responses.emplace_back(std::move(response),
+                                             error == CANdleFrameAdapter::Error_t::OK
+                                                 ? candleTypes::Error_t::OK
+                                                 : candleTypes::Error_t::CAN_DEVICE_NOT_RESPONDING);
+            }
+        }
+        else
+        {
+            for (const auto& frame : cycle.frames)
+                cycle.responses.push_back(
+                    m_candle->transferCANFrame(frame.canId, frame.data, frame.responseSize));
+        }
+
+        for (const auto& response : cycle.responses)
+            if (response.second != candleTypes::Error_t::OK)
+                m_failedFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void CyclicExecutor::run(const Callback_t& callback)
+    {
+        using clock = std::chrono::steady_clock;
+
+        m_stopRequested.store(false);
+        Cycle_S cycle;
+        auto    deadline = clock::now();
+        while (!m_stopRequested.load())
+        {
+            waitUntil(deadline);
+            m_wakeupLatency.record(clock::now() - deadline);
+
+            cycle.deadline = deadline;
+            cycle.frames.clear();
+            callback(cycle);
+
+            const auto exchangeStart = clock::now();
+            exchange(cycle);
+            m_exchangeLatency.record(clock::now() - exchangeStart);
+
+            cycle.index++;
+            m_cycles.fetch_add(1, std::memory_order_relaxed);
+
+            // an overrun skips the deadlines already passed instead of running a burst of late
+            // cycles to catch up
+            deadline += m_config.period;
+            const auto now = clock::now();
+            if (now > deadline)
+            {
+                const u64 missed = (now - deadline) / m_config.period + 1;
+                deadline += missed * m_config.period;
+                m_deadlineMisses.fetch_add(missed, std::memory_order_relaxed);
+                m_log.debug("Cycle %llu overran %llu deadlines",
+                            (unsigned long long)cycle.index - 1,
+                            (unsigned long long)missed);
+            }
+        }
+    }
+
+    CyclicExecutor::Stats_S CyclicExecutor::getStats() const
+    {
+        Stats_S stats;
+        stats.cycles          = m_cycles.load(std::memory_order_relaxed);
+        stats.deadlineMisses  = m_deadlineMisses.load(std::memory_order_relaxed);
+        stats.failedFrames    = m_failedFrames.load(std::memory_order_relaxed);
+        stats.wakeupLatency   = m_wakeupLatency.snapshot();
+        stats.exchangeLatency = m_exchangeLatency.snapshot();
+        return stats;
+    }
+
+    void CyclicExecutor::resetStats()
+    {
+        m_cycles.store(0);
+        m_deadlineMisses.store(0);
+        m_failedFrames.store(0);
+        m_wakeupLatency.reset();
+        m_exchangeLatency.reset();
+    }
+}  // namespace mab
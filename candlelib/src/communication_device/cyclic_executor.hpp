@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "candle.hpp"
+#include "latency_histogram.hpp"
+#include "logger.hpp"
+#include "mab_types.hpp"
+
+namespace mab
+{
+    /// @brief Runs a control callback at a fixed period. Wake ups are scheduled against absolute
+    /// deadlines, so the loop does not drift with the callback duration. Frames queued by the
+    /// callback are submitted to the CANdle together after it returns, which lets the CANdle pack
+    /// them into as few USB transfers as possible.
+    class CyclicExecutor
+    {
+      public:
+        using Response_t = std::pair<std::vector<u8>, candleTypes::Error_t>;
+
+        struct Config_S
+        {
+            std::chrono::microseconds period{1000};
+            /// @brief Final part of every wait spent spinning instead of sleeping, trades CPU time
+            /// for lower wake up jitter. 0 disables spinning.
+            std::chrono::microseconds spinTail{0};
+        };
+
+        struct Frame_S
+        {
+            canId_t         canId;
+            std::vector<u8> data;
+            size_t          responseSize;
+        };
+
+        /// @brief Cycle passed to the callback
+        struct Cycle_S
+        {
+            u64                                   index = 0;
+            std::chrono::steady_clock::time_point deadline;
+            /// @brief Responses to the frames queued in the previous cycle, in the same order
+            std::vector<Response_t> responses;
+            /// @brief Frames to submit after the callback returns
+            std::vector<Frame_S> frames;
+
+            void queue(const canId_t canId, std::vector<u8> data, const size_t responseSize)
+            {
+                frames.push_back(Frame_S{canId, std::move(data), responseSize});
+            }
+        };
+
+        using Callback_t = std::function<void(Cycle_S& cycle)>;
+
+        struct Stats_S
+        {
+            u64 cycles         = 0;
+            u64 deadlineMisses = 0;  ///< Deadlines skipped because the cycle overran them
+            u64 failedFrames   = 0;
+            /// @brief Delay between the deadline and the moment the loop woke up
+            LatencyHistogram::Snapshot_S wakeupLatency;
+            /// @brief Time from submitting the frames of the cycle to the last response
+            LatencyHistogram::Snapshot_S exchangeLatency;
+        };
+
+        CyclicExecutor(const CyclicExecutor&)            = delete;
+        CyclicExecutor& operator=(const CyclicExecutor&) = delete;
+
+        /// @param candle CANdle the frames are submitted to, must outlive the executor
+        CyclicExecutor(Candle* candle, const Config_S& config);
+
+        /// @brief Run cycles in the calling thread until stop() is called
+        void run(const Callback_t& callback);
+
+        /// @brief Make run() return after the current cycle, safe to call from any thread and from
+        /// the callback
+        void stop()
+        {
+            m_stopRequested.store(true);
+        }
+
+        /// @brief Statistics of the cycles so far, safe to call while running
+        Stats_S getStats() const;
+
+        void resetStats();
+
+      private:
+        Logger m_log = Logger(Logger::ProgramLayer_E::TOP, "CYCLIC_EXECUTOR");
+
+        Candle*          m_candle;
+        const Config_S   m_config;
+        std::atomic_bool m_stopRequested{false};
+
+        std::atomic<u64> m_cycles{0};
+        std::atomic<u64> m_deadlineMisses{0};
+        std::atomic<u64> m_failedFrames{0};
+        LatencyHistogram m_wakeupLatency;
+        LatencyHistogram m_exchangeLatency;
+
+        /// @brief Submit all of the frames of the cycle and collect the responses
+        void exchange(Cycle_S& cycle);
+
+        void waitUntil(const std::chrono::steady_clock::time_point deadline) const;
+    };
+}  // namespace mab
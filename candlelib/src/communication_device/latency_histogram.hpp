@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+
+#include "mab_types.hpp"
+
+namespace mab
+{
+    /// @brief Histogram of durations with power of two microsecond buckets. Recording is lock-free
+    /// and never allocates, so it can be used from the control thread while other threads take
+    /// snapshots.
+    class LatencyHistogram
+    {
+      public:
+        /// @brief Bucket 0 counts durations below 1 us, bucket n durations in [2^(n-1), 2^n) us,
+        /// the last bucket everything longer
+        static constexpr size_t BUCKETS = 24;
+
+        struct Snapshot_S
+        {
+            std::array<u64, BUCKETS> counts{};
+            u64                      samples = 0;
+            u64                      sumUs   = 0;
+            u64                      maxUs   = 0;
+
+            double meanUs() const
+            {
+                return samples == 0 ? 0.0 : (double)sumUs / samples;
+            }
+
+            /// @brief Upper bound of the bucket holding the percentile, exact max for the last one
+            /// @param percentile 0 - 100
+            u64 percentileUs(const double percentile) const
+            {
+                const double target = samples * std::clamp(percentile, 0.0, 100.0) / 100.0;
+                u64          seen   = 0;
+                for (size_t bucket = 0; bucket < BUCKETS - 1; bucket++)
+                {
+                    seen += counts[bucket];
+                    if (seen > 0 && seen >= target)
+                        return std::min(upperBoundUs(bucket), maxUs);
+                }
+                return maxUs;
+            }
+
+            static constexpr u64 upperBoundUs(const size_t bucket)
+            {
+                return u64(1) << bucket;
+            }
+        };
+
+        LatencyHistogram() = default;
+
+        LatencyHistogram(const LatencyHistogram&)            = delete;
+        LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+        /// @brief Add sample, negative durations are counted as zero
+        void record(const std::chrono::nanoseconds duration) noexcept
+        {
+            const u64 us = duration.count() > 0 ? (u64)(duration.count() / 1000) : 0;
+            m_counts[std::min<size_t>(std::bit_width(us), BUCKETS - 1)].fetch_add(
+                1, std::memory_order_relaxed);
+            m_sumUs.fetch_add(us, std::memory_order_relaxed);
+            u64 max = m_maxUs.load(std::memory_order_relaxed);
+            while (us > max && !m_maxUs.compare_exchange_weak(max, us, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        /// @brief Copy of the counters, samples recorded meanwhile may be partially included
+        Snapshot_S snapshot() const noexcept
+        {
+            Snapshot_S snapshot;
+            for (size_t bucket = 0; bucket < BUCKETS; bucket++)
+            {
+                snapshot.counts[bucket] = m_counts[bucket].load(std::memory_order_relaxed);
+                snapshot.samples += snapshot.counts[bucket];
+            }
+            snapshot.sumUs = m_sumUs.load(std::memory_order_relaxed);
+            snapshot.maxUs = m_maxUs.load(std::memory_order_relaxed);
+            return snapshot;
+        }
+
+        void reset() noexcept
+        {
+            for (auto& count : m_counts)
+                count.store(0, std::memory_order_relaxed);
+            m_sumUs.store(0, std::memory_order_relaxed);
+            m_maxUs.store(0, std::memory_order_relaxed);
+        }
+
+      private:
+        std::array<std::atomic<u64>, BUCKETS> m_counts{};
+        std::atomic<u64>                      m_sumUs{0};
+        std::atomic<u64>                      m_maxUs{0};
+    };
+}  // namespace mab
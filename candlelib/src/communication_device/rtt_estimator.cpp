@@ -0,0 +1,85 @@
+#include "rtt_estimator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mab
+{
+    RttEstimator::RttEstimator() : m_config(Config_S())
+    {
+    }
+
+    RttEstimator::RttEstimator(const Config_S& config) : m_config(config)
+    {
+    }
+
+    void RttEstimator::addSample(const canId_t canId, const std::chrono::microseconds rtt)
+    {
+        const double sampleUs = std::max<double>(rtt.count(), 0.0);
+
+        std::unique_lock lock(m_mux);
+        Node_S&          node = m_nodes[canId];
+        if (node.samples == 0)
+        {
+            node.smoothedUs  = sampleUs;
+            node.deviationUs = sampleUs / 2.0;
+        }
+        else
+        {
+            // gains of 1/4 and 1/8 as in RFC 6298
+            node.deviationUs += (std::abs(node.smoothedUs - sampleUs) - node.deviationUs) / 4.0;
+            node.smoothedUs += (sampleUs - node.smoothedUs) / 8.0;
+        }
+        node.samples++;
+        node.backoff = 0;
+    }
+
+    void RttEstimator::addTimeout(const canId_t canId)
+    {
+        std::unique_lock lock(m_mux);
+        Node_S&          node = m_nodes[canId];
+        node.backoff          = std::min(node.backoff + 1, MAX_BACKOFF);
+    }
+
+    std::chrono::microseconds RttEstimator::getTimeout(const canId_t canId) const
+    {
+        std::unique_lock lock(m_mux);
+        const auto       it = m_nodes.find(canId);
+        return timeoutOf(it == m_nodes.end() ? Node_S() : it->second);
+    }
+
+    RttEstimator::Estimate_S RttEstimator::getEstimate(const canId_t canId) const
+    {
+        std::unique_lock lock(m_mux);
+        const auto       it   = m_nodes.find(canId);
+        const Node_S     node = it == m_nodes.end() ? Node_S() : it->second;
+        return Estimate_S{std::chrono::microseconds(std::llround(node.smoothedUs)),
+                          std::chrono::microseconds(std::llround(node.deviationUs)),
+                          timeoutOf(node),
+                          node.samples,
+                          node.backoff};
+    }
+
+    void RttEstimator::setBounds(const canId_t                                  canId,
+                                 const std::optional<std::chrono::microseconds> floor,
+                                 const std::optional<std::chrono::microseconds> ceiling)
+    {
+        std::unique_lock lock(m_mux);
+        Node_S&          node = m_nodes[canId];
+        node.floor            = floor;
+        node.ceiling          = ceiling;
+    }
+
+    std::chrono::microseconds RttEstimator::timeoutOf(const Node_S& node) const
+    {
+        const auto floor   = node.floor.value_or(m_config.floor);
+        const auto ceiling = std::max(node.ceiling.value_or(m_config.ceiling), floor);
+
+        std::chrono::microseconds timeout = m_config.initial;
+        if (node.samples != 0)
+            timeout = std::chrono::microseconds(std::llround(
+                node.smoothedUs + m_config.deviationFactor * node.deviationUs));
+        timeout = std::clamp(timeout, floor, ceiling);
+        return std::min(timeout * (1 << node.backoff), ceiling);
+    }
+}  // namespace mab
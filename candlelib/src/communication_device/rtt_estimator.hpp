@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include "mab_types.hpp"
+
+namespace mab
+{
+    /// @brief Round trip time estimator of CAN nodes (Jacobson/Karels). Keeps smoothed round trip
+    /// time and its mean deviation per CAN ID and derives timeouts from them, so healthy nodes get
+    /// tight deadlines while unresponsive ones are detected quickly. Thread safe.
+    class RttEstimator
+    {
+      public:
+        struct Config_S
+        {
+            /// @brief Timeout of nodes without any samples yet
+            std::chrono::microseconds initial{2000};
+            std::chrono::microseconds floor{200};
+            std::chrono::microseconds ceiling{10000};
+            /// @brief Timeout = smoothed RTT + deviationFactor * RTT deviation
+            u32 deviationFactor = 4;
+        };
+
+        struct Estimate_S
+        {
+            std::chrono::microseconds smoothed{0};
+            std::chrono::microseconds deviation{0};
+            std::chrono::microseconds timeout{0};
+            u64                       samples = 0;
+            u32                       backoff = 0;  ///< Timeouts in a row, each doubles the timeout
+        };
+
+        RttEstimator();
+
+        explicit RttEstimator(const Config_S& config);
+
+        /// @brief Account round trip of a request which got a response
+        void addSample(const canId_t canId, const std::chrono::microseconds rtt);
+
+        /// @brief Account request which timed out, the timeout of the node backs off until the
+        /// next response
+        void addTimeout(const canId_t canId);
+
+        /// @brief Timeout for the next request to the node
+        std::chrono::microseconds getTimeout(const canId_t canId) const;
+
+        Estimate_S getEstimate(const canId_t canId) const;
+
+        /// @brief Override floor and ceiling of the node timeout, nullopt restores the defaults
+        void setBounds(const canId_t                                  canId,
+                       const std::optional<std::chrono::microseconds> floor,
+                       const std::optional<std::chrono::microseconds> ceiling);
+
+      private:
+        /// @brief Backoff doubles the timeout at most this many times
+        static constexpr u32 MAX_BACKOFF = 6;
+
+        struct Node_S
+        {
+            double                                   smoothedUs  = 0.0;
+            double                                   deviationUs = 0.0;
+            u64                                      samples     = 0;
+            u32                                      backoff     = 0;
+            std::optional<std::chrono::microseconds> floor;
+            std::optional<std::chrono::microseconds> ceiling;
+        };
+
+        const Config_S                      m_config;
+        mutable std::mutex                  m_mux;
+        std::unordered_map<canId_t, Node_S> m_nodes;
+
+        std::chrono::microseconds timeoutOf(const Node_S& node) const;
+    };
+}  // namespace mab
@@ -28,7 +28,8 @@ namespace mab
 
         virtual ~I_CommunicationInterface() = default;
 
-        /// @brief Method to claim communication interface and enable communication
+        /// @brief Method to claim communication interface and enable communication, does nothing
+        /// if the interface is already claimed
         /// @return Error on failure, OK on success
         virtual Error_t connect() = 0;
 
@@ -36,6 +37,14 @@ namespace mab
         /// @return Error on failure, OK on success
         virtual Error_t disconnect() = 0;
 
+        /// @brief Method to restore communication after the link to the device was lost
+        /// @return Error on failure, OK on success
+        virtual Error_t reconnect()
+        {
+            disconnect();
+            return connect();
+        }
+
         /// @brief Method to exchange data through interface
         /// @param data Data to send to the device
         /// @param timeoutMs Wait time for the response
@@ -50,5 +59,12 @@ namespace mab
         /// is UB.
         virtual std::pair<std::vector<u8>, Error_t> transfer(
             std::vector<u8> data, const u32 timeoutMs, const size_t expectedReceivedDataSize) = 0;
+
+        /// @brief Whether single CAN transfers should be sent as packed CANdle frames
+        /// @return true if the interface is most efficient with packed frames
+        virtual bool preferPackedTransfers() const
+        {
+            return false;
+        }
     };
 }  // namespace mab
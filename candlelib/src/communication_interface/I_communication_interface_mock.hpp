@@ -9,6 +9,7 @@ class MockBus : public mab::I_CommunicationInterface
   public:
     MOCK_METHOD(I_CommunicationInterface::Error_t, connect, (), (override));
     MOCK_METHOD(I_CommunicationInterface::Error_t, disconnect, (), (override));
+    MOCK_METHOD(I_CommunicationInterface::Error_t, reconnect, (), (override));
     MOCK_METHOD(I_CommunicationInterface::Error_t,
                 transfer,
                 (std::vector<u8> data, const u32 timeoutMs),
@@ -17,4 +18,5 @@ class MockBus : public mab::I_CommunicationInterface
                 transfer,
                 (std::vector<u8> data, const u32 timeoutMs, const size_t expectedReceivedDataSize),
                 (override));
+    MOCK_METHOD(bool, preferPackedTransfers, (), (const, override));
 };
\ No newline at end of file
@@ -1,9 +1,11 @@
-
 #ifndef WIN32
 #include <chrono>
+#include <cstring>
 #include <thread>
 
+#include <linux/gpio.h>
 #include <linux/spi/spidev.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 
 #include "I_communication_interface.hpp"
@@ -12,12 +14,17 @@
 
 namespace mab
 {
-    SPI::SPI(const std::string_view path) : m_path(path)
+    SPI::SPI(const std::string_view              path,
+             const std::optional<DataReadyLine_S> dataReadyLine,
+             const bool                           packedFrames)
+        : m_path(path), m_dataReadyLine(dataReadyLine), m_packedFrames(packedFrames)
     {
     }
 
     I_CommunicationInterface::Error_t SPI::connect()
     {
+        if (m_spiFileDescriptor != -1)
+            return I_CommunicationInterface::OK;
         m_logger.info("Connecting to SPI at %s", m_path.c_str());
         m_spiFileDescriptor = open(m_path.c_str(), O_RDWR);
         int err;  // for error handling
@@ -45,13 +52,15 @@ namespace mab
             return I_CommunicationInterface::Error_t::INITIALIZATION_ERROR;
         }
 
-        m_transferBuffer.bits_per_word = SPI_BITS_PER_WORD;
-        m_transferBuffer.speed_hz      = SPI_SPEED;
+        if (m_dataReadyLine.has_value())
+            return openDataReadyLine();
+
         return I_CommunicationInterface::OK;
     }
 
     I_CommunicationInterface::Error_t SPI::disconnect()
     {
+        closeDataReadyLine();
         if (m_spiFileDescriptor != -1)
         {
             close(m_spiFileDescriptor);
@@ -68,102 +77,201 @@ namespace mab
     std::pair<std::vector<u8>, I_CommunicationInterface::Error_t> SPI::transfer(
         std::vector<u8> data, const u32 timeoutMs, const size_t expectedReceivedDataSize)
     {
-        std::vector<u8> receivedData(expectedReceivedDataSize + spiCRC.getCrcLen() /*CRC bytes*/,
-                                     0);
-        data.reserve(data.size() + spiCRC.getCrcLen());
-        auto crc = spiCRC.calcCrc((char*)data.data(), data.size());
-
-        // Assign the CRC bytes to the data vector
-        data.push_back(crc);
-        data.push_back(crc >> 8);
-        data.push_back(crc >> 16);
-        data.push_back(crc >> 24);
-
-        m_transferBuffer.tx_buf = (std::size_t)data.data();
-        m_transferBuffer.rx_buf = (std::size_t)receivedData.data();
-        m_transferBuffer.len    = data.size();
+        const size_t crcLen         = spiCRC.getCrcLen();
+        const size_t txLength       = data.size() + crcLen;
+        const size_t responseLength = expectedReceivedDataSize + crcLen;
 
         if (m_spiFileDescriptor == -1)
         {
             m_logger.error("Unconnected SPI!");
-            return std::make_pair(receivedData,
+            return std::make_pair(std::vector<u8>(),
                                   I_CommunicationInterface::Error_t::INITIALIZATION_ERROR);
         }
+        if (txLength > MAX_TRANSFER_SIZE || responseLength > MAX_TRANSFER_SIZE)
+        {
+            m_logger.error("Data too long!");
+            return std::make_pair(std::vector<u8>(),
+                                  I_CommunicationInterface::Error_t::DATA_TOO_LONG);
+        }
+
+        std::memcpy(m_txBuffer.data(), data.data(), data.size());
+        u32 crc                     = spiCRC.calcCrc((char*)m_txBuffer.data(), data.size());
+        m_txBuffer[data.size()]     = crc;
+        m_txBuffer[data.size() + 1] = crc >> 8;
+        m_txBuffer[data.size() + 2] = crc >> 16;
+        m_txBuffer[data.size() + 3] = crc >> 24;
+        m_rxBuffer[0]               = 0;
 
-        int err = ioctl(m_spiFileDescriptor, SPI_IOC_MESSAGE(1), &m_transferBuffer);
+        if (m_gpioEventDescriptor != -1)
+            drainDataReadyEvents();
+
+        // Payload and the first response poll are chained into a single message, the poll only
+        // checks the first byte for the response
+        const bool chainPoll = expectedReceivedDataSize > 0 && m_gpioEventDescriptor == -1;
+        auto       segments  = requestSegments(
+            m_txBuffer.data(), txLength, m_idleBuffer.data(), m_rxBuffer.data(), chainPoll);
+
+        int err = chainPoll ? ioctl(m_spiFileDescriptor, SPI_IOC_MESSAGE(2), segments.data())
+                            : ioctl(m_spiFileDescriptor, SPI_IOC_MESSAGE(1), segments.data());
         if (err < 0)
         {
             m_logger.error("SPI transfer failed!");
-            return std::make_pair(receivedData,
+            return std::make_pair(std::vector<u8>(),
                                   I_CommunicationInterface::Error_t::TRANSMITTER_ERROR);
         }
-        else
+        m_logger.debug("SPI transfer successful!");
+
+        if (expectedReceivedDataSize == 0)
+            return std::make_pair(std::vector<u8>(), I_CommunicationInterface::OK);
+
+        Error_t responseError = waitForResponse(timeoutMs, responseLength);
+        if (responseError != I_CommunicationInterface::OK)
+            return std::make_pair(std::vector<u8>(), responseError);
+
+        if (!spiCRC.checkCrcBuf((char*)m_rxBuffer.data(), responseLength))
         {
-            m_logger.info("SPI transfer successful!");
+            m_logger.error("CRC check failed");
+            return std::make_pair(std::vector<u8>(),
+                                  I_CommunicationInterface::Error_t::RECEIVER_ERROR);
         }
+        return std::make_pair(
+            std::vector<u8>(m_rxBuffer.begin(), m_rxBuffer.begin() + expectedReceivedDataSize),
+            I_CommunicationInterface::OK);
+    }
 
-        if (expectedReceivedDataSize > 0)
-        {
-            data.clear();
-            data.resize(receivedData.size(), 0);
-            m_transferBuffer.len    = 1;
-            m_transferBuffer.tx_buf = (std::size_t)data.data();
-            m_transferBuffer.rx_buf = (std::size_t)receivedData.data();
+    I_CommunicationInterface::Error_t SPI::waitForResponse(const u32    timeoutMs,
+                                                           const size_t responseLength)
+    {
+        const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+        // Remaining bytes are clocked out together with the trailing guard delay, which prevents
+        // race conditions (DMA clearing buffer while parsing) in the candle device
+        spi_ioc_transfer readout = makeSegment(
+            m_idleBuffer.data(), m_rxBuffer.data() + 1, responseLength - 1, POLL_INTERVAL_US);
 
-            std::chrono::high_resolution_clock::time_point startTime =
-                std::chrono::high_resolution_clock::now();
-            while (std::chrono::duration_cast<std::chrono::microseconds>(
-                       std::chrono::high_resolution_clock::now() - startTime)
-                       .count() < timeoutMs * 1000)
+        if (m_gpioEventDescriptor != -1)
+        {
+            gpiohandle_data lineState{};
+            if (ioctl(m_gpioEventDescriptor, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &lineState) < 0 ||
+                lineState.values[0] == 0)
             {
-                // This prevents race conditions (DMA clearing buffer while parsing) in candle
-                // device
-                std::this_thread::sleep_for(std::chrono::microseconds(80));
-                // Try transfer - it only checks first byte for response
-                int err = ioctl(m_spiFileDescriptor, SPI_IOC_MESSAGE(1), &m_transferBuffer);
-                if (err < 0)
-                {
-                    m_logger.error("SPI transfer failed!");
-                    return std::make_pair(receivedData,
-                                          I_CommunicationInterface::Error_t::TRANSMITTER_ERROR);
-                }
-                if (receivedData[0] != 0)
+                pollfd pfd{m_gpioEventDescriptor, POLLIN | POLLPRI, 0};
+                if (poll(&pfd, 1, timeoutMs) <= 0)
                 {
-                    m_logger.info("Received data from SPI device");
-                    m_transferBuffer.len    = receivedData.size() - 1;
-                    m_transferBuffer.rx_buf = (std::size_t)(receivedData.data() + 1);
-                    // Perform the actual transfer (excluding the first byte which was sent earlier)
-                    err = ioctl(m_spiFileDescriptor, SPI_IOC_MESSAGE(1), &m_transferBuffer);
-                    if (err < 0)
-                    {
-                        m_logger.error("SPI transfer failed!");
-                        return std::make_pair(receivedData,
-                                              I_CommunicationInterface::Error_t::TRANSMITTER_ERROR);
-                    }
-                    // Check CRC
-                    if (spiCRC.checkCrcBuf((char*)receivedData.data(), receivedData.size()))
-                    {
-                        // Remove CRC bytes from the received data
-                        receivedData.resize(receivedData.size() - spiCRC.getCrcLen());
-                        // This prevents race conditions (DMA clearing buffer while parsing) in
-                        // candle
-                        // device
-                        std::this_thread::sleep_for(std::chrono::microseconds(80));
-                        return std::make_pair(receivedData, I_CommunicationInterface::OK);
-                    }
-                    else
-                    {
-                        m_logger.error("CRC check failed");
-                        return std::make_pair(receivedData,
-                                              I_CommunicationInterface::Error_t::RECEIVER_ERROR);
-                    }
+                    m_logger.error("Timeout while waiting for data ready line");
+                    return I_CommunicationInterface::Error_t::TIMEOUT;
                 }
+                drainDataReadyEvents();
+            }
+            // Data is ready, whole response is read out in one go
+            readout = makeSegment(
+                m_idleBuffer.data(), m_rxBuffer.data(), responseLength, POLL_INTERVAL_US);
+            if (ioctl(m_spiFileDescriptor, SPI_IOC_MESSAGE(1), &readout) < 0)
+            {
+                m_logger.error("SPI transfer failed!");
+                return I_CommunicationInterface::Error_t::TRANSMITTER_ERROR;
             }
-            m_logger.error("Timeout while waiting for data from SPI device");
-            return std::make_pair(receivedData, I_CommunicationInterface::Error_t::TIMEOUT);
+            return I_CommunicationInterface::OK;
+        }
+
+        spi_ioc_transfer pollSegment =
+            makeSegment(m_idleBuffer.data(), m_rxBuffer.data(), 1, POLL_INTERVAL_US);
+        while (m_rxBuffer[0] == 0)
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                m_logger.error("Timeout while waiting for data from SPI device");
+                return I_CommunicationInterface::Error_t::TIMEOUT;
+            }
+            if (ioctl(m_spiFileDescriptor, SPI_IOC_MESSAGE(1), &pollSegment) < 0)
+            {
+                m_logger.error("SPI transfer failed!");
+                return I_CommunicationInterface::Error_t::TRANSMITTER_ERROR;
+            }
+        }
+        m_logger.debug("Received data from SPI device");
+        if (ioctl(m_spiFileDescriptor, SPI_IOC_MESSAGE(1), &readout) < 0)
+        {
+            m_logger.error("SPI transfer failed!");
+            return I_CommunicationInterface::Error_t::TRANSMITTER_ERROR;
+        }
+        return I_CommunicationInterface::OK;
+    }
+
+    spi_ioc_transfer SPI::makeSegment(
+        const u8* tx, u8* rx, u32 len, u16 delayUs, const bool csChange)
+    {
+        spi_ioc_transfer segment{};
+        segment.tx_buf        = (std::size_t)tx;
+        segment.rx_buf        = (std::size_t)rx;
+        segment.len           = len;
+        segment.speed_hz      = SPI_SPEED;
+        segment.bits_per_word = SPI_BITS_PER_WORD;
+        segment.delay_usecs   = delayUs;
+        segment.cs_change     = csChange;
+        return segment;
+    }
+
+    std::array<spi_ioc_transfer, 2> SPI::requestSegments(
+        const u8* tx, const u32 txLength, const u8* idle, u8* rx, const bool chainPoll)
+    {
+        // device is deselected between the payload and the poll only when both are in the
+        // message, a trailing cs_change would leave it selected for the next message
+        return {makeSegment(tx, nullptr, txLength, POLL_INTERVAL_US, chainPoll),
+                makeSegment(idle, rx, 1)};
+    }
+
+    I_CommunicationInterface::Error_t SPI::openDataReadyLine()
+    {
+        m_gpioChipDescriptor = open(m_dataReadyLine->chipPath.c_str(), O_RDONLY);
+        if (m_gpioChipDescriptor == -1)
+        {
+            m_logger.error("Failed to open gpio chip at %s", m_dataReadyLine->chipPath.c_str());
+            return I_CommunicationInterface::Error_t::INITIALIZATION_ERROR;
         }
+        gpioevent_request request{};
+        request.lineoffset  = m_dataReadyLine->lineOffset;
+        request.handleflags = GPIOHANDLE_REQUEST_INPUT;
+        request.eventflags  = GPIOEVENT_REQUEST_RISING_EDGE;
+        std::strncpy(request.consumer_label, "candle-spi-drdy", sizeof(request.consumer_label) - 1);
+        if (ioctl(m_gpioChipDescriptor, GPIO_GET_LINEEVENT_IOCTL, &request) < 0)
+        {
+            m_logger.error("Failed to request data ready line %u", m_dataReadyLine->lineOffset);
+            closeDataReadyLine();
+            return I_CommunicationInterface::Error_t::INITIALIZATION_ERROR;
+        }
+        m_gpioEventDescriptor = request.fd;
+        m_logger.info("Using data ready line %u of %s",
+                      m_dataReadyLine->lineOffset,
+                      m_dataReadyLine->chipPath.c_str());
+        return I_CommunicationInterface::OK;
+    }
 
-        return std::make_pair(receivedData, I_CommunicationInterface::OK);
+    void SPI::closeDataReadyLine()
+    {
+        if (m_gpioEventDescriptor != -1)
+        {
+            close(m_gpioEventDescriptor);
+            m_gpioEventDescriptor = -1;
+        }
+        if (m_gpioChipDescriptor != -1)
+        {
+            close(m_gpioChipDescriptor);
+            m_gpioChipDescriptor = -1;
+        }
+    }
+
+    void SPI::drainDataReadyEvents() const
+    {
+        // Edges left over from previous transfers would wake the next wait prematurely
+        pollfd         pfd{m_gpioEventDescriptor, POLLIN | POLLPRI, 0};
+        gpioevent_data event{};
+        while (poll(&pfd, 1, 0) > 0)
+        {
+            if (read(m_gpioEventDescriptor, &event, sizeof(event)) != sizeof(event))
+                break;
+        }
     }
 
     SPI::~SPI()
@@ -8,6 +8,8 @@
 #include <string.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
+#include <array>
+#include <optional>
 #include <string>
 #include <thread>
 
@@ -24,9 +26,25 @@ namespace mab
         static constexpr u32 SPI_SPEED         = 20'000'000;  // 20 MHz
         static constexpr u8  SPI_BITS_PER_WORD = 8;
         static constexpr u32 MAX_TRANSFER_SIZE = 2048;
+        // Time the CANdle needs to arm its DMA between consecutive SPI accesses
+        static constexpr u16 POLL_INTERVAL_US = 80;
 
       public:
-        SPI(const std::string_view path = "/dev/spidev0.0");
+        /// @brief Data-ready line of the CANdle HAT, accessed via the gpio character device
+        struct DataReadyLine_S
+        {
+            std::string chipPath   = "/dev/gpiochip0";
+            u32         lineOffset = 0;
+        };
+
+        /// @brief Create SPI interface
+        /// @param path path to the spidev device
+        /// @param dataReadyLine optional data-ready line, when provided the response is awaited
+        /// on the line edge instead of polling the device
+        /// @param packedFrames use packed CANdle frames for every CAN transfer
+        SPI(const std::string_view              path          = "/dev/spidev0.0",
+            const std::optional<DataReadyLine_S> dataReadyLine = std::nullopt,
+            const bool                           packedFrames  = true);
         virtual ~SPI() override;
 
         virtual Error_t connect() override;
@@ -40,24 +58,74 @@ namespace mab
             const u32       timeoutMs,
             const size_t    expectedReceivedDataSize) override;
 
+        virtual bool preferPackedTransfers() const override
+        {
+            return m_packedFrames;
+        }
+
+        /// @brief Single spidev transfer segment
+        /// @param delayUs delay after the segment, before chip select changes
+        /// @param csChange deselect the device before the next segment, only valid for segments
+        /// followed by another one in the same message (on the last segment spidev would keep the
+        /// device selected after the message)
+        static spi_ioc_transfer makeSegment(const u8*  tx,
+                                            u8*        rx,
+                                            u32        len,
+                                            u16        delayUs  = 0,
+                                            const bool csChange = false);
+
+        /// @brief Segments of a request message: the payload, followed by the first response
+        /// poll when chained. Only the first segment is sent when not chained.
+        static std::array<spi_ioc_transfer, 2> requestSegments(const u8*  tx,
+                                                               const u32  txLength,
+                                                               const u8*  idle,
+                                                               u8*        rx,
+                                                               const bool chainPoll);
+
       private:
-        Logger            m_logger            = Logger(Logger::ProgramLayer_E::BOTTOM, "SPI");
-        int               m_spiFileDescriptor = -1;
-        spi_ioc_transfer  m_transferBuffer{0};
+        Logger            m_logger              = Logger(Logger::ProgramLayer_E::BOTTOM, "SPI");
+        int               m_spiFileDescriptor   = -1;
+        int               m_gpioChipDescriptor  = -1;
+        int               m_gpioEventDescriptor = -1;
         const std::string m_path;
 
+        const std::optional<DataReadyLine_S> m_dataReadyLine;
+        const bool                           m_packedFrames;
+
+        // Buffers are preallocated and cache-line aligned so spidev can map them for DMA
+        // without bouncing
+        alignas(64) std::array<u8, MAX_TRANSFER_SIZE> m_txBuffer{};
+        alignas(64) std::array<u8, MAX_TRANSFER_SIZE> m_rxBuffer{};
+        alignas(64) std::array<u8, MAX_TRANSFER_SIZE> m_idleBuffer{};
+
         Crc spiCRC;
+
+        Error_t openDataReadyLine();
+        void    closeDataReadyLine();
+        void    drainDataReadyEvents() const;
+        Error_t waitForResponse(const u32 timeoutMs, const size_t responseLength);
     };
 }  // namespace mab
 
 #else
 
+#include <optional>
+#include <string>
+
 namespace mab
 {
     class SPI final : public I_CommunicationInterface
     {
       public:
-        SPI(const std::string_view path = "/dev/spidev0.0")
+        struct DataReadyLine_S
+        {
+            std::string chipPath   = "/dev/gpiochip0";
+            u32         lineOffset = 0;
+        };
+
+        SPI(const std::string_view              path          = "/dev/spidev0.0",
+            const std::optional<DataReadyLine_S> dataReadyLine = std::nullopt,
+            const bool                           packedFrames  = true)
         {
             m_logger.error("SPI not implemented on windows!");
         }
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include <array>
 
 #include "SPI.hpp"
 
@@ -10,3 +11,26 @@ class SPITest : public ::testing::Test
     {
     }
 };
+
+TEST_F(SPITest, onlyChainedPayloadChangesChipSelect)
+{
+    std::array<u8, 8> tx{}, idle{}, rx{};
+
+    auto chained = mab::SPI::requestSegments(tx.data(), 8, idle.data(), rx.data(), true);
+    EXPECT_EQ(chained[0].len, 8u);
+    EXPECT_EQ(chained[0].cs_change, 1);
+    EXPECT_GT(chained[0].delay_usecs, 0);
+    // last segment of the message releases chip select
+    EXPECT_EQ(chained[1].len, 1u);
+    EXPECT_EQ(chained[1].rx_buf, (std::size_t)rx.data());
+    EXPECT_EQ(chained[1].cs_change, 0);
+
+    // payload alone is the last segment, the guard delay stays
+    auto single = mab::SPI::requestSegments(tx.data(), 8, idle.data(), rx.data(), false);
+    EXPECT_EQ(single[0].cs_change, 0);
+    EXPECT_GT(single[0].delay_usecs, 0);
+
+    auto readout = mab::SPI::makeSegment(idle.data(), rx.data(), 8, 80);
+    EXPECT_EQ(readout.cs_change, 0);
+    EXPECT_EQ(readout.delay_usecs, 80);
+}
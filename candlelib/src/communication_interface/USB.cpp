@@ -1,4 +1,5 @@
 #include <USB.hpp>
+#include <algorithm>
 #include <cstring>
 #include <string>
 #ifdef WIN32
@@ -214,104 +215,361 @@ namespace mab
         return std::string(serialNo.begin(), serialNo.end());
     }
 
-    //----------------------------USB-DEVICE-SECTION---------------------------------------------
-    USB::USB(const u16 vid, const u16 pid, const std::string serialNo) : m_vid(vid), m_pid(pid)
+    //----------------------------DEVICE-LOCATOR-SECTION-------------------------------------------
+
+    UsbDevicePath_S UsbDevicePath_S::fromDevice(libusb_device* device)
     {
-        if (!serialNo.empty())
-            m_serialNo = serialNo;
+        UsbDevicePath_S path;
+        path.bus      = libusb_get_bus_number(device);
+        const s32 len = libusb_get_port_numbers(device, path.ports.data(), path.ports.size());
+        path.depth    = len > 0 ? len : 0;
+        return path;
+    }
 
+    UsbDeviceLocator::UsbDeviceLocator()
+    {
         if (libusb_init(&m_ctx))
-            m_Log.error("Could not init libusb!");
-        m_Log.debug("Init libusb for context %d: ", (size_t)m_ctx);
+            m_log.error("Could not init libusb!");
+        m_log.debug("Init libusb for context %d: ", (size_t)m_ctx);
         // libusb_set_option(&m_ctx, libusb_option::LIBUSB_OPTION_LOG_LEVEL,
         // LIBUSB_LOG_LEVEL_DEBUG);
+
+        if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG))
+        {
+            m_log.debug("Hotplug not supported, falling back to polling");
+            return;
+        }
+        libusb_hotplug_callback_handle handle;
+        s32                            err = libusb_hotplug_register_callback(
+            m_ctx,
+            static_cast<libusb_hotplug_event>(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED |
+                                              LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+            static_cast<libusb_hotplug_flag>(LIBUSB_HOTPLUG_NO_FLAGS),
+            LIBUSB_HOTPLUG_MATCH_ANY,
+            LIBUSB_HOTPLUG_MATCH_ANY,
+            LIBUSB_HOTPLUG_MATCH_ANY,
+            &UsbDeviceLocator::hotplugCallback,
+            this,
+            &handle);
+        if (err != LIBUSB_SUCCESS)
+        {
+            m_log.warn(("On hotplug register: " +
+                        translateLibusbError(static_cast<libusb_error>(err)))
+                           .c_str());
+            return;
+        }
+        m_hotplugHandle = handle;
+        // hotplug callbacks are only delivered while someone is handling libusb events
+        m_eventThread = std::jthread(
+            [this](std::stop_token stopToken)
+            {
+                while (!stopToken.stop_requested())
+                {
+                    timeval tv = {0, 100'000};
+                    libusb_handle_events_timeout_completed(m_ctx, &tv, nullptr);
+                }
+            });
     }
-    USB::~USB()
+
+    UsbDeviceLocator::~UsbDeviceLocator()
     {
-        m_Log.debug("Deinit libusb for context %d: ", (size_t)m_ctx);
-        disconnect();
+        if (m_hotplugHandle.has_value())
+        {
+            m_eventThread.request_stop();
+            libusb_hotplug_deregister_callback(m_ctx, *m_hotplugHandle);
+            libusb_interrupt_event_handler(m_ctx);
+            if (m_eventThread.joinable())
+                m_eventThread.join();
+        }
+        m_log.debug("Deinit libusb for context %d: ", (size_t)m_ctx);
         libusb_exit(m_ctx);
     }
 
-    USB::Error_t USB::connect()
+    std::shared_ptr<UsbDeviceLocator> UsbDeviceLocator::getShared()
+    {
+        static std::mutex                      sharedMux;
+        static std::weak_ptr<UsbDeviceLocator> shared;
+
+        std::unique_lock lock(sharedMux);
+        auto             locator = shared.lock();
+        if (locator == nullptr)
+        {
+            locator = std::make_shared<UsbDeviceLocator>();
+            shared  = locator;
+        }
+        return locator;
+    }
+
+    int LIBUSB_CALL UsbDeviceLocator::hotplugCallback(libusb_context*      ctx,
+                                                      libusb_device*       device,
+                                                      libusb_hotplug_event event,
+                                                      void*                userData)
+    {
+        (void)ctx;
+        (void)device;
+        auto* locator = static_cast<UsbDeviceLocator*>(userData);
+        if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED)
+        {
+            {
+                std::unique_lock lock(locator->m_mux);
+                locator->m_arrivals++;
+            }
+            locator->m_arrivalCv.notify_all();
+        }
+        else
+        {
+            // cached paths are kept, device coming back to the same port is found without opening
+            locator->m_log.debug("USB device left the bus");
+        }
+        return 0;  // keep the callback armed
+    }
+
+    std::optional<UsbDevicePath_S> UsbDeviceLocator::cachedPath(const std::string& serialNo)
+    {
+        std::unique_lock lock(m_mux);
+        for (const auto& [serial, path] : m_pathBySerial)
+        {
+            if (serial.compare(0, serialNo.size(), serialNo) == 0)
+                return path;
+        }
+        return std::nullopt;
+    }
+
+    bool UsbDeviceLocator::isKnownAsOther(const UsbDevicePath_S& path, const std::string& serialNo)
+    {
+        std::unique_lock lock(m_mux);
+        for (const auto& [serial, cached] : m_pathBySerial)
+        {
+            if (cached == path && serial.compare(0, serialNo.size(), serialNo) != 0)
+                return true;
+        }
+        return false;
+    }
+
+    void UsbDeviceLocator::remember(const std::string& serialNo, libusb_device* device)
+    {
+        std::unique_lock lock(m_mux);
+        m_pathBySerial[serialNo] = UsbDevicePath_S::fromDevice(device);
+    }
+
+    void UsbDeviceLocator::forget(const std::string& serialNo)
+    {
+        std::unique_lock lock(m_mux);
+        std::erase_if(m_pathBySerial,
+                      [&serialNo](const auto& entry)
+                      { return entry.first.compare(0, serialNo.size(), serialNo) == 0; });
+    }
+
+    libusb_device* UsbDeviceLocator::find(const u16 vid, const u16 pid, const std::string& serialNo)
     {
-        m_libusbDevice                = nullptr;
         libusb_device** deviceList    = nullptr;
-        s32             deviceListLen = libusb_get_device_list(NULL, &deviceList);
+        s32             deviceListLen = libusb_get_device_list(m_ctx, &deviceList);
         if (deviceListLen == 0)
-            m_Log.error("No USB devices detected!");
+            m_log.error("No USB devices detected!");
         else if (deviceListLen < 0)
-            m_Log.error("Libusb error while detecting devices!");
+            m_log.error("Libusb error while detecting devices!");
 
-        m_Log.debug("Found %d USB devices", deviceListLen);
+        m_log.debug("Found %d USB devices", deviceListLen);
+        m_log.debug("Looking for VID: %d, PID: %d, Serial: %s", vid, pid, serialNo.c_str());
+
+        auto matchesIds = [vid, pid, this](libusb_device* device)
+        {
+            libusb_device_descriptor descriptor;
+            libusb_error             descError =
+                static_cast<libusb_error>(libusb_get_device_descriptor(device, &descriptor));
+            if (descError)
+                m_log.warn(translateLibusbError(descError).c_str());
+            return descError == LIBUSB_SUCCESS && descriptor.idVendor == vid &&
+                   descriptor.idProduct == pid;
+        };
 
-        m_Log.debug("Looking for VID: %d, PID: %d, Serial: %c", m_vid, m_pid, m_serialNo.c_str());
+        libusb_device*                 found  = nullptr;
+        std::optional<UsbDevicePath_S> cached = std::nullopt;
+        if (!serialNo.empty())
+            cached = cachedPath(serialNo);
 
-        for (s32 deviceIndex = 0; deviceIndex < deviceListLen; deviceIndex++)
+        // Fast path, device already identified before sits on its known port
+        for (s32 deviceIndex = 0; cached.has_value() && deviceIndex < deviceListLen; deviceIndex++)
         {
-            libusb_device*           checkedDevice = deviceList[deviceIndex];
-            libusb_device_descriptor checkedDescriptor;
-            libusb_error             descError = static_cast<libusb_error>(
-                libusb_get_device_descriptor(checkedDevice, &checkedDescriptor));
+            libusb_device* checkedDevice = deviceList[deviceIndex];
+            if (UsbDevicePath_S::fromDevice(checkedDevice) == *cached && matchesIds(checkedDevice))
+            {
+                m_log.debug("Found the right device at cached location");
+                found = checkedDevice;
+                break;
+            }
+        }
 
-            if (descError)
-                m_Log.warn(translateLibusbError(descError).c_str());
+        for (s32 deviceIndex = 0; found == nullptr && deviceIndex < deviceListLen; deviceIndex++)
+        {
+            libusb_device* checkedDevice = deviceList[deviceIndex];
+            if (!matchesIds(checkedDevice))
+                continue;
+            if (serialNo.empty())
+            {
+                // any device will do, serial is read once the device is claimed
+                found = checkedDevice;
+                break;
+            }
+            const UsbDevicePath_S path = UsbDevicePath_S::fromDevice(checkedDevice);
+            if (isKnownAsOther(path, serialNo))
+            {
+                m_log.debug("Skipping device with known serial");
+                continue;
+            }
+            std::string checkedSerialNo;
+            {
+                LibusbDevice peekDevice(checkedDevice, IN_ENDPOINT, OUT_ENDPOINT, true);
+                checkedSerialNo = peekDevice.getSerialNo();
+            }
+            checkedSerialNo = checkedSerialNo.c_str();  // strip descriptor padding
+            {
+                std::unique_lock lock(m_mux);
+                m_pathBySerial[checkedSerialNo] = path;
+            }
+            m_log.info("Device with serial %s found", checkedSerialNo.c_str());
+            if (checkedSerialNo.compare(0, serialNo.size(), serialNo) == 0)
+            {
+                found = checkedDevice;
+                break;
+            }
+            m_log.debug("This is not the device you are looking for");
+        }
 
-            m_Log.debug("Checking device: vid %d, pid %d",
-                        checkedDescriptor.idVendor,
-                        checkedDescriptor.idProduct);
+        if (found != nullptr)
+            libusb_ref_device(found);
+        if (deviceListLen > 0)
+            libusb_free_device_list(deviceList, true);
+        return found;
+    }
 
-            if (checkedDescriptor.idVendor == m_vid && checkedDescriptor.idProduct == m_pid)
+    bool UsbDeviceLocator::waitForDevice(const u16                       vid,
+                                         const u16                       pid,
+                                         const std::string&              serialNo,
+                                         const std::chrono::milliseconds timeout)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (true)
+        {
+            u64 arrivals;
             {
-                m_Log.debug("Found the right device!");
-                m_libusbDevice =
-                    std::make_unique<LibusbDevice>(checkedDevice, IN_ENDPOINT, OUT_ENDPOINT, true);
-                std::string serialNo = m_libusbDevice->getSerialNo();
-                m_Log.info("Device with serial %s found", serialNo.c_str());
-
-                if (m_serialNo.compare("") &&
-                    m_serialNo.compare(serialNo.substr(0, m_serialNo.size())))
-                {
-                    m_Log.debug("This is not the device you are looking for");
-                    m_Log.debug("%s vs %s",
-                                m_serialNo.c_str(),
-                                serialNo.substr(0, m_serialNo.size()).c_str());
-                    m_libusbDevice = nullptr;
-                    continue;
-                }
-                // without reasigning libusb device libusb library looses handle for some reason,
-                // and we use it to claim the interface after scanning
-                m_libusbDevice = nullptr;
-                m_libusbDevice =
-                    std::make_unique<LibusbDevice>(checkedDevice, IN_ENDPOINT, OUT_ENDPOINT);
+                std::unique_lock lock(m_mux);
+                arrivals = m_arrivals;
+            }
+            libusb_device* device = find(vid, pid, serialNo);
+            if (device != nullptr)
+            {
+                libusb_unref_device(device);
+                return true;
+            }
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+                return false;
+
+            std::unique_lock lock(m_mux);
+            // without hotplug the bus is polled, with it the poll is only a safety net
+            m_arrivalCv.wait_until(lock,
+                                   std::min(deadline, now + POLL_INTERVAL),
+                                   [this, arrivals]() { return m_arrivals != arrivals; });
+        }
+    }
+
+    //----------------------------USB-DEVICE-SECTION---------------------------------------------
+    USB::USB(const u16                         vid,
+             const u16                         pid,
+             const std::string                 serialNo,
+             std::shared_ptr<UsbDeviceLocator> locator)
+        : m_vid(vid), m_pid(pid), m_locator(std::move(locator))
+    {
+        if (!serialNo.empty())
+            m_serialNo = serialNo;
+        if (m_locator == nullptr)
+            m_locator = UsbDeviceLocator::getShared();
+    }
+    USB::~USB()
+    {
+        disconnect();
+    }
+
+    USB::Error_t USB::connect()
+    {
+        std::lock_guard connectLock(m_connectMux);
+        auto            current = activeDevice();
+        if (current != nullptr && current->isConnected())
+            return Error_t::OK;
+        setDevice(nullptr);
+        const std::string& wantedSerialNo =
+            m_activeSerialNo.empty() ? m_serialNo : m_activeSerialNo;
+
+        // device is published only once it is verified, transfers never see a half set up one
+        std::shared_ptr<LibusbDevice> libusbDevice;
+        // second attempt is only made when the cached location turned out to be stale
+        for (u32 attempt = 0; attempt < 2 && libusbDevice == nullptr; attempt++)
+        {
+            libusb_device* device = m_locator->find(m_vid, m_pid, wantedSerialNo);
+            if (device == nullptr)
                 break;
+            libusbDevice = std::make_shared<LibusbDevice>(device, IN_ENDPOINT, OUT_ENDPOINT);
+
+            std::string serialNo = libusbDevice->getSerialNo();
+            serialNo             = serialNo.c_str();
+            if (serialNo.compare(0, wantedSerialNo.size(), wantedSerialNo) != 0)
+            {
+                m_Log.debug("Cached device location is stale");
+                m_locator->forget(wantedSerialNo);
+                libusbDevice = nullptr;
+                libusb_unref_device(device);
+                continue;
             }
+            m_locator->remember(serialNo, device);
+            libusb_unref_device(device);  // open handle keeps its own reference
+            m_activeSerialNo = serialNo;
         }
-        libusb_free_device_list(deviceList, true);
-        if (m_libusbDevice == nullptr)
+
+        if (libusbDevice == nullptr)
         {
             m_Log.error("Device was not found!");
             return Error_t::NOT_CONNECTED;
         }
-        else if (!m_libusbDevice->isConnected())
+        else if (!libusbDevice->isConnected())
         {
             m_Log.error("Device is not connected!");
             return Error_t::NOT_CONNECTED;
         }
         else
         {
+            setDevice(std::move(libusbDevice));
             m_Log.info("Device connected");
             return Error_t::OK;
         }
     }
+
+    USB::Error_t USB::reconnect()
+    {
+        std::lock_guard connectLock(m_connectMux);
+        m_Log.warn("Reconnecting USB device...");
+        // transfers in progress keep the old device alive until they return
+        setDevice(nullptr);
+        if (!m_locator->waitForDevice(m_vid,
+                                      m_pid,
+                                      m_activeSerialNo.empty() ? m_serialNo : m_activeSerialNo,
+                                      RECONNECT_TIMEOUT))
+        {
+            m_Log.error("Device did not come back!");
+            return Error_t::NOT_CONNECTED;
+        }
+        return connect();
+    }
+
     USB::Error_t USB::disconnect()
     {
-        if (m_libusbDevice == nullptr)
+        std::lock_guard connectLock(m_connectMux);
+        if (activeDevice() == nullptr)
         {
             m_Log.info("Device already disconnected");
             return Error_t::NOT_CONNECTED;
         }
-        m_libusbDevice = nullptr;
+        setDevice(nullptr);
         return Error_t::OK;
     }
 
@@ -325,7 +583,8 @@ namespace mab
                                                            const u32       timeoutMs,
                                                            const size_t    expectedReceivedDataSize)
     {
-        if (m_libusbDevice == nullptr)
+        const std::shared_ptr<LibusbDevice> libusbDevice = activeDevice();
+        if (libusbDevice == nullptr)
         {
             m_Log.error("Device not connected!");
             return std::pair(data, Error_t::NOT_CONNECTED);
@@ -346,15 +605,17 @@ namespace mab
         // {
         //     data.resize(66);
         // }
-        libusb_error transmitError = m_libusbDevice->transmit(data.data(), data.size(), timeoutMs);
+        libusb_error transmitError = libusbDevice->transmit(data.data(), data.size(), timeoutMs);
         if (transmitError != libusb_error::LIBUSB_SUCCESS)
         {
             std::string err = translateLibusbError(transmitError);
             m_Log.error(err.c_str());
             if (transmitError == libusb_error::LIBUSB_ERROR_PIPE)  // pipe clogged and needs a reset
             {
-                m_libusbDevice->unclogInput();
+                libusbDevice->unclogInput();
             }
+            if (transmitError == libusb_error::LIBUSB_ERROR_NO_DEVICE)
+                return std::pair(data, Error_t::NOT_CONNECTED);
             return std::pair(data, Error_t::TRANSMITTER_ERROR);
         }
 
@@ -363,7 +624,7 @@ namespace mab
             std::vector<u8> recievedData;
             recievedData.resize(expectedReceivedDataSize);
             libusb_error receiveError =
-                m_libusbDevice->receive(recievedData.data(), recievedData.size(), timeoutMs);
+                libusbDevice->receive(recievedData.data(), recievedData.size(), timeoutMs);
             if (receiveError != libusb_error::LIBUSB_SUCCESS)
             {
                 std::string err = translateLibusbError(receiveError);
@@ -371,8 +632,10 @@ namespace mab
                 if (receiveError ==
                     libusb_error::LIBUSB_ERROR_PIPE)  // pipe clogged and needs a reset
                 {
-                    m_libusbDevice->unclogOutput();
+                    libusbDevice->unclogOutput();
                 }
+                if (receiveError == libusb_error::LIBUSB_ERROR_NO_DEVICE)
+                    return std::pair(data, Error_t::NOT_CONNECTED);
                 return std::pair(data, Error_t::RECEIVER_ERROR);
             }
             return std::pair(recievedData, Error_t::OK);
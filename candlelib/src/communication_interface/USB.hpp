@@ -1,10 +1,16 @@
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <condition_variable>
 #include <string>
 #include <exception>
+#include <map>
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <thread>
 #include <utility>
 
 #include <mab_types.hpp>
@@ -61,6 +67,90 @@ namespace mab
         std::string getSerialNo();
     };
 
+    /// @brief Physical location of the USB device (bus and port chain), stays the same as long as
+    /// the device is plugged into the same port
+    struct UsbDevicePath_S
+    {
+        u8                bus   = 0;
+        u8                depth = 0;
+        std::array<u8, 7> ports = {0};
+
+        bool operator==(const UsbDevicePath_S&) const = default;
+
+        static UsbDevicePath_S fromDevice(libusb_device* device);
+    };
+
+    /// @brief Owner of the libusb context shared by all USB interfaces. Caches the location of
+    /// every device that was identified by its serial number, so it does not have to be opened
+    /// again, and tracks device arrival via libusb hotplug events where the platform supports them.
+    class UsbDeviceLocator
+    {
+      public:
+        UsbDeviceLocator();
+        ~UsbDeviceLocator();
+
+        UsbDeviceLocator(const UsbDeviceLocator&)            = delete;
+        UsbDeviceLocator& operator=(const UsbDeviceLocator&) = delete;
+
+        /// @brief Get the process wide locator, it is created on the first use and destroyed
+        /// together with its last user
+        static std::shared_ptr<UsbDeviceLocator> getShared();
+
+        libusb_context* getContext() const
+        {
+            return m_ctx;
+        }
+
+        /// @brief Find device on the bus
+        /// @param vid vid of the target device
+        /// @param pid pid of the target device
+        /// @param serialNo serial number (or its prefix) of the target device, empty matches the
+        /// first device found
+        /// @return Referenced libusb device which must be unreferenced by the caller, nullptr if
+        /// the device is not present
+        libusb_device* find(const u16 vid, const u16 pid, const std::string& serialNo);
+
+        /// @brief Block until the device is present on the bus
+        /// @return true if the device was found before the timeout
+        bool waitForDevice(const u16                       vid,
+                           const u16                       pid,
+                           const std::string&              serialNo,
+                           const std::chrono::milliseconds timeout);
+
+        /// @brief Cache location of the device identified by the serial number
+        void remember(const std::string& serialNo, libusb_device* device);
+
+        /// @brief Drop cached location of the device, used when the cache turns out to be stale
+        void forget(const std::string& serialNo);
+
+        bool isHotplugSupported() const
+        {
+            return m_hotplugHandle.has_value();
+        }
+
+      private:
+        static constexpr std::chrono::milliseconds POLL_INTERVAL = std::chrono::milliseconds(50);
+
+        Logger          m_log = Logger(Logger::ProgramLayer_E::BOTTOM, "USB_LOCATOR");
+        libusb_context* m_ctx = nullptr;
+
+        std::optional<libusb_hotplug_callback_handle> m_hotplugHandle;
+        std::jthread                                  m_eventThread;
+
+        std::mutex                             m_mux;
+        std::condition_variable                m_arrivalCv;
+        u64                                    m_arrivals = 0;
+        std::map<std::string, UsbDevicePath_S> m_pathBySerial;
+
+        std::optional<UsbDevicePath_S> cachedPath(const std::string& serialNo);
+        bool isKnownAsOther(const UsbDevicePath_S& path, const std::string& serialNo);
+
+        static int LIBUSB_CALL hotplugCallback(libusb_context*      ctx,
+                                               libusb_device*       device,
+                                               libusb_hotplug_event event,
+                                               void*                userData);
+    };
+
     // TODO: those should be args
     static constexpr int IN_ENDPOINT  = 0x81;  ///< CANdle USB input endpoint address.
     static constexpr int OUT_ENDPOINT = 0x01;  ///< CANdle USB output endpoint address.
@@ -69,15 +159,37 @@ namespace mab
       private:
         Logger m_Log = Logger(Logger::ProgramLayer_E::BOTTOM, "USB");
 
-        std::unique_ptr<LibusbDevice> m_libusbDevice = nullptr;
+        /// @brief Transfers work on their own copy of the pointer, so reconnecting can not free
+        /// the device under an active transfer
+        std::shared_ptr<LibusbDevice> m_libusbDevice = nullptr;
+        mutable std::mutex            m_deviceMux;
+        /// @brief Serializes connect, reconnect and disconnect
+        std::recursive_mutex m_connectMux;
 
         u16         m_vid, m_pid;
         std::string m_serialNo = "";
+        /// @brief Serial of the claimed device, reconnect goes back to the same device
+        std::string m_activeSerialNo = "";
 
         static constexpr size_t USB_MAX_BUFF_LEN = 16'000'000;  // bytes
         static constexpr size_t DEFAULT_TIMEOUT  = 100;         // ms
 
-        libusb_context* m_ctx;
+        static constexpr std::chrono::milliseconds RECONNECT_TIMEOUT =
+            std::chrono::milliseconds(2000);
+
+        std::shared_ptr<UsbDeviceLocator> m_locator;
+
+        std::shared_ptr<LibusbDevice> activeDevice() const
+        {
+            std::lock_guard lock(m_deviceMux);
+            return m_libusbDevice;
+        }
+
+        void setDevice(std::shared_ptr<LibusbDevice> device)
+        {
+            std::lock_guard lock(m_deviceMux);
+            m_libusbDevice = std::move(device);
+        }
 
       public:
         /// @brief Initialize USB interface
@@ -85,11 +197,18 @@ namespace mab
         /// @param pid pid of the target device
         /// @param serialNo serial number of the target device. If empty than first device from
         /// the list becomes active device.
-        explicit USB(const u16 vid, const u16 pid, const std::string serialNo = "");
+        /// @param locator device locator to share the libusb context with, the process wide one is
+        /// used when empty
+        explicit USB(const u16                         vid,
+                     const u16                         pid,
+                     const std::string                 serialNo = "",
+                     std::shared_ptr<UsbDeviceLocator> locator  = nullptr);
         ~USB();
 
         Error_t connect() override;
         Error_t disconnect() override;
+        /// @brief Wait for the device to come back on the bus and claim it again
+        Error_t reconnect() override;
 
         Error_t transfer(std::vector<u8> data, const u32 timeoutMs) override;
         std::pair<std::vector<u8>, Error_t> transfer(
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "CLI/CLI.hpp"
+#include "logger.hpp"
+
+#include <memory>
+#include <string>
+
+namespace mab
+{
+    /// @brief Commands operating on telemetry logs recorded with the SDK
+    class LogCli
+    {
+      public:
+        LogCli() = delete;
+        explicit LogCli(CLI::App* rootCli);
+        ~LogCli() = default;
+
+      private:
+        Logger m_logger = Logger(Logger::ProgramLayer_E::TOP, "LOG_CLI");
+
+        struct ExportOptions
+        {
+            ExportOptions(CLI::App* rootCli)
+                : input(std::make_shared<std::string>("")),
+                  output(std::make_shared<std::string>("")),
+                  table(std::make_shared<int>(-1))
+            {
+                rootCli->add_option("input", *input, "Columnar telemetry log file.")->required();
+                rootCli->add_option(
+                    "-o,--output", *output, "Output CSV file (standard output if not given).");
+                rootCli->add_option("-t,--table", *table, "Export only the table with this index.");
+            }
+            const std::shared_ptr<std::string> input;
+            const std::shared_ptr<std::string> output;
+            const std::shared_ptr<int>         table;
+        };
+    };
+}  // namespace mab
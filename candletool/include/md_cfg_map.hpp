@@ -129,16 +129,8 @@ namespace mab
 
             for (const auto& cfgPair : m_map)
             {
-                bool      foundInRegisters = false;
-                const u16 lookingFor       = cfgPair.first;
-                auto      findInRegisters =
-                    [&foundInRegisters, lookingFor]<typename T>(MDRegisterEntry_S<T>& reg)
-                {
-                    if (reg.m_regAddress == lookingFor)
-                        foundInRegisters = true;
-                };
-                registers.forEachRegister(findInRegisters);
-                if (!foundInRegisters)
+                const u16 lookingFor = cfgPair.first;
+                if (MDRegisters_S::findByAddress(lookingFor) == nullptr)
                 {
                     throw std::runtime_error(
                         "MDConfigMap: Key '" + std::to_string(lookingFor) +
@@ -499,9 +491,6 @@ namespace mab
                           "mode",
                           MDCfgElement::ParserFunctions_S(
                               GPIOModeToReadable, GPIOModeFromReadable, verifyEnum))}};
-
-      private:
-        MDRegisters_S registers;  // only for verification purposes
     };
 
 }  // namespace mab
@@ -0,0 +1,65 @@
+#include "log_cli.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <optional>
+
+#include "telemetry_log.hpp"
+
+namespace mab
+{
+    LogCli::LogCli(CLI::App* rootCli)
+    {
+        auto* logCli =
+            rootCli->add_subcommand("log", "Telemetry log commands.")->require_subcommand();
+
+        // Export
+        auto* exportCmd = logCli->add_subcommand("export", "Export telemetry log to CSV.");
+
+        ExportOptions exportOptions(exportCmd);
+        exportCmd->callback(
+            [this, exportOptions]()
+            {
+                try
+                {
+                    TelemetryLogReader reader(*exportOptions.input);
+
+                    std::optional<size_t> table;
+                    if (*exportOptions.table >= 0)
+                    {
+                        if ((size_t)*exportOptions.table >= reader.getTables().size())
+                        {
+                            m_logger.error("Log has only %d tables!", reader.getTables().size());
+                            return;
+                        }
+                        table = *exportOptions.table;
+                    }
+
+                    bool ok = false;
+                    if (exportOptions.output->empty())
+                        ok = reader.exportCsv(std::cout, table);
+                    else
+                    {
+                        std::ofstream out(*exportOptions.output);
+                        if (!out.is_open())
+                        {
+                            m_logger.error("Could not create %s!", exportOptions.output->c_str());
+                            return;
+                        }
+                        ok = reader.exportCsv(out, table);
+                    }
+
+                    if (!ok)
+                        m_logger.warn("Some of the chunks are damaged and were skipped!");
+                    else if (!exportOptions.output->empty())
+                        m_logger.success("Exported %d chunks to %s",
+                                         reader.getChunks().size(),
+                                         exportOptions.output->c_str());
+                }
+                catch (const std::runtime_error& e)
+                {
+                    m_logger.error("%s", e.what());
+                }
+            });
+    }
+}  // namespace mab
@@ -3,6 +3,7 @@
 #include <string>
 #include "candle.hpp"
 #include "candle_cli.hpp"
+#include "log_cli.hpp"
 #include "candle_types.hpp"
 #include "configHelpers.hpp"
 #include "logger.hpp"
@@ -139,6 +140,7 @@ int main(int argc, char** argv)
     MDCli     mdCli(&app, candleToolCtx);
     PdsCli    pdsCli(app, candleBuilder);
     MdcoCli   mdcoCli(app, candleToolCtx);
+    LogCli    logCli(&app);
 
     CLI11_PARSE(app, argc, argv);
     if (showCandleSDKVersion)
@@ -747,31 +747,36 @@ namespace mab
                 auto          md = getMd(mdCanId, candleBuilder);
                 MDRegisters_S readableRegisters;
 
-                auto readReadableRegs = [&]<typename T>(MDRegisterEntry_S<T>& reg)
+                std::vector<MDRegisterRef_S> readableRefs;
+
+                auto collectReadableRegs = [&]<typename T>(MDRegisterEntry_S<T>& reg)
                 {
                     // TODO: skipping new registers for now
                     if ((reg.m_regAddress < 0x800 && reg.m_regAddress > 0x700) ||
                         reg.m_regAddress > 0x810)
                         return;
                     if (reg.m_accessLevel != RegisterAccessLevel_E::WO)
-                    {
-                        auto fault = md->readRegisters(reg);
-                        if (fault != MD::Error_t::OK)
-                            m_logger.error("Error while reading register %s", reg.m_name.data());
-
-                        if constexpr (std::is_integral_v<decltype(reg.value)>)
-                        {
-                            m_logger.debug(
-                                "Read register %s, Value: %d", reg.m_name.data(), reg.value);
-                        }
-                        else
-                        {
-                            m_logger.debug("Read register %s", reg.m_name.data());
-                        }
-                    }
+                        readableRefs.push_back(MDRegisterRef_S::from(reg));
                 };
 
-                readableRegisters.forEachRegister(readReadableRegs);
+                readableRegisters.forEachRegister(collectReadableRegs);
+
+                // all registers are packed into as few frames as possible and read in one batch
+                auto readResult = md->readRegisterList(readableRefs);
+                if (readResult == MD::Error_t::REQUEST_INVALID)
+                {
+                    // older firmware rejects whole frames because of a single register it does
+                    // not know, so those are read one by one to get the rest of them
+                    size_t unreadable = 0;
+                    for (const auto& ref : readableRefs)
+                    {
+                        if (md->readRegisterList(std::span(&ref, 1)) != MD::Error_t::OK)
+                            unreadable++;
+                    }
+                    m_logger.warn("%zu registers could not be read", unreadable);
+                }
+                else if (readResult != MD::Error_t::OK)
+                    m_logger.error("Error while reading registers");
 
                 m_logger << std::fixed;
                 m_logger << "Drive " << *mdCanId << ":" << std::endl;
@@ -976,13 +981,9 @@ namespace mab
                 }
                 else
                 {
-                    MDRegisters_S regs;
-                    auto          findAddressByName = [&]<typename T>(MDRegisterEntry_S<T> reg)
-                    {
-                        if (registerStr.compare(reg.m_name) == 0)
-                            address = reg.m_regAddress;
-                    };
-                    regs.forEachRegister(findAddressByName);
+                    const auto* descriptor = MDRegisters_S::findByName(registerStr);
+                    if (descriptor != nullptr)
+                        address = descriptor->address;
                     if (address != 0x0)
                     {
                         result = registerRead(*md, address).value_or(result);
@@ -1018,17 +1019,11 @@ namespace mab
                 }
                 if (std::string("0x").compare(registerStr.substr(0, 2)) == 0)
                 {
-                    MDRegisters_S regs;
                     address = std::stoll(registerStr, nullptr, 16);
                     // Is write-only check
-                    auto isWriteOnlyFunc = [&]<typename T>(MDRegisterEntry_S<T> reg)
-                    {
-                        if (reg.m_regAddress == address)
-                        {
-                            isWriteOnly = reg.m_accessLevel == RegisterAccessLevel_E::WO;
-                        }
-                    };
-                    regs.forEachRegister(isWriteOnlyFunc);
+                    const auto* descriptor = MDRegisters_S::findByAddress(address);
+                    if (descriptor != nullptr)
+                        isWriteOnly = descriptor->access == RegisterAccessLevel_E::WO;
 
                     if (address != 0x0 && !isWriteOnly)
                         resultBefore = registerRead(*md, address).value_or(resultBefore);
@@ -1042,16 +1037,12 @@ namespace mab
                 }
                 else
                 {
-                    MDRegisters_S regs;
-                    auto          findAddressByName = [&]<typename T>(MDRegisterEntry_S<T> reg)
+                    const auto* descriptor = MDRegisters_S::findByName(registerStr);
+                    if (descriptor != nullptr)
                     {
-                        if (registerStr.compare(reg.m_name) == 0)
-                        {
-                            address     = reg.m_regAddress;
-                            isWriteOnly = reg.m_accessLevel == RegisterAccessLevel_E::WO;
-                        }
-                    };
-                    regs.forEachRegister(findAddressByName);
+                        address     = descriptor->address;
+                        isWriteOnly = descriptor->access == RegisterAccessLevel_E::WO;
+                    }
                     if (address != 0x0 && !isWriteOnly)
                     {
                         m_logger.info("Is RO - %u", isWriteOnly);
@@ -1429,7 +1420,7 @@ namespace mab
                 }
             }
         };
-        regs.forEachRegister(setRegValueByAdress);
+        regs.visitRegister(regAdress, setRegValueByAdress);
         if (!foundRegister)
         {
             m_logger.error("Register 0x%04X not found", regAdress);
@@ -1484,7 +1475,7 @@ namespace mab
             }
             return false;
         };
-        regs.forEachRegister(getValueByAdress);
+        regs.visitRegister(regAdress, getValueByAdress);
         return registerStringValue;
     }
 }  // namespace mab
@@ -2,6 +2,7 @@
 #include <iomanip>
 #include <string>
 #include <cstdint>
+#include <memory>
 #include <mutex>
 #include <array>
 #include <optional>
@@ -135,16 +136,16 @@ class Logger
         if (getCurrentLevel() == LogLevel_E::SILENT)
             return *this;
 
-        m_internalStrBuffer << value;
+        internalStrBuffer() << value;
 
         constexpr char termination = *NEW_LINE;
         // Process buffer contents character by character
-        auto newlinePos = m_internalStrBuffer.str().find(termination);
+        auto newlinePos = internalStrBuffer().str().find(termination);
 
         if (newlinePos != std::string::npos)
         {
-            std::string temp = m_internalStrBuffer.str();
-            m_internalStrBuffer.str("");
+            std::string temp = internalStrBuffer().str();
+            internalStrBuffer().str("");
             // Remove all newline characters from the string
             temp.erase(std::remove(temp.begin(), temp.end(), termination), temp.end());
             info(temp.c_str());
@@ -161,16 +162,16 @@ class Logger
             return *this;
 
         // Apply the manipulator to the internal stream
-        m_internalStrBuffer << manip;
+        internalStrBuffer() << manip;
 
         // Check if the manipulator inserted a newline
         constexpr char newlineChar = *NEW_LINE;
-        auto           newlinePos  = m_internalStrBuffer.str().find(newlineChar);
+        auto           newlinePos  = internalStrBuffer().str().find(newlineChar);
 
         if (newlinePos != std::string::npos)
         {
-            std::string temp = m_internalStrBuffer.str();
-            m_internalStrBuffer.str("");
+            std::string temp = internalStrBuffer().str();
+            internalStrBuffer().str("");
             // Remove all newline characters from the string
             temp.erase(std::remove(temp.begin(), temp.end(), newlineChar), temp.end());
             info(temp.c_str());
@@ -190,7 +191,15 @@ class Logger
     void        printLog(FILE* stream, const char* header, const char* msg) const;
     std::string generateHeader(Logger::MessageType_E messageType) const noexcept;
 
-    std::stringstream m_internalStrBuffer;
+    /// @brief allocated on the first use of the stream operators, most instances never need it
+    std::unique_ptr<std::stringstream> m_internalStrBuffer;
+
+    std::stringstream& internalStrBuffer()
+    {
+        if (m_internalStrBuffer == nullptr)
+            m_internalStrBuffer = std::make_unique<std::stringstream>();
+        return *m_internalStrBuffer;
+    }
 
     static inline bool printSpecials()
     {
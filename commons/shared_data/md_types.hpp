@@ -1,10 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <functional>
@@ -196,10 +199,6 @@ namespace mab
         const u16                   m_regAddress;
         const std::string_view      m_name;
 
-      private:
-        std::array<u8, sizeof(value) + sizeof(m_regAddress)> serializedBuffer;
-
-      public:
         constexpr MDRegisterEntry_S(RegisterAccessLevel_E accessLevel,
                                     u16                   regAddress,
                                     std::string_view      name)
@@ -237,30 +236,55 @@ namespace mab
             return sizeof(T) + sizeof(m_regAddress);
         }
 
-        const std::array<u8, sizeof(value) + sizeof(m_regAddress)>* getSerializedRegister()
+        std::array<u8, sizeof(value) + sizeof(m_regAddress)> getSerializedRegister() const
         {
-            // Frame layout <8bits per chunk> [LSB address, MSB address, Payload ...]
-            std::memcpy(serializedBuffer.data(), &m_regAddress, sizeof(m_regAddress));
-            std::memcpy(serializedBuffer.data() + sizeof(m_regAddress), &value, sizeof(value));
+            std::array<u8, sizeof(value) + sizeof(m_regAddress)> serialized;
+            serializeInto(serialized.data());
+            return serialized;
+        }
 
-            return &serializedBuffer;
+        /// @brief Serialize the register at the front of the cursor and advance it past the
+        /// register
+        /// @return false if the cursor is too short
+        bool serializeInto(std::span<u8>& cursor) const
+        {
+            if (cursor.size() < getSerializedSize())
+                return false;
+            serializeInto(cursor.data());
+            cursor = cursor.subspan(getSerializedSize());
+            return true;
         }
 
-        bool setSerializedRegister(std::vector<u8>& data)
+        /// @brief Serialize the register, buffer must hold at least getSerializedSize() bytes
+        void serializeInto(u8* buffer) const
         {
             // Frame layout <8bits per chunk> [LSB address, MSB address, Payload ...]
-            if (data.size() < getSerializedSize() || data.data() == nullptr)
+            std::memcpy(buffer, &m_regAddress, sizeof(m_regAddress));
+            std::memcpy(buffer + sizeof(m_regAddress), &value, sizeof(value));
+        }
+
+        /// @brief Deserialize the register from the front of the cursor and advance it past the
+        /// register
+        /// @return false if the cursor is too short or holds a different register
+        bool setSerializedRegister(std::span<const u8>& cursor)
+        {
+            if (cursor.size() < getSerializedSize() || !setSerializedRegister(cursor.data()))
                 return false;
+            cursor = cursor.subspan(getSerializedSize());
+            return true;
+        }
+
+        /// @brief Deserialize the register, buffer must hold at least getSerializedSize() bytes
+        /// @return false if the buffer holds a different register
+        bool setSerializedRegister(const u8* buffer)
+        {
+            // Frame layout <8bits per chunk> [LSB address, MSB address, Payload ...]
             u16 addressFromSerial = 0;
-            std::memcpy(&addressFromSerial, data.data(), sizeof(m_regAddress));
-            if (addressFromSerial == m_regAddress)
-            {
-                std::memcpy(&value, data.data() + sizeof(m_regAddress), sizeof(value));
-                if (data.size() > sizeof(m_regAddress) + sizeof(value))
-                    data.erase(data.begin(), data.begin() + sizeof(m_regAddress) + sizeof(value));
-                return true;
-            }
-            return false;
+            std::memcpy(&addressFromSerial, buffer, sizeof(m_regAddress));
+            if (addressFromSerial != m_regAddress)
+                return false;
+            std::memcpy(&value, buffer + sizeof(m_regAddress), sizeof(value));
+            return true;
         }
 
         void clear()
@@ -280,10 +304,6 @@ namespace mab
         const u16                   m_regAddress;
         const std::string_view      m_name;
 
-      private:
-        std::array<u8, sizeof(value) + sizeof(m_regAddress)> serializedBuffer;
-
-      public:
         constexpr MDRegisterEntry_S(RegisterAccessLevel_E accessLevel,
                                     u16                   regAddress,
                                     std::string_view      name)
@@ -329,30 +349,55 @@ namespace mab
             return sizeof(T[N]) + sizeof(m_regAddress);
         }
 
-        const std::array<u8, sizeof(value) + sizeof(m_regAddress)>* getSerializedRegister()
+        std::array<u8, sizeof(value) + sizeof(m_regAddress)> getSerializedRegister() const
         {
-            // Frame layout <8bits per chunk> [LSB address, MSB address, Payload ...]
-            std::memcpy(serializedBuffer.data(), &m_regAddress, sizeof(m_regAddress));
-            std::memcpy(serializedBuffer.data() + sizeof(m_regAddress), value, sizeof(value));
+            std::array<u8, sizeof(value) + sizeof(m_regAddress)> serialized;
+            serializeInto(serialized.data());
+            return serialized;
+        }
 
-            return &serializedBuffer;
+        /// @brief Serialize the register at the front of the cursor and advance it past the
+        /// register
+        /// @return false if the cursor is too short
+        bool serializeInto(std::span<u8>& cursor) const
+        {
+            if (cursor.size() < getSerializedSize())
+                return false;
+            serializeInto(cursor.data());
+            cursor = cursor.subspan(getSerializedSize());
+            return true;
         }
 
-        bool setSerializedRegister(std::vector<u8>& data)
+        /// @brief Serialize the register, buffer must hold at least getSerializedSize() bytes
+        void serializeInto(u8* buffer) const
         {
             // Frame layout <8bits per chunk> [LSB address, MSB address, Payload ...]
-            if (data.size() < getSerializedSize())
+            std::memcpy(buffer, &m_regAddress, sizeof(m_regAddress));
+            std::memcpy(buffer + sizeof(m_regAddress), value, sizeof(value));
+        }
+
+        /// @brief Deserialize the register from the front of the cursor and advance it past the
+        /// register
+        /// @return false if the cursor is too short or holds a different register
+        bool setSerializedRegister(std::span<const u8>& cursor)
+        {
+            if (cursor.size() < getSerializedSize() || !setSerializedRegister(cursor.data()))
                 return false;
+            cursor = cursor.subspan(getSerializedSize());
+            return true;
+        }
+
+        /// @brief Deserialize the register, buffer must hold at least getSerializedSize() bytes
+        /// @return false if the buffer holds a different register
+        bool setSerializedRegister(const u8* buffer)
+        {
+            // Frame layout <8bits per chunk> [LSB address, MSB address, Payload ...]
             u16 addressFromSerial = 0;
-            std::memcpy(&addressFromSerial, data.data(), sizeof(m_regAddress));
-            if (addressFromSerial == m_regAddress)
-            {
-                std::memcpy(value, data.data() + sizeof(m_regAddress), sizeof(value));
-                if (data.size() > sizeof(m_regAddress) + sizeof(value))
-                    data.erase(data.begin(), data.begin() + sizeof(m_regAddress) + sizeof(value));
-                return true;
-            }
-            return false;
+            std::memcpy(&addressFromSerial, buffer, sizeof(m_regAddress));
+            if (addressFromSerial != m_regAddress)
+                return false;
+            std::memcpy(value, buffer + sizeof(m_regAddress), sizeof(value));
+            return true;
         }
         void clear()
         {
@@ -360,6 +405,267 @@ namespace mab
         }
     };
 
+    /// @brief Type erased view of a register entry, used where the set of registers is only known
+    /// at runtime
+    struct MDRegisterRef_S
+    {
+        u16                   address = 0;
+        u16                   size    = 0;  ///< Size of the value in bytes
+        RegisterAccessLevel_E access  = RegisterAccessLevel_E::RO;
+        std::string_view      name;
+        void*                 value = nullptr;  ///< Points to the value of the referenced entry
+
+        template <typename T>
+        static MDRegisterRef_S from(MDRegisterEntry_S<T>& reg)
+        {
+            return MDRegisterRef_S{reg.m_regAddress,
+                                   static_cast<u16>(reg.getSize()),
+                                   reg.m_accessLevel,
+                                   reg.m_name,
+                                   static_cast<void*>(&reg.value)};
+        }
+
+        /// @brief Size of the register inside of the frame [LSB address, MSB address, Payload...]
+        constexpr size_t getSerializedSize() const
+        {
+            return sizeof(address) + size;
+        }
+    };
+
+    /// @brief Compile time properties of the register at the address
+    template <MDRegisterAddress_E Address>
+    struct MDRegisterTraits_S;
+
+#define MD_REG(name, type, addr, access)                                                \
+    template <>                                                                         \
+    struct MDRegisterTraits_S<MDRegisterAddress_E::name>                                \
+    {                                                                                   \
+        using value_t = type;                                                           \
+        static constexpr u16                   ADDRESS = addr;                          \
+        static constexpr RegisterAccessLevel_E ACCESS  = RegisterAccessLevel_E::access; \
+    };
+    REGISTER_LIST
+#undef MD_REG
+
+    /// @brief Type of the value stored in the register
+    enum class MDRegisterType_E : u8
+    {
+        U8,
+        U16,
+        U32,
+        F32,
+        CHAR_ARRAY
+    };
+
+    template <typename T>
+    constexpr MDRegisterType_E mdRegisterTypeOf()
+    {
+        if constexpr (std::is_array_v<T>)
+            return MDRegisterType_E::CHAR_ARRAY;
+        else if constexpr (std::is_floating_point_v<T>)
+            return MDRegisterType_E::F32;
+        else if constexpr (sizeof(T) == sizeof(u32))
+            return MDRegisterType_E::U32;
+        else if constexpr (sizeof(T) == sizeof(u16))
+            return MDRegisterType_E::U16;
+        else
+            return MDRegisterType_E::U8;
+    }
+
+    /// @brief Static description of a register, shared by all of the drives
+    struct MDRegisterDescriptor_S
+    {
+        u16                   address = 0;
+        u16                   size    = 0;  ///< Size of the value in bytes
+        u16                   offset  = 0;  ///< Offset of the value inside of the value block
+        MDRegisterType_E      type    = MDRegisterType_E::U8;
+        RegisterAccessLevel_E access  = RegisterAccessLevel_E::RO;
+        std::string_view      name;
+    };
+
+    /// @brief Descriptors of all the registers in the REGISTER_LIST order, values are laid out
+    /// back to back without padding
+    inline constexpr auto MD_REGISTER_DESCRIPTORS = []()
+    {
+        std::array descriptors{
+#define MD_REG(name, type, addr, access)                  \
+    MDRegisterDescriptor_S{addr,                          \
+                           sizeof(type),                  \
+                           0,                             \
+                           mdRegisterTypeOf<type>(),      \
+                           RegisterAccessLevel_E::access, \
+                           #name},
+            REGISTER_LIST
+#undef MD_REG
+        };
+        u16 offset = 0;
+        for (auto& descriptor : descriptors)
+        {
+            descriptor.offset = offset;
+            offset += descriptor.size;
+        }
+        return descriptors;
+    }();
+
+    inline constexpr size_t MD_REGISTER_VALUE_BLOCK_SIZE =
+        MD_REGISTER_DESCRIPTORS.back().offset + MD_REGISTER_DESCRIPTORS.back().size;
+
+    namespace registerLookup
+    {
+        /// @brief Murmur3 finalizer, spreads every input bit over the whole word
+        constexpr u32 mix(u32 h)
+        {
+            h ^= h >> 16;
+            h *= 0x85EBCA6Bu;
+            h ^= h >> 13;
+            h *= 0xC2B2AE35u;
+            h ^= h >> 16;
+            return h;
+        }
+
+        constexpr u32 hashName(const std::string_view name, const u32 seed)
+        {
+            u32 h = 0x811C9DC5u ^ mix(seed);
+            for (const char c : name)
+            {
+                h ^= static_cast<u8>(c);
+                h *= 0x01000193u;
+            }
+            return mix(h);
+        }
+
+        constexpr u32 hashAddress(const u16 address, const u32 seed)
+        {
+            return mix(address ^ (seed * 0x9E3779B9u));
+        }
+
+        /// @brief Collision free hash table (hash and displace) mapping a key to the index of its
+        /// descriptor. Key is hashed once to select a bucket and once more with the seed of the
+        /// bucket to select the slot.
+        template <typename Key_T, u32 (*Hash)(Key_T, u32)>
+        struct PerfectHash_S
+        {
+            static constexpr size_t SIZE  = std::bit_ceil(MD_REGISTER_DESCRIPTORS.size());
+            static constexpr u16    EMPTY = 0xFFFF;
+
+            std::array<u16, SIZE> seeds{};    ///< per bucket
+            std::array<u16, SIZE> indices{};  ///< per slot
+            bool                  valid = false;
+
+            constexpr u16 lookup(const Key_T key) const
+            {
+                const u32 bucket = Hash(key, 0) & (SIZE - 1);
+                return indices[Hash(key, seeds[bucket]) & (SIZE - 1)];
+            }
+        };
+
+        template <typename Key_T, u32 (*Hash)(Key_T, u32), typename KeyOf_F>
+        constexpr PerfectHash_S<Key_T, Hash> buildPerfectHash(KeyOf_F keyOf)
+        {
+            using Table_t          = PerfectHash_S<Key_T, Hash>;
+            constexpr size_t SIZE  = Table_t::SIZE;
+            constexpr size_t COUNT = MD_REGISTER_DESCRIPTORS.size();
+
+            Table_t table;
+            table.indices.fill(Table_t::EMPTY);
+
+            std::array<u16, COUNT> bucketOf{};
+            std::array<u16, SIZE>  bucketSize{};
+            u16                    largestBucket = 0;
+            for (size_t idx = 0; idx < COUNT; idx++)
+            {
+                bucketOf[idx] = Hash(keyOf(MD_REGISTER_DESCRIPTORS[idx]), 0) & (SIZE - 1);
+                largestBucket = std::max(largestBucket, ++bucketSize[bucketOf[idx]]);
+            }
+
+            // largest buckets are placed first, while the table is still mostly empty
+            for (u16 size = largestBucket; size > 0; size--)
+            {
+                for (size_t bucket = 0; bucket < SIZE; bucket++)
+                {
+                    if (bucketSize[bucket] != size)
+                        continue;
+
+                    std::array<u16, COUNT> members{};
+                    size_t                 memberCount = 0;
+                    for (size_t idx = 0; idx < COUNT; idx++)
+                    {
+                        if (bucketOf[idx] == bucket)
+                            members[memberCount++] = idx;
+                    }
+
+                    bool placed = false;
+                    for (u16 seed = 1; seed < Table_t::EMPTY && !placed; seed++)
+                    {
+                        std::array<u32, COUNT> slots{};
+                        bool                   fits = true;
+                        for (size_t m = 0; m < memberCount && fits; m++)
+                        {
+                            slots[m] = Hash(keyOf(MD_REGISTER_DESCRIPTORS[members[m]]), seed) &
+                                       (SIZE - 1);
+                            fits     = table.indices[slots[m]] == Table_t::EMPTY;
+                            for (size_t other = 0; other < m && fits; other++)
+                                fits = slots[other] != slots[m];
+                        }
+                        if (!fits)
+                            continue;
+
+                        table.seeds[bucket] = seed;
+                        for (size_t m = 0; m < memberCount; m++)
+                            table.indices[slots[m]] = members[m];
+                        placed = true;
+                    }
+                    // only possible with duplicated keys in the REGISTER_LIST
+                    if (!placed)
+                        return table;
+                }
+            }
+            table.valid = true;
+            return table;
+        }
+
+        inline constexpr auto NAME_HASH =
+            buildPerfectHash<std::string_view, hashName>([](const MDRegisterDescriptor_S& d)
+                                                         { return d.name; });
+        inline constexpr auto ADDRESS_HASH =
+            buildPerfectHash<u16, hashAddress>([](const MDRegisterDescriptor_S& d)
+                                               { return d.address; });
+
+        static_assert(NAME_HASH.valid, "Register names must be unique");
+        static_assert(ADDRESS_HASH.valid, "Register addresses must be unique");
+    }  // namespace registerLookup
+
+    /// @brief Values of all the registers of a single drive packed into one block, layout is
+    /// described by MD_REGISTER_DESCRIPTORS
+    struct MDRegisterValueBlock_S
+    {
+        std::array<u8, MD_REGISTER_VALUE_BLOCK_SIZE> data{};
+
+        template <typename T>
+        T get(const MDRegisterDescriptor_S& descriptor) const
+        {
+            T value{};
+            std::memcpy(&value, data.data() + descriptor.offset, sizeof(T));
+            return value;
+        }
+
+        template <typename T>
+        void set(const MDRegisterDescriptor_S& descriptor, const T value)
+        {
+            std::memcpy(data.data() + descriptor.offset, &value, sizeof(T));
+        }
+
+        /// @brief Get type erased reference to the value inside of the block
+        MDRegisterRef_S ref(const MDRegisterDescriptor_S& descriptor)
+        {
+            return MDRegisterRef_S{descriptor.address,
+                                   descriptor.size,
+                                   descriptor.access,
+                                   descriptor.name,
+                                   static_cast<void*>(data.data() + descriptor.offset)};
+        }
+    };
+
     struct MDRegisters_S
     {
         RegisterAccessLevel_E const RO = RegisterAccessLevel_E::RO;
@@ -396,6 +702,79 @@ namespace mab
         {
             std::apply([&](auto&&... regs) { (func(regs), ...); }, getAllRegisters());
         }
+
+        /// @brief Copy values of all the registers into the packed block
+        void storeValues(MDRegisterValueBlock_S& block)
+        {
+            size_t idx = 0;
+            forEachRegister(
+                [&](auto& reg)
+                {
+                    std::memcpy(block.data.data() + MD_REGISTER_DESCRIPTORS[idx++].offset,
+                                &reg.value,
+                                reg.getSize());
+                });
+        }
+
+        /// @brief Load values of all the registers from the packed block
+        void loadValues(const MDRegisterValueBlock_S& block)
+        {
+            size_t idx = 0;
+            forEachRegister(
+                [&](auto& reg)
+                {
+                    std::memcpy(&reg.value,
+                                block.data.data() + MD_REGISTER_DESCRIPTORS[idx++].offset,
+                                reg.getSize());
+                });
+        }
+
+        /// @brief Find descriptor of the register by its name
+        /// @return nullptr if there is no such register
+        static constexpr const MDRegisterDescriptor_S* findByName(const std::string_view name)
+        {
+            const u16 idx = registerLookup::NAME_HASH.lookup(name);
+            if (idx == registerLookup::NAME_HASH.EMPTY || MD_REGISTER_DESCRIPTORS[idx].name != name)
+                return nullptr;
+            return &MD_REGISTER_DESCRIPTORS[idx];
+        }
+
+        /// @brief Find descriptor of the register by its address
+        /// @return nullptr if there is no register at the address
+        static constexpr const MDRegisterDescriptor_S* findByAddress(const u16 address)
+        {
+            const u16 idx = registerLookup::ADDRESS_HASH.lookup(address);
+            if (idx == registerLookup::ADDRESS_HASH.EMPTY ||
+                MD_REGISTER_DESCRIPTORS[idx].address != address)
+                return nullptr;
+            return &MD_REGISTER_DESCRIPTORS[idx];
+        }
+
+        /// @brief Call func with the register entry at the address
+        /// @return false if there is no register at the address
+        template <class F>
+        bool visitRegister(const u16 address, F&& func)
+        {
+            switch (address)
+            {
+#define MD_REG(name, type, addr, access) \
+    case addr:                           \
+        func(name);                      \
+        return true;
+                REGISTER_LIST
+#undef MD_REG
+                default:
+                    return false;
+            }
+        }
+
+        /// @brief Get type erased reference to the register at the address
+        std::optional<MDRegisterRef_S> getRef(const u16 address)
+        {
+            std::optional<MDRegisterRef_S> ref;
+            visitRegister(address, [&](auto& reg) { ref = MDRegisterRef_S::from(reg); });
+            return ref;
+        }
     };
 
 }  // namespace mab
@@ -6,6 +6,8 @@
 /// start to manifest) and the frames might get lost so it is recommended to check the return values
 /// of the asynchronous functions in order to verify that the frames were properly sent and
 /// received, as well as calling .get() on promises after <30 requests have been made.
+/// For requests to many drives at once see MDBatch, which bounds the number of frames in flight
+/// and completes the whole batch with a single future.
 
 #include "candlelib.hpp"
 
@@ -52,16 +52,15 @@ namespace mab
         {
             if constexpr (std::is_same_v<T, R>)
             {
-                if (reg.m_name == regName)
-                {
-                    found = true;
-                    err   = md.readRegisters(reg);
-                    value = reg.value;
-                }
+                found = true;
+                err   = md.readRegisters(reg);
+                value = reg.value;
             }
         };
 
-        mdRegisters.forEachRegister(getReg);
+        const auto* descriptor = MDRegisters_S::findByName(regName);
+        if (descriptor != nullptr)
+            mdRegisters.visitRegister(descriptor->address, getReg);
         if (!found)
         {
             log.error("Wrong name or type!");
@@ -84,16 +83,15 @@ namespace mab
         {
             if constexpr (std::is_same<std::decay_t<R>, char*>::value)
             {
-                if (reg.m_name == regName)
-                {
-                    found = true;
-                    err   = md.readRegisters(reg);
-                    value = std::string(reg.value);
-                }
+                found = true;
+                err   = md.readRegisters(reg);
+                value = std::string(reg.value);
             }
         };
 
-        mdRegisters.forEachRegister(getReg);
+        const auto* descriptor = MDRegisters_S::findByName(regName);
+        if (descriptor != nullptr)
+            mdRegisters.visitRegister(descriptor->address, getReg);
         if (!found)
         {
             log.error("Wrong name or type!");
@@ -116,16 +114,15 @@ namespace mab
         {
             if constexpr (std::is_same_v<T, R>)
             {
-                if (reg.m_name == regName)
-                {
-                    found     = true;
-                    reg.value = value;
-                    err       = md.writeRegisters(reg);
-                }
+                found     = true;
+                reg.value = value;
+                err       = md.writeRegisters(reg);
             }
         };
 
-        mdRegisters.forEachRegister(getReg);
+        const auto* descriptor = MDRegisters_S::findByName(regName);
+        if (descriptor != nullptr)
+            mdRegisters.visitRegister(descriptor->address, getReg);
         if (!found)
         {
             log.error("Wrong name or type!");
@@ -147,23 +144,22 @@ namespace mab
         {
             if constexpr (std::is_same<std::decay_t<R>, char*>::value)
             {
-                if (reg.m_name == regName)
+                found = true;
+                if (value.size() + 1 > sizeof(reg.value))
                 {
-                    found = true;
-                    if (value.size() + 1 > sizeof(reg.value))
-                    {
-                        log.error("String too long!");
-                        err = MD::Error_t::REQUEST_INVALID;
-                        return;
-                    }
-                    std::memset(reg.value, 0, sizeof(reg.value));
-                    std::strncpy(reg.value, value.c_str(), sizeof(value.c_str()));
-                    err = md.writeRegisters(reg);
+                    log.error("String too long!");
+                    err = MD::Error_t::REQUEST_INVALID;
+                    return;
                 }
+                std::memset(reg.value, 0, sizeof(reg.value));
+                std::strncpy(reg.value, value.c_str(), sizeof(value.c_str()));
+                err = md.writeRegisters(reg);
             }
         };
 
-        mdRegisters.forEachRegister(getReg);
+        const auto* descriptor = MDRegisters_S::findByName(regName);
+        if (descriptor != nullptr)
+            mdRegisters.visitRegister(descriptor->address, getReg);
         if (!found)
         {
             log.error("Wrong name or type!");
@@ -643,7 +639,10 @@ PYBIND11_MODULE(pyCandle, m)
           py::arg("regName"),
           py::arg("value"),
           "Write a register to the MD device.");
-    m.def("discoverMDs", &mab::MD::discoverMDs, "Discover MD devices connected to the system.");
+    m.def(
+        "discoverMDs",
+        [](mab::Candle* candle) { return mab::MD::discoverMDs(candle); },
+        "Discover MD devices connected to the system.");
     
 
     // Logger